@@ -0,0 +1,208 @@
+#include "disk.h"
+#include "bptree.h"
+#include "ingest.h"
+#include "range_scan.h"
+#include "record_block.h"
+#include "test_util.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <vector>
+
+typedef std::pair<float, PayloadEntry> Entry;
+
+// Payload columns of the index, in PayloadEntry::values order
+enum { PAYLOAD_FG3_PCT, PAYLOAD_FT_PCT, PAYLOAD_PTS };
+const char* PAYLOAD_NAMES[MAX_PAYLOAD_COLUMNS] = {"FG3_PCT_home", "FT_PCT_home", "PTS_home"};
+
+static bool entryLess(const Entry& a, const Entry& b) {
+    return a.first < b.first || (a.first == b.first && a.second.rid < b.second.rid);
+}
+
+// The aggregates the tree should return, by walking the sorted entries
+static PayloadBPTree::Aggregate bruteForce(const std::vector<Entry>& entries, float startKey, float endKey) {
+    PayloadBPTree::Aggregate aggregate;
+    for (const Entry& entry : entries) {
+        if (entry.first >= startKey && entry.first <= endKey) {
+            aggregate.add(entry.first, entry.second);
+        }
+    }
+    return aggregate;
+}
+
+static bool sameAggregate(const PayloadBPTree::Aggregate& a, const PayloadBPTree::Aggregate& b) {
+    for (int c = 0; c < PayloadBPTree::Aggregate::COLUMNS; ++c) {
+        const ColumnAggregate& x = a.columns[c];
+        const ColumnAggregate& y = b.columns[c];
+        if (x.count != y.count || x.min != y.min || x.max != y.max ||
+            std::fabs(x.sum - y.sum) > 1e-9 * std::max(1.0, std::fabs(y.sum))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Random ranges, plus the whole key space and an empty range
+static size_t checkRanges(const PayloadBPTree& tree, const std::vector<Entry>& entries, std::mt19937& rng) {
+    std::uniform_real_distribution<float> key(0.0f, 1.0f);
+    size_t wrong = 0;
+    for (int i = 0; i < 200; ++i) {
+        float a = key(rng), b = i % 10 == 0 ? a : key(rng);
+        float lo = std::min(a, b), hi = std::max(a, b);
+        wrong += !sameAggregate(tree.aggregateRange(lo, hi), bruteForce(entries, lo, hi));
+    }
+    wrong += !sameAggregate(tree.aggregateRange(-1.0f, 2.0f), bruteForce(entries, -1.0f, 2.0f));
+    wrong += tree.aggregateRange(0.6f, 0.5f).key().count != 0;
+    return wrong;
+}
+
+// Bulk loaded and inserted trees over random entries, checked against a scan
+// of the entries before and after a removeRange. games.txt has too few
+// distinct percentages to grow a tree past two levels, so the keys here are
+// random with six digits.
+static bool checkAggregates() {
+    std::mt19937 rng(21);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<Entry> entries(400000);
+    for (size_t i = 0; i < entries.size(); ++i) {
+        entries[i].first = (rng() % 1000000) / 1000000.0f;
+        entries[i].second.rid = static_cast<RecordId>(i);
+        for (int c = 0; c < MAX_PAYLOAD_COLUMNS; ++c) {
+            // Some values missing, as in games.txt
+            entries[i].second.values[c] = rng() % 20 == 0 ? NAN : unit(rng);
+        }
+    }
+    std::vector<Entry> shuffled = entries;
+    std::sort(entries.begin(), entries.end(), entryLess);
+
+    Disk disk("aggregate_disk.db");
+    PayloadBPTree loaded, inserted;
+    if (!loaded.bulkLoad(entries, 0.7)) {
+        return false;
+    }
+    for (const Entry& entry : shuffled) {
+        inserted.insert(entry.first, entry.second, disk);
+    }
+    size_t wrong = checkRanges(loaded, entries, rng) + checkRanges(inserted, entries, rng);
+
+    // Deleting a range must leave the aggregates right
+    std::vector<PayloadEntry> removed = inserted.removeRange(0.25f, 0.6f);
+    std::vector<Entry> remaining;
+    for (const Entry& entry : entries) {
+        if (entry.first < 0.25f || entry.first > 0.6f) {
+            remaining.push_back(entry);
+        }
+    }
+    wrong += checkRanges(inserted, remaining, rng);
+    std::cout << "Checked aggregateRange on 606 ranges over trees of height " << loaded.getHeight() << " and "
+              << inserted.getHeight() << ", " << removed.size() << " entries removed in between: " << wrong
+              << " differ from a scan of the entries" << std::endl;
+    if (wrong != 0 || removed.size() + remaining.size() != entries.size() || !loaded.checkStructure() ||
+        !inserted.checkStructure()) {
+        std::cerr << "Error: aggregateRange disagrees with the entries" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    // Load games.txt (or the given file) into a scratch data file
+    const char* dataPath = "aggregate_disk.db";
+    const char* gamesFile = argc > 1 ? argv[1] : "games.txt";
+    std::remove(dataPath);
+
+    bool ok = checkAggregates();
+    std::remove(dataPath);
+    {
+        Disk disk(dataPath);
+        std::vector<std::pair<float, RecordId>> ridEntries;
+        IngestStats ingestStats;
+        if (!loadGames(gamesFile, disk, &ridEntries, ingestStats)) {
+            return 1;
+        }
+        std::sort(ridEntries.begin(), ridEntries.end());
+
+        // FG_PCT_home keys carrying FG3_PCT_home, FT_PCT_home and PTS_home
+        std::vector<Entry> entries;
+        std::vector<uint8_t> block(BLOCK_SIZE);
+        for (uint32_t b = 0; b < disk.GetTotalBlocks() && disk.ReadBlock(b, block.data()); ++b) {
+            BlockView view(block.data());
+            for (uint32_t slot = 0; slot < view.numRecords(); ++slot) {
+                RecordView record = view.record(slot);
+                if (view.isDeleted(slot) || record.fgPctMissing()) {
+                    continue;
+                }
+                PayloadEntry entry;
+                entry.rid = makeRecordId(b, slot);
+                entry.values[PAYLOAD_FG3_PCT] = record.fg3PctHome();
+                entry.values[PAYLOAD_FT_PCT] = record.ftPctHome();
+                entry.values[PAYLOAD_PTS] = static_cast<float>(record.ptsHome());
+                entries.push_back(Entry(record.fgPctHome(), entry));
+            }
+        }
+        std::sort(entries.begin(), entries.end(), entryLess);
+        std::cout << entries.size() << " keyed records in " << disk.GetTotalBlocks() << " blocks" << std::endl;
+
+        PayloadBPTree loaded;
+        if (!loaded.bulkLoad(entries)) {
+            return 1;
+        }
+
+        // AVG(FG3_PCT_home) for FG_PCT_home in [0.5, 0.8], from the aggregates
+        // and by fetching the matching records through the plain index
+        BPTree index;
+        if (!index.bulkLoad(ridEntries)) {
+            return 1;
+        }
+        RangeScanExecutor scan(disk);
+        RangeScanExecutor::Predicate all = [](const RecordView&) { return true; };
+        PayloadBPTree::Aggregate aggregate;
+        double fetchedAverage = 0;
+        size_t fetched = 0;
+        std::vector<double> aggregateMillis, fetchMillis;
+        for (int run = 0; run < REPEATS; ++run) {
+            Clock::time_point start = Clock::now();
+            aggregate = loaded.aggregateRange(0.5f, 0.8f);
+            aggregateMillis.push_back(millisSince(start));
+
+            start = Clock::now();
+            std::vector<RecordId> rids = index.rangeQuery(0.5f, 0.8f, disk);
+            std::vector<Record> records;
+            scan.execute(rids, all, records);
+            double sum = 0;
+            size_t count = 0;
+            for (const Record& record : records) {
+                if (record.fg3_pct_home != PCT_MISSING) {
+                    sum += record.fg3_pct_home / 1000.0;
+                    count++;
+                }
+            }
+            fetchMillis.push_back(millisSince(start));
+            fetchedAverage = count > 0 ? sum / count : 0;
+            fetched = records.size();
+        }
+        const ColumnAggregate& fg3 = aggregate.payload(PAYLOAD_FG3_PCT);
+        std::cout << "AVG(FG3_PCT_home) for FG_PCT_home in [0.5, 0.8] over " << aggregate.key().count
+                  << " games = " << fg3.average() << " (min " << fg3.min << ", max " << fg3.max << ")\n"
+                  << "  aggregateRange: " << medianMillis(aggregateMillis) << " ms\n"
+                  << "  rangeQuery and fetch of " << fetched << " records: " << medianMillis(fetchMillis) << " ms"
+                  << std::endl;
+        for (int c = 1; c < MAX_PAYLOAD_COLUMNS; ++c) {
+            std::cout << "  AVG(" << PAYLOAD_NAMES[c] << ") = " << aggregate.payload(c).average() << std::endl;
+        }
+        if (fetched != aggregate.key().count || std::fabs(fetchedAverage - fg3.average()) > 1e-6) {
+            std::cerr << "Error: aggregateRange and the fetched records disagree" << std::endl;
+            ok = false;
+        }
+    }
+
+    std::remove(dataPath);
+    if (!ok) {
+        return 1;
+    }
+    std::cout << "Aggregate test passed" << std::endl;
+    return 0;
+}
+// Compile with g++ -std=c++11 -O2 -pthread aggregate_test.cc disk.cc async_io.cc bptree.cc ingest.cc range_scan.cc record_block.cc -o aggregate_test
@@ -0,0 +1,365 @@
+// async_io.cc
+#include "async_io.h"
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// io_uring is used when the kernel headers have it; -DDISABLE_IO_URING
+// builds with the thread backend only
+#if defined(__linux__) && !defined(DISABLE_IO_URING) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+// <linux/fs.h>, pulled in above, defines BLOCK_SIZE as 1024; ours is in record_block.h
+#undef BLOCK_SIZE
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define ASYNC_IO_HAVE_URING 1
+#endif
+#endif
+#endif
+
+bool AsyncBlockReader::PrepareRead(uint32_t firstBlock, uint32_t count) {
+    if (count == 0 || firstBlock + count > disk.GetTotalBlocks()) {
+        std::cerr << "Error: Blocks " << firstBlock << " to " << firstBlock + count - 1 << " do not exist." << std::endl;
+        return false;
+    }
+    return disk.GetReadDescriptor() >= 0;
+}
+
+#ifdef ASYNC_IO_HAVE_URING
+
+// One submission ring and one completion ring shared with the kernel. Each
+// outstanding read owns a slot; the slot index travels as the user_data of
+// its submission, and a short read is resubmitted for the rest of the run.
+class UringBlockReader : public AsyncBlockReader {
+private:
+    struct Slot {
+        uint32_t firstBlock;
+        uint32_t count;
+        uint8_t* buffer;
+        uint64_t tag;
+        size_t done;          // Bytes read so far
+        struct iovec iov;     // Must stay put until the kernel has consumed the submission
+    };
+
+    int ringFd;
+    int fileFd;
+    void* sqRing;
+    size_t sqRingBytes;
+    void* cqRing;
+    size_t cqRingBytes;
+    struct io_uring_sqe* sqes;
+    size_t sqesBytes;
+
+    unsigned* sqTail;
+    unsigned* sqMask;
+    unsigned* sqArray;
+    unsigned* cqHead;
+    unsigned* cqTail;
+    unsigned* cqMask;
+    struct io_uring_cqe* cqes;
+
+    std::vector<Slot> slots;
+    std::vector<uint32_t> freeSlots;
+    unsigned unsubmitted;     // Queued in the ring but not yet passed to io_uring_enter
+
+    static void* MapRing(int ringFd, size_t bytes, off_t offset) {
+        void* ring = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, offset);
+        return ring == MAP_FAILED ? nullptr : ring;
+    }
+
+    void QueueRead(uint32_t slotIndex) {
+        Slot& slot = slots[slotIndex];
+        size_t length = static_cast<size_t>(slot.count) * BLOCK_SIZE;
+        slot.iov.iov_base = slot.buffer + slot.done;
+        slot.iov.iov_len = length - slot.done;
+
+        unsigned tail = *sqTail;
+        unsigned index = tail & *sqMask;
+        struct io_uring_sqe* sqe = &sqes[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_READV;
+        sqe->fd = fileFd;
+        sqe->addr = reinterpret_cast<uint64_t>(&slot.iov);
+        sqe->len = 1;
+        sqe->off = static_cast<uint64_t>(slot.firstBlock) * BLOCK_SIZE + slot.done;
+        sqe->user_data = slotIndex;
+        sqArray[index] = index;
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+        unsubmitted++;
+    }
+
+    // Pass queued submissions to the kernel, optionally waiting for a completion
+    bool Enter(bool waitForCompletion) {
+        for (;;) {
+            unsigned flags = waitForCompletion ? IORING_ENTER_GETEVENTS : 0;
+            long n = syscall(__NR_io_uring_enter, ringFd, unsubmitted, waitForCompletion ? 1 : 0, flags, nullptr, 0);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n < 0) {
+                std::cerr << "Error: io_uring_enter failed (" << std::strerror(errno) << ")" << std::endl;
+                return false;
+            }
+            unsubmitted -= static_cast<unsigned>(n);
+            return true;
+        }
+    }
+
+public:
+    UringBlockReader(Disk& disk, int fileFd, uint32_t queueDepth)
+        : AsyncBlockReader(disk, queueDepth),
+          ringFd(-1),
+          fileFd(fileFd),
+          sqRing(nullptr),
+          sqRingBytes(0),
+          cqRing(nullptr),
+          cqRingBytes(0),
+          sqes(nullptr),
+          sqesBytes(0),
+          slots(this->queueDepth),
+          unsubmitted(0) {
+        struct io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        ringFd = static_cast<int>(syscall(__NR_io_uring_setup, this->queueDepth, &params));
+        if (ringFd < 0) {
+            // Old kernel, or io_uring switched off by seccomp or sysctl
+            return;
+        }
+
+        // Map the three regions separately; kernels with IORING_FEAT_SINGLE_MMAP accept that too
+        sqRingBytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingBytes = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+        sqesBytes = params.sq_entries * sizeof(struct io_uring_sqe);
+        sqRing = MapRing(ringFd, sqRingBytes, IORING_OFF_SQ_RING);
+        cqRing = MapRing(ringFd, cqRingBytes, IORING_OFF_CQ_RING);
+        sqes = static_cast<struct io_uring_sqe*>(MapRing(ringFd, sqesBytes, IORING_OFF_SQES));
+        if (!sqRing || !cqRing || !sqes) {
+            return;
+        }
+
+        uint8_t* sq = static_cast<uint8_t*>(sqRing);
+        uint8_t* cq = static_cast<uint8_t*>(cqRing);
+        sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+
+        for (uint32_t i = this->queueDepth; i > 0; --i) {
+            freeSlots.push_back(i - 1);
+        }
+    }
+
+    ~UringBlockReader() {
+        uint64_t tag;
+        bool ok;
+        while (ringFd >= 0 && sqes && WaitCompletion(tag, ok)) {
+        }
+        if (sqes) munmap(sqes, sqesBytes);
+        if (cqRing) munmap(cqRing, cqRingBytes);
+        if (sqRing) munmap(sqRing, sqRingBytes);
+        if (ringFd >= 0) ::close(ringFd);
+    }
+
+    bool isReady() const { return ringFd >= 0 && sqRing && cqRing && sqes; }
+
+    bool Submit(uint32_t firstBlock, uint32_t count, uint8_t* buffer, uint64_t tag) {
+        if (freeSlots.empty() || !PrepareRead(firstBlock, count)) {
+            return false;
+        }
+        uint32_t slotIndex = freeSlots.back();
+        freeSlots.pop_back();
+        Slot& slot = slots[slotIndex];
+        slot.firstBlock = firstBlock;
+        slot.count = count;
+        slot.buffer = buffer;
+        slot.tag = tag;
+        slot.done = 0;
+        QueueRead(slotIndex);
+        inFlight++;
+        // Start the read now; if the kernel refuses, the next Enter passes it on
+        Enter(false);
+        return true;
+    }
+
+    bool WaitCompletion(uint64_t& tag, bool& ok) {
+        while (inFlight > 0) {
+            unsigned head = *cqHead;
+            if (head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+                if (!Enter(true)) {
+                    return false;
+                }
+                continue;
+            }
+            struct io_uring_cqe cqe = cqes[head & *cqMask];
+            __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+
+            uint32_t slotIndex = static_cast<uint32_t>(cqe.user_data);
+            Slot& slot = slots[slotIndex];
+            size_t length = static_cast<size_t>(slot.count) * BLOCK_SIZE;
+            if (cqe.res == -EINTR || cqe.res == -EAGAIN) {
+                QueueRead(slotIndex);
+                continue;
+            }
+            ok = cqe.res >= 0;
+            if (!ok) {
+                std::cerr << "Error: Failed to read blocks starting at " << slot.firstBlock << " ("
+                          << std::strerror(-cqe.res) << ")" << std::endl;
+            } else if (cqe.res == 0) {
+                // Blocks inside a hole at the end of the file read as zeros
+                std::memset(slot.buffer + slot.done, 0, length - slot.done);
+            } else {
+                slot.done += static_cast<size_t>(cqe.res);
+                if (slot.done < length) {
+                    QueueRead(slotIndex);
+                    continue;
+                }
+            }
+            if (ok) {
+                disk.RecordExternalRead(slot.count);
+            }
+            tag = slot.tag;
+            freeSlots.push_back(slotIndex);
+            inFlight--;
+            return true;
+        }
+        return false;
+    }
+
+    const char* GetBackendName() const { return "io_uring"; }
+};
+
+#endif // ASYNC_IO_HAVE_URING
+
+// Fallback: each read is a ReadBlocks call on one of a few worker threads
+class ThreadBlockReader : public AsyncBlockReader {
+private:
+    struct Request {
+        uint32_t firstBlock;
+        uint32_t count;
+        uint8_t* buffer;
+        uint64_t tag;
+    };
+    struct Completion {
+        uint64_t tag;
+        bool ok;
+    };
+
+    std::vector<std::thread> threads;
+    std::mutex mutex;                  // Guards the queues and stopping
+    std::condition_variable requestReady;
+    std::condition_variable completionReady;
+    std::deque<Request> requests;
+    std::deque<Completion> completions;
+    bool stopping;
+
+    void workerLoop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            requestReady.wait(lock, [this]() { return stopping || !requests.empty(); });
+            if (requests.empty()) {
+                return;
+            }
+            Request request = requests.front();
+            requests.pop_front();
+            lock.unlock();
+            Completion completion;
+            completion.tag = request.tag;
+            completion.ok = disk.ReadBlocks(request.firstBlock, request.count, request.buffer);
+            lock.lock();
+            completions.push_back(completion);
+            completionReady.notify_one();
+        }
+    }
+
+public:
+    ThreadBlockReader(Disk& disk, uint32_t queueDepth) : AsyncBlockReader(disk, queueDepth), stopping(false) {
+        uint32_t numThreads = this->queueDepth < MAX_IO_FALLBACK_THREADS ? this->queueDepth : MAX_IO_FALLBACK_THREADS;
+        for (uint32_t i = 0; i < numThreads; ++i) {
+            threads.push_back(std::thread(&ThreadBlockReader::workerLoop, this));
+        }
+    }
+
+    ~ThreadBlockReader() {
+        // Workers finish the queued reads before they see stopping
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        requestReady.notify_all();
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+
+    bool Submit(uint32_t firstBlock, uint32_t count, uint8_t* buffer, uint64_t tag) {
+        if (inFlight >= queueDepth || !PrepareRead(firstBlock, count)) {
+            return false;
+        }
+        Request request;
+        request.firstBlock = firstBlock;
+        request.count = count;
+        request.buffer = buffer;
+        request.tag = tag;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            requests.push_back(request);
+        }
+        requestReady.notify_one();
+        inFlight++;
+        return true;
+    }
+
+    bool WaitCompletion(uint64_t& tag, bool& ok) {
+        if (inFlight == 0) {
+            return false;
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        completionReady.wait(lock, [this]() { return !completions.empty(); });
+        tag = completions.front().tag;
+        ok = completions.front().ok;
+        completions.pop_front();
+        inFlight--;
+        return true;
+    }
+
+    const char* GetBackendName() const { return "threads"; }
+};
+
+std::unique_ptr<AsyncBlockReader> AsyncBlockReader::Create(Disk& disk, uint32_t queueDepth, Backend backend) {
+    int fd = disk.GetReadDescriptor();
+    if (fd < 0) {
+        std::cerr << "Error: Disk is not open or has unwritten blocks; cannot read it asynchronously." << std::endl;
+        return std::unique_ptr<AsyncBlockReader>();
+    }
+
+#ifdef ASYNC_IO_HAVE_URING
+    if (backend != BACKEND_THREADS) {
+        std::unique_ptr<UringBlockReader> reader(new UringBlockReader(disk, fd, queueDepth));
+        if (reader->isReady()) {
+            return std::unique_ptr<AsyncBlockReader>(reader.release());
+        }
+        if (backend == BACKEND_IO_URING) {
+            std::cerr << "Error: io_uring is not available (" << std::strerror(errno) << ")" << std::endl;
+            return std::unique_ptr<AsyncBlockReader>();
+        }
+    }
+#else
+    if (backend == BACKEND_IO_URING) {
+        std::cerr << "Error: This build has no io_uring support." << std::endl;
+        return std::unique_ptr<AsyncBlockReader>();
+    }
+#endif
+    return std::unique_ptr<AsyncBlockReader>(new ThreadBlockReader(disk, queueDepth));
+}
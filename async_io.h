@@ -0,0 +1,64 @@
+// async_io.h
+#ifndef ASYNC_IO_H
+#define ASYNC_IO_H
+
+#include <cstdint>
+#include <memory>
+#include "disk.h"
+
+const uint32_t DEFAULT_IO_QUEUE_DEPTH = 8;    // Reads kept in flight by scans and read-ahead
+const uint32_t MAX_IO_FALLBACK_THREADS = 8;   // pread workers of the thread backend
+
+// Reads blocks of one Disk without waiting for them: Submit starts a read of
+// a run of consecutive blocks and returns at once, WaitCompletion hands back
+// finished reads one at a time, in whatever order the device completes them.
+// Up to queueDepth reads are outstanding at once, which is what lets a fast
+// device overlap them instead of serving one read per round trip.
+//
+// On Linux the reads go through io_uring (raw system calls, no liburing
+// needed); where io_uring is missing or not permitted the reads run as
+// ReadBlocks calls on a few worker threads instead. Both follow the Disk rule
+// for concurrent reads: nothing may write to the disk while reads are in
+// flight. Staged writes are flushed before each read is submitted.
+//
+// A reader is used from one thread at a time, and every buffer handed to
+// Submit must stay alive until its read has come back from WaitCompletion
+// (the destructor waits for reads still in flight).
+class AsyncBlockReader {
+public:
+    enum Backend { BACKEND_AUTO, BACKEND_IO_URING, BACKEND_THREADS };
+
+    virtual ~AsyncBlockReader() {}
+
+    // Start reading count blocks from firstBlock into buffer; tag is returned
+    // by WaitCompletion. False if the blocks do not exist or queueDepth reads
+    // are already outstanding.
+    virtual bool Submit(uint32_t firstBlock, uint32_t count, uint8_t* buffer, uint64_t tag) = 0;
+
+    // Wait for one outstanding read to finish and report its tag and whether
+    // it succeeded; false if no read is outstanding
+    virtual bool WaitCompletion(uint64_t& tag, bool& ok) = 0;
+
+    uint32_t GetQueueDepth() const { return queueDepth; }
+    uint32_t GetInFlight() const { return inFlight; }
+    virtual const char* GetBackendName() const = 0;
+
+    // BACKEND_AUTO picks io_uring when the kernel allows it. Returns nullptr
+    // if the requested backend cannot be set up.
+    static std::unique_ptr<AsyncBlockReader> Create(Disk& disk, uint32_t queueDepth = DEFAULT_IO_QUEUE_DEPTH,
+                                                    Backend backend = BACKEND_AUTO);
+
+protected:
+    Disk& disk;
+    uint32_t queueDepth;
+    uint32_t inFlight;
+
+    AsyncBlockReader(Disk& disk, uint32_t queueDepth)
+        : disk(disk), queueDepth(queueDepth == 0 ? 1 : queueDepth), inFlight(0) {}
+
+    // Check that blocks [firstBlock, firstBlock + count) exist and push staged
+    // writes to the file, so the read sees everything written so far
+    bool PrepareRead(uint32_t firstBlock, uint32_t count);
+};
+
+#endif // ASYNC_IO_H
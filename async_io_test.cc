@@ -0,0 +1,162 @@
+#include "disk.h"
+#include "async_io.h"
+#include "buffer_pool.h"
+#include "bptree.h"
+#include "disk_bptree.h"
+#include "ingest.h"
+#include "range_scan.h"
+#include "record_block.h"
+#include "test_util.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Random runs read through the reader must match the same runs read with ReadBlocks
+static bool checkReader(Disk& disk, AsyncBlockReader::Backend backend, const char* name) {
+    std::unique_ptr<AsyncBlockReader> reader = AsyncBlockReader::Create(disk, 16, backend);
+    if (!reader) {
+        std::cout << name << ": not available here, skipped" << std::endl;
+        return true;
+    }
+
+    const uint32_t numReads = 2000;
+    const uint32_t maxRun = 8;
+    std::mt19937 rng(11);
+    std::vector<uint32_t> firstBlocks(numReads), counts(numReads);
+    std::vector<uint8_t> buffers(static_cast<size_t>(numReads) * maxRun * BLOCK_SIZE);
+    std::vector<char> done(numReads, 0);
+    for (uint32_t i = 0; i < numReads; ++i) {
+        counts[i] = 1 + rng() % maxRun;
+        firstBlocks[i] = rng() % (disk.GetTotalBlocks() - counts[i] + 1);
+    }
+
+    uint32_t submitted = 0, completed = 0, failed = 0;
+    while (completed < numReads) {
+        while (submitted < numReads && reader->GetInFlight() < reader->GetQueueDepth()) {
+            uint8_t* buffer = &buffers[static_cast<size_t>(submitted) * maxRun * BLOCK_SIZE];
+            if (!reader->Submit(firstBlocks[submitted], counts[submitted], buffer, submitted)) {
+                return false;
+            }
+            submitted++;
+        }
+        uint64_t tag;
+        bool ok;
+        if (!reader->WaitCompletion(tag, ok) || tag >= numReads || done[tag]) {
+            return false;
+        }
+        done[tag] = 1;
+        failed += !ok;
+        completed++;
+    }
+
+    std::vector<uint8_t> expected(static_cast<size_t>(maxRun) * BLOCK_SIZE);
+    uint32_t wrong = 0;
+    for (uint32_t i = 0; i < numReads; ++i) {
+        if (!disk.ReadBlocks(firstBlocks[i], counts[i], expected.data())) {
+            return false;
+        }
+        wrong += std::memcmp(expected.data(), &buffers[static_cast<size_t>(i) * maxRun * BLOCK_SIZE],
+                             static_cast<size_t>(counts[i]) * BLOCK_SIZE) != 0;
+    }
+    std::cout << name << " (" << reader->GetBackendName() << "): " << numReads << " reads, " << failed
+              << " failed, " << wrong << " differ from ReadBlocks" << std::endl;
+    return failed == 0 && wrong == 0;
+}
+
+int main(int argc, char* argv[]) {
+    // Load games.txt (or the given file) into scratch data and index files
+    const char* dataPath = "async_disk.db";
+    const char* indexPath = "async_index.db";
+    const char* gamesFile = argc > 1 ? argv[1] : "games.txt";
+    std::remove(dataPath);
+    std::remove(indexPath);
+
+    bool ok = true;
+    {
+        Disk disk(dataPath);
+        std::vector<std::pair<float, RecordId>> entries;
+        IngestStats ingestStats;
+        if (!loadGames(gamesFile, disk, &entries, ingestStats)) {
+            return 1;
+        }
+        std::sort(entries.begin(), entries.end());
+        std::cout << ingestStats.records << " records in " << disk.GetTotalBlocks() << " blocks" << std::endl;
+
+        ok = checkReader(disk, AsyncBlockReader::BACKEND_IO_URING, "io_uring backend") && ok;
+        ok = checkReader(disk, AsyncBlockReader::BACKEND_THREADS, "thread backend") && ok;
+
+        // The same range scan read synchronously and with reads kept in flight
+        BPTree bptree;
+        if (!bptree.bulkLoad(entries)) {
+            return 1;
+        }
+        std::vector<RecordId> rids = bptree.rangeQuery(0.3f, 0.7f, disk);
+        RangeScanExecutor::Predicate predicate = [](const RecordView& record) { return record.ptsHome() >= 100; };
+        std::vector<RecordId> baseline;
+        const uint32_t depths[] = {1, 4, DEFAULT_IO_QUEUE_DEPTH, 32};
+        for (uint32_t depth : depths) {
+            // Short runs so that the scan issues many reads
+            RangeScanExecutor scan(disk, 4, depth);
+            std::vector<double> millis;
+            std::vector<RecordId> matched;
+            for (int run = 0; run < REPEATS; ++run) {
+                std::vector<Record> records;
+                matched.clear();
+                Clock::time_point start = Clock::now();
+                scan.execute(rids, predicate, records, &matched);
+                millis.push_back(millisSince(start));
+            }
+            if (depth == 1) {
+                baseline = matched;
+            } else if (matched != baseline) {
+                std::cerr << "Error: Queue depth " << depth << " returned different records" << std::endl;
+                ok = false;
+            }
+            std::cout << "Range scan at queue depth " << depth << ": " << matched.size() << " records, "
+                      << scan.getStats().readRuns << " reads, " << medianMillis(millis) << " ms" << std::endl;
+        }
+
+        // Page-resident index: a leaf walk with the next leaf read ahead finds the same ids
+        Disk indexDisk(indexPath);
+        std::vector<uint32_t> expected;
+        {
+            BufferPool indexPool(indexDisk);
+            DiskBPTree index(indexPool);
+            bool built = index.create();
+            for (size_t i = 0; i < entries.size() && built; ++i) {
+                built = index.insert(entries[i].first, entries[i].second);
+            }
+            if (!built || !index.flush() || !indexDisk.Sync()) {
+                std::cerr << "Error: Failed to build " << indexPath << std::endl;
+                return 1;
+            }
+            expected = index.rangeQuery(0.3f, 0.7f);
+        }
+        BufferPool readAheadPool(indexDisk, 64);
+        DiskBPTree readAheadIndex(readAheadPool);
+        if (!readAheadIndex.open() || !readAheadPool.EnableReadAhead()) {
+            return 1;
+        }
+        readAheadPool.ResetCounters();
+        std::vector<uint32_t> found = readAheadIndex.rangeQuery(0.3f, 0.7f);
+        std::cout << "Leaf walk with read-ahead: " << found.size() << " ids, " << readAheadPool.GetReadAheads()
+                  << " leaves read ahead, " << readAheadPool.GetMisses() << " pages read on demand" << std::endl;
+        if (found != expected || readAheadPool.GetReadAheads() == 0) {
+            std::cerr << "Error: Leaf walk with read-ahead differs from the plain one" << std::endl;
+            ok = false;
+        }
+    }
+
+    std::remove(dataPath);
+    std::remove(indexPath);
+    if (!ok) {
+        return 1;
+    }
+    std::cout << "Async I/O test passed" << std::endl;
+    return 0;
+}
+// Compile with g++ -std=c++11 -O2 -pthread async_io_test.cc disk.cc async_io.cc buffer_pool.cc bptree.cc disk_bptree.cc ingest.cc range_scan.cc record_block.cc -o async_io_test
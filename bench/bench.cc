@@ -0,0 +1,266 @@
+// bench.cc
+// End-to-end benchmark: bulk ingest, index build, point lookups, range queries
+// at several selectivities and a full scan over a games.txt-shaped file
+// (the real one, or one written by gen_games). Every phase reports
+// throughput, p50/p99 latency and the blocks it read. Each lookup and range
+// phase opens the index through a new, empty buffer pool, so its index page
+// reads are not hidden by pages an earlier phase left cached.
+//
+// The data and index files are written to bench_disk.db / bench_index.db in
+// the current directory and replaced on every run. Reads go through the OS
+// page cache, so the numbers are for a warm cache unless it is dropped first.
+#include "../disk.h"
+#include "../buffer_pool.h"
+#include "../bptree.h"
+#include "../disk_bptree.h"
+#include "../ingest.h"
+#include "../range_scan.h"
+#include "../record_block.h"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <memory>
+#include <cstdlib>
+#include <unistd.h>
+
+const char* BENCH_DATA_FILE = "bench_disk.db";
+const char* BENCH_INDEX_FILE = "bench_index.db";
+const double RANGE_SELECTIVITIES[] = {0.001, 0.01, 0.1, 0.5};
+
+typedef std::chrono::steady_clock Clock;
+
+static double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Per-operation latencies of one benchmark phase
+struct PhaseTimes {
+    std::vector<double> micros;
+
+    void add(Clock::time_point start) {
+        micros.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+    }
+
+    double percentile(double p) {
+        if (micros.empty()) {
+            return 0.0;
+        }
+        std::sort(micros.begin(), micros.end());
+        size_t index = static_cast<size_t>(p * (micros.size() - 1) + 0.5);
+        return micros[index];
+    }
+
+    // name: N ops, X ops/s, p50 Y us, p99 Z us
+    void print(const std::string& name) {
+        double total = 0.0;
+        for (double m : micros) {
+            total += m;
+        }
+        std::cout << std::left << std::setw(24) << name << std::right
+                  << micros.size() << " ops, "
+                  << std::fixed << std::setprecision(0) << (total > 0 ? micros.size() / (total / 1e6) : 0.0) << " ops/s, "
+                  << std::setprecision(1) << "p50 " << percentile(0.50) << " us, p99 " << percentile(0.99) << " us"
+                  << std::defaultfloat << std::endl;
+    }
+};
+
+static void usage() {
+    std::cerr << "Usage: bench <games file> [--lookups n] [--queries n] [--seed n]" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        usage();
+        return 1;
+    }
+    std::string gamesPath = argv[1];
+    size_t numLookups = 10000;
+    size_t numQueries = 20;
+    uint32_t seed = 42;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        if (option == "--lookups") {
+            numLookups = std::strtoul(argv[i + 1], nullptr, 10);
+        } else if (option == "--queries") {
+            numQueries = std::strtoul(argv[i + 1], nullptr, 10);
+        } else if (option == "--seed") {
+            seed = static_cast<uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    std::mt19937 rng(seed);
+
+    unlink(BENCH_DATA_FILE);
+    unlink(BENCH_INDEX_FILE);
+    Disk disk(BENCH_DATA_FILE);
+    Disk indexDisk(BENCH_INDEX_FILE);
+    if (!disk.isOpen() || !indexDisk.isOpen()) {
+        return 1;
+    }
+
+    // Bulk ingest
+    std::vector<std::pair<float, RecordId>> entries;
+    IngestStats ingestStats;
+    Clock::time_point start = Clock::now();
+    if (!ingestGames(gamesPath, disk, IngestOptions(), &entries, ingestStats) || !disk.Sync()) {
+        std::cerr << "Error: Ingest of " << gamesPath << " failed." << std::endl;
+        return 1;
+    }
+    double ingestSeconds = secondsSince(start);
+    std::cout << "ingest                  " << ingestStats.records << " records, "
+              << static_cast<size_t>(ingestStats.records / ingestSeconds) << " records/s, "
+              << ingestStats.blocksWritten << " blocks written, " << ingestSeconds << " s (incl. fsync)" << std::endl;
+    if (entries.empty()) {
+        std::cerr << "Error: No indexed records in " << gamesPath << std::endl;
+        return 1;
+    }
+
+    // Index builds: sort, bottom-up in-memory tree, page-resident tree by insertion
+    start = Clock::now();
+    std::sort(entries.begin(), entries.end());
+    double sortSeconds = secondsSince(start);
+
+    BPTree memoryTree;
+    start = Clock::now();
+    memoryTree.bulkLoad(entries);
+    double bulkLoadSeconds = secondsSince(start);
+
+    std::unique_ptr<BufferPool> indexPool(new BufferPool(indexDisk));
+    std::unique_ptr<DiskBPTree> index(new DiskBPTree(*indexPool));
+    start = Clock::now();
+    bool built = index->create();
+    for (size_t i = 0; i < entries.size() && built; ++i) {
+        built = index->insert(entries[i].first, entries[i].second);
+    }
+    built = built && index->flush() && indexDisk.Sync();
+    double indexSeconds = secondsSince(start);
+    if (!built) {
+        std::cerr << "Error: Failed to build " << BENCH_INDEX_FILE << std::endl;
+        return 1;
+    }
+    uint32_t indexPages = index->getNumberOfNodes();
+    uint32_t indexHeight = index->getHeight();
+
+    // Drop every cached index page and open the index again; the header page
+    // read by open() is left out of the phase's counters
+    auto reopenIndex = [&]() {
+        index.reset();
+        indexPool.reset(new BufferPool(indexDisk));
+        index.reset(new DiskBPTree(*indexPool));
+        if (!index->open()) {
+            return false;
+        }
+        indexPool->ResetCounters();
+        return true;
+    };
+    std::cout << "sort                    " << entries.size() << " keys, " << sortSeconds << " s" << std::endl;
+    std::cout << "bulk load (memory)      " << memoryTree.getNumberOfNodes() << " nodes, height "
+              << memoryTree.getHeight() << ", " << bulkLoadSeconds << " s" << std::endl;
+    std::cout << "insert build (disk)     " << indexPages << " pages, height "
+              << indexHeight << ", " << static_cast<size_t>(entries.size() / indexSeconds)
+              << " inserts/s, " << indexSeconds << " s" << std::endl;
+
+    // Point lookups on keys that exist
+    std::uniform_int_distribution<size_t> pickEntry(0, entries.size() - 1);
+    PhaseTimes lookupTimes;
+    size_t lookupHits = 0;
+    if (!reopenIndex()) {
+        return 1;
+    }
+    for (size_t i = 0; i < numLookups; ++i) {
+        float key = entries[pickEntry(rng)].first;
+        start = Clock::now();
+        lookupHits += index->search(key).size();
+        lookupTimes.add(start);
+    }
+    lookupTimes.print("point lookup");
+    std::cout << "    " << lookupHits / std::max<size_t>(numLookups, 1) << " record ids per lookup, "
+              << indexPool->GetMisses() << " index pages read, hit ratio " << std::setprecision(3) << indexPool->GetHitRatio() << std::endl;
+
+    // Range queries: index range scan plus data block fetch, at fixed fractions of the keys
+    RangeScanExecutor scan(disk);
+    for (double selectivity : RANGE_SELECTIVITIES) {
+        size_t width = std::max<size_t>(1, static_cast<size_t>(selectivity * entries.size()));
+        std::uniform_int_distribution<size_t> pickStart(0, entries.size() - width);
+        PhaseTimes queryTimes;
+        size_t recordsFound = 0, blocksRead = 0, readRuns = 0;
+        if (!reopenIndex()) {
+            return 1;
+        }
+        for (size_t q = 0; q < numQueries; ++q) {
+            size_t first = pickStart(rng);
+            float startKey = entries[first].first;
+            float endKey = entries[first + width - 1].first;
+            std::vector<Record> records;
+            start = Clock::now();
+            std::vector<RecordId> rids = index->rangeQuery(startKey, endKey);
+            scan.execute(rids, RangeScanExecutor::Predicate(), records);
+            queryTimes.add(start);
+            recordsFound += records.size();
+            blocksRead += scan.getStats().distinctBlocks;
+            readRuns += scan.getStats().readRuns;
+        }
+        std::ostringstream name;
+        name << "range " << selectivity * 100 << "%";
+        queryTimes.print(name.str());
+        size_t queries = std::max<size_t>(numQueries, 1);
+        std::cout << "    " << recordsFound / queries << " records, " << blocksRead / queries
+                  << " data blocks in " << readRuns / queries << " reads, "
+                  << indexPool->GetMisses() / queries << " index pages read per query" << std::endl;
+    }
+
+    // Full scan: every data block read in long runs, predicate on FG_PCT_home
+    uint32_t firstBlock = ingestStats.firstBlock;
+    uint32_t numBlocks = ingestStats.blocksWritten;
+    std::vector<uint8_t> runBuffer(static_cast<size_t>(DEFAULT_SCAN_RUN_BLOCKS) * BLOCK_SIZE);
+    PhaseTimes scanTimes;
+    size_t scanMatches = 0;
+    for (size_t q = 0; q < std::max<size_t>(1, numQueries / 4); ++q) {
+        float startKey = entries[pickEntry(rng)].first;
+        float endKey = startKey + 0.1f;
+        start = Clock::now();
+        disk.AdviseAccess(Disk::ACCESS_SEQUENTIAL);
+        for (uint32_t block = 0; block < numBlocks; block += DEFAULT_SCAN_RUN_BLOCKS) {
+            uint32_t count = std::min<uint32_t>(DEFAULT_SCAN_RUN_BLOCKS, numBlocks - block);
+            if (!disk.ReadBlocks(firstBlock + block, count, runBuffer.data())) {
+                return 1;
+            }
+            for (uint32_t b = 0; b < count; ++b) {
+                BlockView view(&runBuffer[static_cast<size_t>(b) * BLOCK_SIZE]);
+                for (uint32_t slot = 0; slot < view.numRecords(); ++slot) {
+                    if (view.isDeleted(slot)) {
+                        continue;
+                    }
+                    float key = view.record(slot).fgPctHome();
+                    scanMatches += key >= startKey && key <= endKey;
+                }
+            }
+        }
+        scanTimes.add(start);
+    }
+    scanTimes.print("full scan");
+    double scanSeconds = scanTimes.percentile(0.5) / 1e6;
+    std::cout << "    " << numBlocks << " data blocks, "
+              << (scanSeconds > 0 ? static_cast<size_t>(numBlocks * (double)BLOCK_SIZE / scanSeconds / (1 << 20)) : 0)
+              << " MB/s, " << static_cast<size_t>(ingestStats.records / std::max(scanSeconds, 1e-9))
+              << " records/s, " << scanMatches / scanTimes.micros.size() << " records matched per scan" << std::endl;
+
+    if (STATS_ENABLED) {
+        std::cout << "{\"data_io\":";
+        disk.GetStats().writeJson(std::cout);
+        std::cout << ",\"index_io\":";
+        indexDisk.GetStats().writeJson(std::cout);
+        std::cout << ",\"index\":";   // Node visits of the last range phase
+        index->getStats().writeJson(std::cout);
+        std::cout << "}" << std::endl;
+    }
+    return 0;
+}
+// Compile with g++ -std=c++11 -O2 -pthread bench.cc ../disk.cc ../async_io.cc ../buffer_pool.cc ../bptree.cc ../disk_bptree.cc ../ingest.cc ../range_scan.cc ../record_block.cc -o bench
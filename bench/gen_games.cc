@@ -0,0 +1,133 @@
+// gen_games.cc
+// Writes a games.txt-shaped file (same header, 9 tab-separated columns) with
+// any number of rows, for benchmarking at sizes well beyond the real dataset.
+//
+// FG_PCT_home, the indexed column, is drawn from a pool of distinct values:
+//   --dup-ratio r   fraction of rows that repeat a key already used, so the
+//                   pool holds about rows * (1 - r) values (at most 1001,
+//                   every 3-decimal value in [0, 1])
+//   --skew s        Zipf exponent over the pool; 0 is uniform, 1 and above
+//                   concentrate most rows on a few hot keys
+// The other columns are drawn independently from ranges seen in games.txt.
+// Compact and PAX records (the default block format is compact) keep
+// FG_PCT_home in thousandths, so the index can see all 1001 distinct values
+// written here; row and text PAX blocks keep only "0.dd", at most 101 of them.
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+
+const uint32_t FG_PCT_DOMAIN = 1001;          // 0.000 .. 1.000
+const uint32_t FIRST_TEAM_ID = 1610612737;
+const uint32_t NUM_TEAMS = 30;
+
+static void usage() {
+    std::cerr << "Usage: gen_games <rows> <output file> [--skew s] [--dup-ratio r] [--seed n]" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        usage();
+        return 1;
+    }
+    uint64_t rows = std::strtoull(argv[1], nullptr, 10);
+    std::string outputPath = argv[2];
+    double skew = 0.0;
+    double dupRatio = 0.0;
+    uint32_t seed = 42;
+    for (int i = 3; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        if (option == "--skew") {
+            skew = std::atof(argv[i + 1]);
+        } else if (option == "--dup-ratio") {
+            dupRatio = std::atof(argv[i + 1]);
+        } else if (option == "--seed") {
+            seed = static_cast<uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if (rows == 0 || skew < 0.0 || dupRatio < 0.0 || dupRatio >= 1.0) {
+        usage();
+        return 1;
+    }
+
+    std::mt19937_64 rng(seed);
+
+    // Pool of distinct keys, spread evenly over the domain and centred on
+    // typical field goal percentages when the pool is small
+    uint64_t wanted = static_cast<uint64_t>(std::llround(rows * (1.0 - dupRatio)));
+    uint32_t distinct = static_cast<uint32_t>(std::max<uint64_t>(1, std::min<uint64_t>(wanted, FG_PCT_DOMAIN)));
+    std::vector<uint32_t> pool(distinct);
+    for (uint32_t k = 0; k < distinct; ++k) {
+        if (distinct == FG_PCT_DOMAIN) {
+            pool[k] = k;
+        } else {
+            uint32_t lo = distinct < 500 ? 250 : 0;
+            uint32_t hi = distinct < 500 ? 750 : FG_PCT_DOMAIN - 1;
+            pool[k] = distinct == 1 ? (lo + hi) / 2 : lo + static_cast<uint32_t>((uint64_t)(hi - lo) * k / (distinct - 1));
+        }
+    }
+    // Hot ranks land on random keys, not on the smallest ones
+    std::shuffle(pool.begin(), pool.end(), rng);
+
+    // Zipf CDF over the pool ranks
+    std::vector<double> cdf(distinct);
+    double total = 0.0;
+    for (uint32_t k = 0; k < distinct; ++k) {
+        total += 1.0 / std::pow(k + 1.0, skew);
+        cdf[k] = total;
+    }
+    for (double& c : cdf) {
+        c /= total;
+    }
+
+    FILE* out = std::fopen(outputPath.c_str(), "w");
+    if (!out) {
+        std::cerr << "Error: Could not open " << outputPath << " for writing." << std::endl;
+        return 1;
+    }
+    std::vector<char> streamBuffer(1 << 20);
+    std::setvbuf(out, streamBuffer.data(), _IOFBF, streamBuffer.size());
+
+    std::fputs("GAME_DATE_EST\tTEAM_ID_home\tPTS_home\tFG_PCT_home\tFT_PCT_home\tFG3_PCT_home\tAST_home\tREB_home\tHOME_TEAM_WINS\n", out);
+
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    for (uint64_t r = 0; r < rows; ++r) {
+        uint32_t rank = static_cast<uint32_t>(std::lower_bound(cdf.begin(), cdf.end(), unit(rng)) - cdf.begin());
+        uint32_t fgPct = pool[std::min(rank, distinct - 1)];
+
+        uint64_t bits = rng();
+        uint32_t day = 1 + bits % 28;
+        uint32_t month = 1 + (bits >> 8) % 12;
+        uint32_t year = 2003 + (bits >> 16) % 20;
+        uint32_t team = FIRST_TEAM_ID + (bits >> 24) % NUM_TEAMS;
+        uint32_t pts = 70 + (bits >> 32) % 81;
+        uint32_t ftPct = 500 + (bits >> 40) % 501;
+        uint32_t fg3Pct = 150 + (bits >> 50) % 451;
+        uint64_t more = rng();
+        uint32_t ast = 10 + more % 30;
+        uint32_t reb = 30 + (more >> 8) % 30;
+        uint32_t wins = (more >> 16) & 1;
+
+        std::fprintf(out, "%02u/%02u/%u\t%u\t%u\t%u.%03u\t%u.%03u\t%u.%03u\t%u\t%u\t%u\n",
+                     day, month, year, team, pts,
+                     fgPct / 1000, fgPct % 1000, ftPct / 1000, ftPct % 1000, fg3Pct / 1000, fg3Pct % 1000,
+                     ast, reb, wins);
+    }
+
+    if (std::fclose(out) != 0) {
+        std::cerr << "Error: Failed to write " << outputPath << std::endl;
+        return 1;
+    }
+    std::cout << "Wrote " << rows << " rows with " << distinct << " distinct FG_PCT_home values to "
+              << outputPath << std::endl;
+    return 0;
+}
+// Compile with g++ -std=c++11 -O2 gen_games.cc -o gen_games
@@ -3,42 +3,313 @@
 
 #include "disk.h"
 #include "record_block.h"
+#include "stats.h"
+#include "key_search.h"
+#include "latch.h"
+#include "node_arena.h"
 #include <vector>
 #include <memory>
 #include <iostream>
 #include <fstream>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include <limits>
 
-const int BPTREE_ORDER = 5;  // B+ Tree order
+// B+ Tree order (maximum children per node), sized so that a node's keys and
+// 4-byte child / record list references fill one BLOCK_SIZE page after an
+// 8-byte node header, like a DiskBPTree page. 511 for 4KB blocks with 4-byte
+// keys, so the games.txt index is 2-3 levels deep.
+const uint32_t BPTREE_NODE_HEADER_SIZE = 8;
+const int BPTREE_ORDER = (BLOCK_SIZE - BPTREE_NODE_HEADER_SIZE) / (sizeof(float) + sizeof(uint32_t));
 
-// B+ Tree Node structure
-class BPTreeNode : public std::enable_shared_from_this<BPTreeNode> {
+// Default order for a key type: as many keys as fit in one block
+template <typename Key>
+constexpr int bptreeOrderFor() {
+    return static_cast<int>((BLOCK_SIZE - BPTREE_NODE_HEADER_SIZE) / (sizeof(Key) + sizeof(uint32_t)));
+}
+
+// In-node search for any key type and comparator
+template <typename Key, typename Compare>
+struct NodeKeySearch {
+    static uint32_t lowerBound(const Key* keys, uint32_t n, const Key& key) {
+        return std::lower_bound(keys, keys + n, key, Compare()) - keys;
+    }
+    static uint32_t upperBound(const Key* keys, uint32_t n, const Key& key) {
+        return std::upper_bound(keys, keys + n, key, Compare()) - keys;
+    }
+    template <typename Keys>
+    static uint32_t lowerBound(const Keys& keys, const Key& key) {
+        return lowerBound(keys.data(), keys.size(), key);
+    }
+    template <typename Keys>
+    static uint32_t upperBound(const Keys& keys, const Key& key) {
+        return upperBound(keys.data(), keys.size(), key);
+    }
+};
+
+// Float keys in ascending order use the vectorized search from key_search.h
+template <>
+struct NodeKeySearch<float, std::less<float>> {
+    static uint32_t lowerBound(const float* keys, uint32_t n, float key) { return keyLowerBound(keys, n, key); }
+    static uint32_t upperBound(const float* keys, uint32_t n, float key) { return keyUpperBound(keys, n, key); }
+    template <typename Keys>
+    static uint32_t lowerBound(const Keys& keys, float key) {
+        return keyLowerBound(keys.data(), keys.size(), key);
+    }
+    template <typename Keys>
+    static uint32_t upperBound(const Keys& keys, float key) {
+        return keyUpperBound(keys.data(), keys.size(), key);
+    }
+};
+
+// Count, sum, min and max of the values of one column
+struct ColumnAggregate {
+    uint64_t count;
+    double sum;
+    double min;
+    double max;
+
+    ColumnAggregate()
+        : count(0), sum(0), min(std::numeric_limits<double>::infinity()),
+          max(-std::numeric_limits<double>::infinity()) {}
+
+    void add(double value) {
+        count++;
+        sum += value;
+        min = std::min(min, value);
+        max = std::max(max, value);
+    }
+    void merge(const ColumnAggregate& other) {
+        count += other.count;
+        sum += other.sum;
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+    }
+    double average() const { return count > 0 ? sum / count : std::numeric_limits<double>::quiet_NaN(); }
+};
+
+// Columns other than the key that a tree sums up per subtree, read from its
+// Value type. Plain RecordIds carry none; a Value that does specializes this.
+template <typename Value>
+struct ValuePayload {
+    static const int COLUMNS = 0;
+    // Value of column c, false if the record has none
+    static bool get(const Value&, int, double&) { return false; }
+};
+
+// A record id together with up to MAX_PAYLOAD_COLUMNS column values picked by
+// whoever builds the tree (NaN where a record has no value), so that
+// aggregateRange can answer e.g. AVG(FG3_PCT_home) over an FG_PCT_home range
+// without reading the records
+const int MAX_PAYLOAD_COLUMNS = 3;
+struct PayloadEntry {
+    RecordId rid;
+    float values[MAX_PAYLOAD_COLUMNS];
+};
+
+template <>
+struct ValuePayload<PayloadEntry> {
+    static const int COLUMNS = MAX_PAYLOAD_COLUMNS;
+    static bool get(const PayloadEntry& entry, int c, double& value) {
+        value = entry.values[c];
+        return entry.values[c] == entry.values[c];
+    }
+};
+
+// A record id together with the values of up to MAX_INCLUDED_COLUMNS other
+// columns of the record, as the Record struct holds them, so that a covering
+// index can answer queries on those columns from its leaves alone
+const int MAX_INCLUDED_COLUMNS = 4;
+struct CoveringEntry {
+    RecordId rid;
+    uint32_t values[MAX_INCLUDED_COLUMNS];
+};
+
+// Aggregates over a subtree or a key range: column 0 is the key, counted
+// once per value so that duplicates weigh like the records they stand for,
+// then the Value's payload columns
+template <typename Value>
+struct RangeAggregate {
+    static const int COLUMNS = 1 + ValuePayload<Value>::COLUMNS;
+    ColumnAggregate columns[COLUMNS];
+
+    const ColumnAggregate& key() const { return columns[0]; }
+    const ColumnAggregate& payload(int c) const { return columns[1 + c]; }
+
+    void add(double key, const Value& value) {
+        columns[0].add(key);
+        for (int c = 1; c < COLUMNS; ++c) {
+            double payloadValue;
+            if (ValuePayload<Value>::get(value, c - 1, payloadValue)) {
+                columns[c].add(payloadValue);
+            }
+        }
+    }
+    void add(double key, const PostingSpan<Value>& values) {
+        for (const Value& value : values) {
+            add(key, value);
+        }
+    }
+    void merge(const RangeAggregate& other) {
+        for (int c = 0; c < COLUMNS; ++c) {
+            columns[c].merge(other.columns[c]);
+        }
+    }
+};
+
+// B+ Tree Node structure. Keys and values are written to disk as raw bytes,
+// so both must be trivially copyable. Nodes live in their tree's NodeArena
+// and name their children and next leaf by NodeId. Keys and child ids are
+// fixed-capacity inline arrays and a leaf's record lists share one packed
+// value array (PostingLists), so a node is one arena slot plus that array
+// rather than a heap allocation per key; neither the inline arrays nor the
+// reserved child aggregates reallocate under an optimistic reader (see
+// NodeLatch). An internal node keeps a RangeAggregate of every child's
+// subtree next to the child id; they are not serialized but rebuilt when a
+// tree is loaded.
+template <typename Key, typename Value = RecordId, typename Compare = std::less<Key>,
+          int Order = bptreeOrderFor<Key>()>
+class BasicBPTreeNode {
 public:
+    typedef BasicBPTreeNode<Key, Value, Compare, Order> Node;
+    typedef NodeArena<Node> Arena;
+    typedef NodeKeySearch<Key, Compare> Search;
+    typedef RangeAggregate<Value> Aggregate;
+
+    // Fill below which a node other than the root is rebalanced after a delete:
+    // the smaller half a split of a full node leaves
+    static const uint32_t MIN_LEAF_KEYS = (Order - 1) / 2;
+    static const uint32_t MIN_CHILDREN = Order / 2;
+
+    NodeId id;
+    Arena* arena;
     bool isLeaf;
-    std::vector<float> keys;
-    std::vector<std::shared_ptr<BPTreeNode>> children;
-    std::vector<std::vector<uint32_t>> records; // Record pointers (leaf)
-    std::shared_ptr<BPTreeNode> nextLeaf;
+    InlineVector<Key, Order> keys;   // Sorted by Compare, searched with NodeKeySearch
+    InlineVector<NodeId, Order + 1> children;
+    std::vector<Aggregate> childAggregates;  // Aggregate of each child's subtree (internal)
+    PostingLists<Value, Order> records;      // Values of every record with the key (leaf)
+    NodeId nextLeaf;
+    mutable NodeLatch latch;
+    // Taken instead of latch by an insert that only adds to childAggregates,
+    // and together with it by a split
+    mutable NodeLatch aggregateLatch;
+    // Checkpoint state (see TreeCheckpoint): id of the node's image in the
+    // checkpoint file, 0 until it is first written, and whether the node
+    // changed since that image was written
+    uint32_t imageId;
+    bool dirty;
+    // Inserts into a leaf whose image is otherwise current, up to Order of
+    // them, so that a checkpoint can write just these
+    std::vector<std::pair<Key, Value>> appendedSinceImage;
+
+    BasicBPTreeNode(NodeId id, Arena* arena, bool isLeaf);
+    void reserveCapacity();
+
+    Node* child(uint32_t i) const { return arena->get(children[i]); }
+    Node* nextLeafNode() const { return nextLeaf == INVALID_NODE_ID ? nullptr : arena->get(nextLeaf); }
+    // A new node in the same arena
+    Node* newNode(bool leaf) const { return arena->get(arena->allocate(arena, leaf)); }
+    // Return this node and everything below it to the arena
+    void releaseSubtree();
 
-    BPTreeNode(bool isLeaf);
+    // A full node is split before an insert descends into it
+    bool isFull() const { return keys.size() == Order - 1; }
 
-    void insertNonFull(float key, uint32_t recordPointer, Disk& disk);
-    void splitChild(int i, std::shared_ptr<BPTreeNode> y, Disk& disk);
+    // Insert into this leaf, which is not full; the caller holds its write latch
+    void insertNonFull(const Key& key, const Value& value, Disk& disk);
+    // Split the full child y at position i; the caller holds this node's and y's write latches
+    void splitChild(int i, Node* y, Disk& disk);
     void traverse(Disk& disk);
-    std::shared_ptr<BPTreeNode> search(float key, Disk& disk);
+    Node* search(const Key& key, Disk& disk);
+
+    // Deletion helpers, see BasicBPTree::removeRange
+    void removeRange(const Key& startKey, const Key& endKey, std::vector<Value>& removed);
+    void collectValues(std::vector<Value>& values) const;
+    bool isUnderfull() const;
+    void rebalanceChildren();
+    uint32_t fixChild(uint32_t i);
+    Node* leftmostLeaf();
+    Node* rightmostLeaf();
+    bool checkNode(const Key* lowKey, const Key* highKey, bool isRoot, int depth, int& leafDepth,
+                   std::vector<const Node*>& leaves) const;
+
+    // Aggregate of this subtree from the node's own entries or child aggregates
+    Aggregate summarize() const;
+    // Recompute childAggregates[i] after child i changed
+    void refreshChildAggregate(uint32_t i) { childAggregates[i] = child(i)->summarize(); }
+    // Recompute every child aggregate in the subtree, bottom-up
+    void rebuildAggregates();
 
     // Serialization and Deserialization functions
     void serialize(std::ofstream& outFile) const;
-    void deserialize(std::ifstream &inFile, std::vector<std::shared_ptr<BPTreeNode>> &leafNodes);
+    void deserialize(std::ifstream &inFile, std::vector<Node*> &leafNodes);
     int countNodes() const;      // Method to count total number of nodes
     int computeHeight() const;   // Method to compute the height of the tree
 };
 
-class BPTree {
+// insert, search, rangeQuery, countRange and aggregateRange may be called from
+// any number of threads at once. Readers descend with optimistic lock
+// coupling: inner nodes are read without latching and validated against their
+// version, and only the leaves are latched shared while their record lists are
+// copied, coupling from one leaf to the next during a range scan. Writers
+// descend the same way and latch exclusively just the leaf they change, plus
+// the aggregate latches of the nodes above it, or a node and its parent when
+// the node has to be split on the way down. bulkLoad, remove, removeRange,
+// deserialize and traverse need the tree to themselves.
+template <typename Key, typename Value = RecordId, typename Compare = std::less<Key>,
+          int Order = bptreeOrderFor<Key>()>
+class BasicBPTree {
 public:
-    std::shared_ptr<BPTreeNode> root;
-    BPTree();
+    typedef BasicBPTreeNode<Key, Value, Compare, Order> Node;
+    typedef RangeAggregate<Value> Aggregate;
+    static const int ORDER = Order;
+
+private:
+    mutable IndexStats stats;  // Only counted when built with ENABLE_STATS, not thread-safe
+    mutable NodeLatch rootLatch;  // Versions the root pointer itself
+    typename Node::Arena arena;   // Every node of the tree
+
+    // Deepest tree an insert records the path of; far beyond any real height
+    static const size_t MAX_INSERT_DEPTH = 64;
+    // One optimistic attempt at an insert; false if it has to restart
+    bool tryInsert(const Key& key, const Value& value, Disk& disk);
+    // Leaf that may hold key, returned latched shared
+    Node* lockLeafShared(const Key& key) const;
+    // One optimistic attempt at aggregateRange over the subtree of node, read
+    // from a parent that must still be at parentVersion; false to restart
+    bool tryAggregate(const Node* node, const NodeLatch& parentLatch, uint64_t parentVersion, const Key& startKey,
+                      const Key& endKey, bool lowInside, bool highInside, Aggregate& result) const;
+
+public:
+    Node* root;
+    BasicBPTree();
+
+    // A new node of this tree, for code that builds one node by node
+    Node* newNode(bool isLeaf) { return arena.get(arena.allocate(&arena, isLeaf)); }
+    // Drop every node, leaving an empty root leaf
+    void clear();
+
+    void insert(const Key& key, const Value& value, Disk& disk);
 
-    void insert(float key, uint32_t recordPointer, Disk& disk);
+    // Build the tree bottom-up from (key, value) pairs sorted by key,
+    // replacing its current contents. Equal keys are merged into one entry and
+    // every node is packed to fillFactor (0, 1] of its capacity, but never
+    // below the minimum fill (MIN_LEAF_KEYS, MIN_CHILDREN).
+    bool bulkLoad(const std::vector<std::pair<Key, Value>>& sortedEntries, double fillFactor = 1.0);
+
+    // Delete every value of key, or of every key in [startKey, endKey], and
+    // return them in key order so the caller can tombstone the records. Whole
+    // subtrees inside the range are unlinked in one pass and only the nodes on
+    // the two boundary paths are trimmed and then rebalanced by borrowing from
+    // or merging with a sibling, so the cost follows the leaves removed rather
+    // than one root-to-leaf descent per key.
+    std::vector<Value> remove(const Key& key);
+    std::vector<Value> removeRange(const Key& startKey, const Key& endKey);
+
+    // Check key order, separator bounds, node fill, leaf depth and the leaf
+    // chain; prints the first problem found to std::cerr
+    bool checkStructure() const;
     void traverse(Disk& disk);
 
     // Serialization and Deserialization
@@ -48,9 +319,55 @@ public:
     // New methods for node counting, height, and root key printing
     int getNumberOfNodes() const;  // Get total number of nodes in the B+ Tree
     int getHeight() const;         // Get height of the B+ Tree
+    size_t getMemoryUsage() const; // Bytes held by the nodes, their value arrays and child aggregates
     void printRootKeys() const;    // Print the keys in the root node
-    std::vector<uint32_t> rangeQuery(float startKey, float endKey, Disk& disk);
-    std::shared_ptr<BPTreeNode> findLeafNode(float key) const;
+    std::vector<Value> rangeQuery(const Key& startKey, const Key& endKey, Disk& disk);
+
+    // Values stored under key
+    std::vector<Value> search(const Key& key) const;
+
+    // Append the values of the keys in [startKey, endKey], or [startKey, endKey)
+    // when includeEndKey is false, to result in key order
+    void collectRange(const Key& startKey, const Key& endKey, bool includeEndKey, std::vector<Value>& result) const;
+
+    // Up to maxParts - 1 increasing keys inside (startKey, endKey] that cut the
+    // range into parts of about the same number of leaves, from the separators
+    // of the inner nodes (or the leaf keys of a one-leaf tree)
+    std::vector<Key> splitKeys(const Key& startKey, const Key& endKey, size_t maxParts) const;
+
+    // Number of values rangeQuery would return, without collecting them
+    size_t countRange(const Key& startKey, const Key& endKey) const;
+
+    // COUNT, SUM, MIN, MAX (and so AVG) of the key and of the payload columns
+    // over the values of the keys in [startKey, endKey]. Children that lie
+    // wholly inside the range contribute their stored aggregate, so only the
+    // nodes on the paths to the two boundary leaves are read.
+    Aggregate aggregateRange(const Key& startKey, const Key& endKey) const;
+    Node* findLeafNode(const Key& key) const;
+
+    // Node visits and latencies since the last reset
+    const IndexStats& getStats() const { return stats; }
+    void resetStats() { stats.reset(); }
 };
 
+// The instantiations compiled in bptree.cc. Member definitions are in
+// bptree_impl.h; other key types, comparators or orders include it.
+typedef BasicBPTreeNode<float> BPTreeNode;
+typedef BasicBPTree<float> BPTree;              // FG_PCT_home and the other percentages
+typedef BasicBPTree<uint32_t> UIntBPTree;       // PTS_home, TEAM_ID_home, GAME_DATE_EST as a day number
+typedef BasicBPTree<float, PayloadEntry> PayloadBPTree;   // Float keys with payload columns to aggregate
+typedef BasicBPTree<float, CoveringEntry> CoveringBPTree;         // Covering indexes, see SecondaryIndexes
+typedef BasicBPTree<uint32_t, CoveringEntry> UIntCoveringBPTree;
+
+extern template class BasicBPTreeNode<float>;
+extern template class BasicBPTree<float>;
+extern template class BasicBPTreeNode<uint32_t>;
+extern template class BasicBPTree<uint32_t>;
+extern template class BasicBPTreeNode<float, PayloadEntry>;
+extern template class BasicBPTree<float, PayloadEntry>;
+extern template class BasicBPTreeNode<float, CoveringEntry>;
+extern template class BasicBPTree<float, CoveringEntry>;
+extern template class BasicBPTreeNode<uint32_t, CoveringEntry>;
+extern template class BasicBPTree<uint32_t, CoveringEntry>;
+
 #endif // BPTREE_H
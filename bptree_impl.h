@@ -0,0 +1,1212 @@
+// bptree_impl.h
+// Member definitions of BasicBPTreeNode and BasicBPTree. bptree.cc compiles
+// the instantiations declared at the end of bptree.h; include this header
+// instead of bptree.h to instantiate the tree for another key type,
+// comparator or order, e.g. a small order that splits after a few inserts.
+#ifndef BPTREE_IMPL_H
+#define BPTREE_IMPL_H
+
+#include "bptree.h"
+#include <cmath>
+#include <fstream>
+
+// Constructor for BPTreeNode
+template <typename Key, typename Value, typename Compare, int Order>
+BasicBPTreeNode<Key, Value, Compare, Order>::BasicBPTreeNode(NodeId id, Arena* arena, bool isLeaf)
+    : id(id), arena(arena), isLeaf(isLeaf), nextLeaf(INVALID_NODE_ID), imageId(0), dirty(true) {
+    reserveCapacity();
+}
+
+template <typename Key, typename Value, typename Compare, int Order>
+void BasicBPTreeNode<Key, Value, Compare, Order>::reserveCapacity() {
+    if (!isLeaf) {
+        childAggregates.reserve(Order + 1);
+    }
+}
+
+template <typename Key, typename Value, typename Compare, int Order>
+void BasicBPTreeNode<Key, Value, Compare, Order>::releaseSubtree() {
+    if (!isLeaf) {
+        for (uint32_t i = 0; i < children.size(); ++i) {
+            child(i)->releaseSubtree();
+        }
+    }
+    arena->release(id);
+}
+
+template <typename Key, typename Value, typename Compare, int Order>
+typename BasicBPTreeNode<Key, Value, Compare, Order>::Aggregate
+BasicBPTreeNode<Key, Value, Compare, Order>::summarize() const {
+    Aggregate aggregate;
+    if (isLeaf) {
+        for (size_t i = 0; i < keys.size(); ++i) {
+            aggregate.add(static_cast<double>(keys[i]), records[i]);
+        }
+    } else {
+        for (const Aggregate& childAggregate : childAggregates) {
+            aggregate.merge(childAggregate);
+        }
+    }
+    return aggregate;
+}
+
+template <typename Key, typename Value, typename Compare, int Order>
+void BasicBPTreeNode<Key, Value, Compare, Order>::rebuildAggregates() {
+    if (isLeaf) {
+        return;
+    }
+    childAggregates.clear();
+    for (uint32_t i = 0; i < children.size(); ++i) {
+        child(i)->rebuildAggregates();
+        childAggregates.push_back(child(i)->summarize());
+    }
+}
+
+template <typename Key, typename Value, typename Compare, int Order>
+int BasicBPTreeNode<Key, Value, Compare, Order>::countNodes() const {
+    int count = 1; // Count this node
+    if (!isLeaf) {
+        for (uint32_t i = 0; i < children.size(); ++i) {
+            count += child(i)->countNodes();
+        }
+    }
+    return count;
+}
+
+// Compute the height of the tree
+template <typename Key, typename Value, typename Compare, int Order>
+int BasicBPTreeNode<Key, Value, Compare, Order>::computeHeight() const {
+    if (isLeaf) {
+        return 1;
+    } else {
+        // Since it's a balanced tree, all children have the same height
+        return 1 + child(0)->computeHeight();
+    }
+}
+
+template <typename Key, typename Value, typename Compare, int Order>
+void BasicBPTreeNode<Key, Value, Compare, Order>::insertNonFull(const Key& key, const Value& value, Disk& disk) {
+    // Find the position to insert the key
+    uint32_t i = Search::lowerBound(keys, key);
+    if (dirty || imageId == 0 || appendedSinceImage.size() >= static_cast<size_t>(Order)) {
+        dirty = true;
+    } else {
+        appendedSinceImage.push_back(std::make_pair(key, value));
+    }
+
+    if (i < keys.size() && !Compare()(key, keys[i])) {
+        // Key exists, append the value
+        records.append(i, value);
+    } else {
+        // Insert new key and value
+        keys.insert(keys.begin() + i, key);
+        records.insert(i, value);
+    }
+}
+
+template <typename Key, typename Value, typename Compare, int Order>
+void BasicBPTreeNode<Key, Value, Compare, Order>::splitChild(int i, Node* y, Disk& disk) {
+    int mid = y->keys.size() / 2;
+    Node* z = newNode(y->isLeaf);
+    dirty = true;
+    y->dirty = true;
+
+    if (y->isLeaf) {
+        // Split keys and records
+        z->keys.assign(y->keys.begin() + mid, y->keys.end());
+        z->records.insert(0, y->records, mid, y->records.size());
+
+        y->keys.resize(mid);
+        y->records.resize(mid);
+
+        // Update nextLeaf links
+        z->nextLeaf = y->nextLeaf;
+        y->nextLeaf = z->id;
+
+        // Insert new child
+        children.insert(children.begin() + i + 1, z->id);
+
+        // Promote key to parent
+        keys.insert(keys.begin() + i, z->keys[0]);
+    } else {
+        // Internal node splitting
+        Key midKey = y->keys[mid];
+
+        z->keys.assign(y->keys.begin() + mid + 1, y->keys.end());
+        z->children.assign(y->children.begin() + mid + 1, y->children.end());
+        z->childAggregates.assign(y->childAggregates.begin() + mid + 1, y->childAggregates.end());
+
+        y->keys.resize(mid);
+        y->children.resize(mid + 1);
+        y->childAggregates.resize(mid + 1);
+
+        children.insert(children.begin() + i + 1, z->id);
+        keys.insert(keys.begin() + i, midKey);
+    }
+
+    // The two halves replace y's aggregate
+    childAggregates[i] = y->summarize();
+    childAggregates.insert(childAggregates.begin() + i + 1, z->summarize());
+}
+
+// Traverse the B+ Tree
+template <typename Key, typename Value, typename Compare, int Order>
+void BasicBPTreeNode<Key, Value, Compare, Order>::traverse(Disk& disk) {
+    for (int i = 0; i < keys.size(); i++) {
+        if (!isLeaf) {
+            child(i)->traverse(disk);
+        }
+        std::cout << " " << keys[i];
+    }
+    if (!isLeaf) {
+        child(keys.size())->traverse(disk);
+    }
+}
+
+// Search in B+ Tree
+template <typename Key, typename Value, typename Compare, int Order>
+BasicBPTreeNode<Key, Value, Compare, Order>*
+BasicBPTreeNode<Key, Value, Compare, Order>::search(const Key& key, Disk& disk) {
+    uint32_t i = Search::lowerBound(keys, key);
+    if (i < keys.size() && !Compare()(key, keys[i])) return this;
+    if (isLeaf) return nullptr;
+    return child(i)->search(key, disk);
+}
+
+// Remove the keys in [startKey, endKey] from this subtree, appending their
+// values to removed in key order, and rebalance the children left underfull
+template <typename Key, typename Value, typename Compare, int Order>
+void BasicBPTreeNode<Key, Value, Compare, Order>::removeRange(const Key& startKey, const Key& endKey,
+                                                              std::vector<Value>& removed) {
+    if (isLeaf) {
+        uint32_t first = Search::lowerBound(keys, startKey);
+        uint32_t last = Search::upperBound(keys, endKey);
+        if (first >= last) {
+            return;
+        }
+        for (uint32_t i = first; i < last; ++i) {
+            removed.insert(removed.end(), records[i].begin(), records[i].end());
+        }
+        keys.erase(keys.begin() + first, keys.begin() + last);
+        records.erase(first, last);
+        dirty = true;
+        return;
+    }
+
+    // Children holding startKey and endKey; every child between them lies
+    // entirely inside the range and is dropped without being searched
+    uint32_t first = Search::upperBound(keys, startKey);
+    uint32_t last = Search::upperBound(keys, endKey);
+    child(first)->removeRange(startKey, endKey, removed);
+    refreshChildAggregate(first);
+    if (last != first) {
+        for (uint32_t i = first + 1; i < last; ++i) {
+            child(i)->collectValues(removed);
+            child(i)->releaseSubtree();
+        }
+        child(last)->removeRange(startKey, endKey, removed);
+        refreshChildAggregate(last);
+
+        // Unlink the dropped leaves and the subtrees above them
+        child(first)->rightmostLeaf()->nextLeaf = child(last)->leftmostLeaf()->id;
+        children.erase(children.begin() + first + 1, children.begin() + last);
+        childAggregates.erase(childAggregates.begin() + first + 1, childAggregates.begin() + last);
+        keys.erase(keys.begin() + first, keys.begin() + last - 1);
+        dirty = true;
+    }
+    rebalanceChildren();
+}
+
+template <typename Key, typename Value, typename Compare, int Order>
+void BasicBPTreeNode<Key, Value, Compare, Order>::collectValues(std::vector<Value>& values) const {
+    if (isLeaf) {
+        for (uint32_t i = 0; i < records.size(); ++i) {
+            values.insert(values.end(), records[i].begin(), records[i].end());
+        }
+        return;
+    }
+    for (uint32_t i = 0; i < children.size(); ++i) {
+        child(i)->collectValues(values);
+    }
+}
+
+template <typename Key, typename Value, typename Compare, int Order>
+bool BasicBPTreeNode<Key, Value, Compare, Order>::isUnderfull() const {
+    return isLeaf ? keys.size() < MIN_LEAF_KEYS : children.size() < MIN_CHILDREN;
+}
+
+// Bring every underfull child back to the minimum fill. A single child cannot
+// be fixed here; the parent rebalances this node instead.
+template <typename Key, typename Value, typename Compare, int Order>
+void BasicBPTreeNode<Key, Value, Compare, Order>::rebalanceChildren() {
+    if (isLeaf) {
+        return;
+    }
+    uint32_t i = 0;
+    while (i < children.size() && children.size() > 1) {
+        if (child(i)->isUnderfull()) {
+            i = fixChild(i);
+        } else {
+            i++;
+        }
+    }
+}
+
+// Merge child i with a sibling if both fit in one node, otherwise borrow just
+// enough entries from the sibling. Returns the index to check again.
+template <typename Key, typename Value, typename Compare, int Order>
+uint32_t BasicBPTreeNode<Key, Value, Compare, Order>::fixChild(uint32_t i) {
+    uint32_t left = i > 0 ? i - 1 : 0;   // Prefer the left sibling
+    Node* a = child(left);
+    Node* b = child(left + 1);
+    dirty = true;
+    a->dirty = true;
+    b->dirty = true;
+
+    if (a->isLeaf) {
+        if (a->keys.size() + b->keys.size() <= Order - 1) {
+            a->keys.insert(a->keys.end(), b->keys.begin(), b->keys.end());
+            a->records.insert(a->records.size(), b->records, 0, b->records.size());
+            a->nextLeaf = b->nextLeaf;
+            keys.erase(keys.begin() + left);
+            children.erase(children.begin() + left + 1);
+            childAggregates.erase(childAggregates.begin() + left + 1);
+            b->releaseSubtree();
+            refreshChildAggregate(left);
+            return left;
+        }
+        if (left == i) {
+            // Borrow the smallest keys of the right sibling
+            uint32_t need = MIN_LEAF_KEYS - a->keys.size();
+            a->keys.insert(a->keys.end(), b->keys.begin(), b->keys.begin() + need);
+            a->records.insert(a->records.size(), b->records, 0, need);
+            b->keys.erase(b->keys.begin(), b->keys.begin() + need);
+            b->records.erase(0, need);
+        } else {
+            // Borrow the largest keys of the left sibling
+            uint32_t need = MIN_LEAF_KEYS - b->keys.size();
+            b->keys.insert(b->keys.begin(), a->keys.end() - need, a->keys.end());
+            b->records.insert(0, a->records, a->records.size() - need, a->records.size());
+            a->keys.resize(a->keys.size() - need);
+            a->records.resize(a->records.size() - need);
+        }
+        keys[left] = b->keys[0];
+        refreshChildAggregate(left);
+        refreshChildAggregate(left + 1);
+        return i;
+    }
+
+    // Internal nodes: the separator in this node moves down between the two
+    if (a->children.size() + b->children.size() <= Order) {
+        a->keys.push_back(keys[left]);
+        a->keys.insert(a->keys.end(), b->keys.begin(), b->keys.end());
+        a->children.insert(a->children.end(), b->children.begin(), b->children.end());
+        a->childAggregates.insert(a->childAggregates.end(), b->childAggregates.begin(), b->childAggregates.end());
+        keys.erase(keys.begin() + left);
+        children.erase(children.begin() + left + 1);
+        childAggregates.erase(childAggregates.begin() + left + 1);
+        b->children.clear();   // Now a's
+        b->releaseSubtree();
+        // The children that now meet in the middle may themselves be underfull
+        a->rebalanceChildren();
+        refreshChildAggregate(left);
+        return left;
+    }
+    if (left == i) {
+        uint32_t need = MIN_CHILDREN - a->children.size();
+        a->keys.push_back(keys[left]);
+        a->keys.insert(a->keys.end(), b->keys.begin(), b->keys.begin() + need - 1);
+        a->children.insert(a->children.end(), b->children.begin(), b->children.begin() + need);
+        a->childAggregates.insert(a->childAggregates.end(), b->childAggregates.begin(),
+                                  b->childAggregates.begin() + need);
+        keys[left] = b->keys[need - 1];
+        b->keys.erase(b->keys.begin(), b->keys.begin() + need);
+        b->children.erase(b->children.begin(), b->children.begin() + need);
+        b->childAggregates.erase(b->childAggregates.begin(), b->childAggregates.begin() + need);
+    } else {
+        uint32_t need = MIN_CHILDREN - b->children.size();
+        b->keys.insert(b->keys.begin(), keys[left]);
+        b->keys.insert(b->keys.begin(), a->keys.end() - (need - 1), a->keys.end());
+        b->children.insert(b->children.begin(), a->children.end() - need, a->children.end());
+        b->childAggregates.insert(b->childAggregates.begin(), a->childAggregates.end() - need,
+                                  a->childAggregates.end());
+        keys[left] = a->keys[a->keys.size() - need];
+        a->keys.resize(a->keys.size() - need);
+        a->children.resize(a->children.size() - need);
+        a->childAggregates.resize(a->childAggregates.size() - need);
+    }
+    a->rebalanceChildren();
+    b->rebalanceChildren();
+    refreshChildAggregate(left);
+    refreshChildAggregate(left + 1);
+    return i;
+}
+
+template <typename Key, typename Value, typename Compare, int Order>
+BasicBPTreeNode<Key, Value, Compare, Order>*
+BasicBPTreeNode<Key, Value, Compare, Order>::leftmostLeaf() {
+    Node* node = this;
+    while (!node->isLeaf) {
+        node = node->child(0);
+    }
+    return node;
+}
+
+template <typename Key, typename Value, typename Compare, int Order>
+BasicBPTreeNode<Key, Value, Compare, Order>*
+BasicBPTreeNode<Key, Value, Compare, Order>::rightmostLeaf() {
+    Node* node = this;
+    while (!node->isLeaf) {
+        node = node->child(node->children.size() - 1);
+    }
+    return node;
+}
+
+// Every key in this subtree must lie in [lowKey, highKey); null means unbounded
+template <typename Key, typename Value, typename Compare, int Order>
+bool BasicBPTreeNode<Key, Value, Compare, Order>::checkNode(const Key* lowKey, const Key* highKey, bool isRoot,
+                                                            int depth, int& leafDepth,
+                                                            std::vector<const Node*>& leaves) const {
+    Compare less;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if (i > 0 && !less(keys[i - 1], keys[i])) {
+            std::cerr << "Error: Keys are not strictly increasing at depth " << depth << std::endl;
+            return false;
+        }
+        if ((lowKey && less(keys[i], *lowKey)) || (highKey && !less(keys[i], *highKey))) {
+            std::cerr << "Error: Key " << keys[i] << " lies outside its separators at depth " << depth << std::endl;
+            return false;
+        }
+    }
+
+    if (isLeaf) {
+        if (records.size() != keys.size() || keys.size() > Order - 1 || (!isRoot && keys.size() < MIN_LEAF_KEYS)) {
+            std::cerr << "Error: Leaf at depth " << depth << " holds " << keys.size() << " keys" << std::endl;
+            return false;
+        }
+        if (leafDepth >= 0 && leafDepth != depth) {
+            std::cerr << "Error: Leaves at depths " << leafDepth << " and " << depth << std::endl;
+            return false;
+        }
+        leafDepth = depth;
+        leaves.push_back(this);
+        return true;
+    }
+
+    if (children.size() != keys.size() + 1 || children.size() > Order ||
+        children.size() < (isRoot ? 2u : MIN_CHILDREN)) {
+        std::cerr << "Error: Internal node at depth " << depth << " has " << children.size() << " children" << std::endl;
+        return false;
+    }
+    if (childAggregates.size() != children.size()) {
+        std::cerr << "Error: Internal node at depth " << depth << " has " << childAggregates.size()
+                  << " child aggregates for " << children.size() << " children" << std::endl;
+        return false;
+    }
+    for (size_t i = 0; i < children.size(); ++i) {
+        Aggregate actual = child(i)->summarize();
+        for (int c = 0; c < Aggregate::COLUMNS; ++c) {
+            const ColumnAggregate& stored = childAggregates[i].columns[c];
+            const ColumnAggregate& expected = actual.columns[c];
+            if (stored.count != expected.count || stored.min != expected.min || stored.max != expected.max ||
+                std::fabs(stored.sum - expected.sum) > 1e-9 * std::max(1.0, std::fabs(expected.sum))) {
+                std::cerr << "Error: Stale aggregate of child " << i << " at depth " << depth << std::endl;
+                return false;
+            }
+        }
+    }
+    for (size_t i = 0; i < children.size(); ++i) {
+        const Key* childLow = i == 0 ? lowKey : &keys[i - 1];
+        const Key* childHigh = i == keys.size() ? highKey : &keys[i];
+        if (!child(i)->checkNode(childLow, childHigh, false, depth + 1, leafDepth, leaves)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Serialization of BPTreeNode with file pointer checks
+template <typename Key, typename Value, typename Compare, int Order>
+void BasicBPTreeNode<Key, Value, Compare, Order>::serialize(std::ofstream& outFile) const {
+    TRACE("Serializing node at file pointer: " << outFile.tellp());
+
+    outFile.write(reinterpret_cast<const char*>(&isLeaf), sizeof(isLeaf));
+    uint32_t numKeys = keys.size();
+    outFile.write(reinterpret_cast<const char*>(&numKeys), sizeof(numKeys));
+
+    // Serialize keys
+    for (const Key& key : keys) {
+        outFile.write(reinterpret_cast<const char*>(&key), sizeof(key));
+    }
+
+    if (isLeaf) {
+        // Serialize records
+        for (uint32_t i = 0; i < records.size(); ++i) {
+            uint32_t numRecords = records[i].size();
+            outFile.write(reinterpret_cast<const char*>(&numRecords), sizeof(numRecords));
+            for (const Value& record : records[i]) {
+                outFile.write(reinterpret_cast<const char*>(&record), sizeof(record));
+            }
+        }
+    } else {
+        // Serialize children
+        for (uint32_t i = 0; i < children.size(); ++i) {
+            child(i)->serialize(outFile);
+        }
+    }
+
+    TRACE("Node serialization complete at file pointer: " << outFile.tellp());
+}
+
+template <typename Key, typename Value, typename Compare, int Order>
+void BasicBPTreeNode<Key, Value, Compare, Order>::deserialize(std::ifstream& inFile,
+                                                              std::vector<Node*>& leafNodes) {
+    TRACE("Deserializing node at file pointer: " << inFile.tellg());
+
+    // Read if node is a leaf
+    inFile.read(reinterpret_cast<char*>(&isLeaf), sizeof(isLeaf));
+    if (!inFile) {
+        std::cerr << "[ERROR] Failed to read isLeaf flag.\n";
+        return;
+    }
+    reserveCapacity();
+
+    // Read number of keys
+    uint32_t numKeys;
+    inFile.read(reinterpret_cast<char*>(&numKeys), sizeof(numKeys));
+    if (!inFile || numKeys > Order || (numKeys == 0 && !isLeaf)) {
+        std::cerr << "[ERROR] Invalid numKeys: " << numKeys << " at file pointer: " << inFile.tellg() << "\n";
+        return;
+    }
+
+    // Deserialize keys
+    keys.resize(numKeys);
+    for (Key& key : keys) {
+        inFile.read(reinterpret_cast<char*>(&key), sizeof(key));
+    }
+
+    if (isLeaf) {
+        // Deserialize records; every key has at least one
+        std::vector<Value> recordList;
+        records.reserve(numKeys);
+        for (uint32_t i = 0; i < numKeys; ++i) {
+            uint32_t numRecords;
+            inFile.read(reinterpret_cast<char*>(&numRecords), sizeof(numRecords));
+            if (!inFile) {
+                std::cerr << "[ERROR] Failed to read the record count of key " << i << ".\n";
+                return;
+            }
+            recordList.resize(numRecords);
+            inFile.read(reinterpret_cast<char*>(recordList.data()), numRecords * sizeof(Value));
+            records.push_back(recordList.data(), numRecords);
+        }
+        // Collect leaf nodes
+        leafNodes.push_back(this);
+    } else {
+        // Deserialize children, each allocated as the kind its first byte (isLeaf) says
+        for (uint32_t i = 0; i <= numKeys; ++i) {
+            Node* node = newNode(inFile.peek() == 1);
+            children.push_back(node->id);
+            node->deserialize(inFile, leafNodes);
+        }
+    }
+
+    TRACE("Node deserialization complete at file pointer: " << inFile.tellg());
+}
+
+// BPTree Constructor
+template <typename Key, typename Value, typename Compare, int Order>
+BasicBPTree<Key, Value, Compare, Order>::BasicBPTree() {
+    root = newNode(true);
+}
+
+template <typename Key, typename Value, typename Compare, int Order>
+void BasicBPTree<Key, Value, Compare, Order>::clear() {
+    arena.clear();
+    root = newNode(true);
+}
+
+// Get the total number of nodes in the B+ Tree
+template <typename Key, typename Value, typename Compare, int Order>
+int BasicBPTree<Key, Value, Compare, Order>::getNumberOfNodes() const {
+    if (root != nullptr) {
+        return root->countNodes();
+    }
+    return 0;
+}
+
+// Get the height (number of levels) of the B+ Tree
+template <typename Key, typename Value, typename Compare, int Order>
+int BasicBPTree<Key, Value, Compare, Order>::getHeight() const {
+    if (root != nullptr) {
+        return root->computeHeight();
+    }
+    return 0;
+}
+
+// Node slots in use, plus what each node holds outside its slot
+template <typename Key, typename Value, typename Compare, int Order>
+size_t BasicBPTree<Key, Value, Compare, Order>::getMemoryUsage() const {
+    size_t bytes = arena.liveNodes() * sizeof(Node);
+    std::vector<const Node*> pending(1, root);
+    while (!pending.empty()) {
+        const Node* node = pending.back();
+        pending.pop_back();
+        bytes += node->records.capacityBytes() + node->childAggregates.capacity() * sizeof(Aggregate);
+        if (!node->isLeaf) {
+            for (uint32_t i = 0; i < node->children.size(); ++i) {
+                pending.push_back(node->child(i));
+            }
+        }
+    }
+    return bytes;
+}
+
+// Print the keys of the root node
+template <typename Key, typename Value, typename Compare, int Order>
+void BasicBPTree<Key, Value, Compare, Order>::printRootKeys() const {
+    if (root != nullptr) {
+        std::cout << "Keys in root node: ";
+        for (const Key& key : root->keys) {
+            std::cout << key << " ";
+        }
+        std::cout << std::endl;
+    } else {
+        std::cout << "The B+ Tree is empty." << std::endl;
+    }
+}
+
+// Insert into the B+ Tree
+template <typename Key, typename Value, typename Compare, int Order>
+void BasicBPTree<Key, Value, Compare, Order>::insert(const Key& key, const Value& value, Disk& disk) {
+    STATS_TIMER(timer, stats.insertLatency);
+    STATS_ADD(stats.inserts, 1);
+    while (!tryInsert(key, value, disk)) {
+    }
+    STATS_ADD(stats.leavesVisited, 1);
+}
+
+// Descend without latching, splitting full nodes on the way down like the
+// single-threaded insert did. A split latches the parent and the full child,
+// a plain insert only the leaf; after a split, or whenever a version check
+// fails, the attempt gives up and insert starts again from the root.
+template <typename Key, typename Value, typename Compare, int Order>
+bool BasicBPTree<Key, Value, Compare, Order>::tryInsert(const Key& key, const Value& value, Disk& disk) {
+    uint64_t rootVersion = rootLatch.readLock();
+    Node* node = root;
+    uint64_t version = node->latch.readLock();
+    if (!rootLatch.validate(rootVersion)) {
+        return false;
+    }
+    STATS_ADD(stats.nodesVisited, 1);
+
+    if (node->isFull()) {
+        // Grow the tree: a new root above the old one, which is split in two
+        if (!rootLatch.tryUpgrade(rootVersion)) {
+            return false;
+        }
+        if (!node->latch.tryUpgrade(version)) {
+            rootLatch.writeUnlock();
+            return false;
+        }
+        Node* s = newNode(false);
+        s->children.push_back(root->id);
+        s->childAggregates.push_back(root->summarize());
+        node->aggregateLatch.writeLock();
+        s->splitChild(0, root, disk);
+        node->aggregateLatch.writeUnlock();
+        root = s;
+        node->latch.writeUnlock();
+        rootLatch.writeUnlock();
+        return false;
+    }
+
+    // Inner nodes passed on the way down, with their versions and the child taken
+    Node* path[MAX_INSERT_DEPTH];
+    uint64_t pathVersions[MAX_INSERT_DEPTH];
+    uint32_t pathChildren[MAX_INSERT_DEPTH];
+    size_t depth = 0;
+
+    while (!node->isLeaf) {
+        uint32_t i = Node::Search::upperBound(node->keys, key);
+        Node* child = node->child(i);
+        if (!node->latch.validate(version) || depth == MAX_INSERT_DEPTH) {
+            return false;
+        }
+        uint64_t childVersion = child->latch.readLock();
+        if (!node->latch.validate(version)) {
+            return false;
+        }
+        STATS_ADD(stats.nodesVisited, 1);
+
+        if (child->isFull()) {
+            if (!node->latch.tryUpgrade(version)) {
+                return false;
+            }
+            if (!child->latch.tryUpgrade(childVersion)) {
+                node->latch.writeUnlock();
+                return false;
+            }
+            node->aggregateLatch.writeLock();
+            child->aggregateLatch.writeLock();
+            node->splitChild(i, child, disk);
+            child->aggregateLatch.writeUnlock();
+            node->aggregateLatch.writeUnlock();
+            child->latch.writeUnlock();
+            node->latch.writeUnlock();
+            return false;
+        }
+        path[depth] = node;
+        pathVersions[depth] = version;
+        pathChildren[depth] = i;
+        depth++;
+        node = child;
+        version = childVersion;
+    }
+
+    if (!node->latch.tryUpgrade(version)) {
+        return false;
+    }
+
+    // Count the value in the aggregates above the leaf first. Only their
+    // latches are taken, top-down, so readers of the inner nodes are not
+    // disturbed; a path node that was split meanwhile sends us back to the
+    // root. The leaf stays latched, so no split can miss the value.
+    for (size_t d = 0; d < depth; ++d) {
+        path[d]->aggregateLatch.writeLock();
+        if (!path[d]->latch.validate(pathVersions[d])) {
+            for (size_t u = 0; u <= d; ++u) {
+                path[u]->aggregateLatch.writeUnlock();
+            }
+            node->latch.writeUnlock();
+            return false;
+        }
+    }
+    for (size_t d = 0; d < depth; ++d) {
+        path[d]->childAggregates[pathChildren[d]].add(static_cast<double>(key), value);
+        path[d]->aggregateLatch.writeUnlock();
+    }
+    node->insertNonFull(key, value, disk);
+    node->latch.writeUnlock();
+    return true;
+}
+
+template <typename Key, typename Value, typename Compare, int Order>
+std::vector<Value> BasicBPTree<Key, Value, Compare, Order>::remove(const Key& key) {
+    return removeRange(key, key);
+}
+
+template <typename Key, typename Value, typename Compare, int Order>
+std::vector<Value> BasicBPTree<Key, Value, Compare, Order>::removeRange(const Key& startKey, const Key& endKey) {
+    STATS_TIMER(timer, stats.removeLatency);
+    STATS_ADD(stats.removes, 1);
+    std::vector<Value> removed;
+    if (Compare()(endKey, startKey)) {
+        return removed;
+    }
+    root->removeRange(startKey, endKey, removed);
+
+    // Merges below may leave the root with a single child
+    while (!root->isLeaf && root->children.size() == 1) {
+        Node* oldRoot = root;
+        root = root->child(0);
+        oldRoot->children.clear();
+        oldRoot->releaseSubtree();
+    }
+    STATS_ADD(stats.entriesRemoved, removed.size());
+    return removed;
+}
+
+template <typename Key, typename Value, typename Compare, int Order>
+bool BasicBPTree<Key, Value, Compare, Order>::checkStructure() const {
+    int leafDepth = -1;
+    std::vector<const Node*> leaves;
+    if (!root->checkNode(nullptr, nullptr, true, 0, leafDepth, leaves)) {
+        return false;
+    }
+    for (size_t i = 0; i < leaves.size(); ++i) {
+        const Node* expected = i + 1 < leaves.size() ? leaves[i + 1] : nullptr;
+        if (leaves[i]->nextLeafNode() != expected) {
+            std::cerr << "Error: Leaf chain is broken after leaf " << i << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Split count items into the fewest groups of at most perGroup items, with
+// group sizes differing by at most one so the last node is never left nearly
+// empty. Groups are merged further if they would drop below minPerGroup.
+inline std::vector<size_t> evenGroupSizes(size_t count, size_t perGroup, size_t minPerGroup) {
+    std::vector<size_t> sizes;
+    if (count == 0) {
+        return sizes;
+    }
+    size_t numGroups = (count + perGroup - 1) / perGroup;
+    if (count / numGroups < minPerGroup) {
+        numGroups = count / minPerGroup > 0 ? count / minPerGroup : 1;
+    }
+    for (size_t g = 0; g < numGroups; ++g) {
+        sizes.push_back(count / numGroups + (g < count % numGroups ? 1 : 0));
+    }
+    return sizes;
+}
+
+template <typename Key, typename Value, typename Compare, int Order>
+bool BasicBPTree<Key, Value, Compare, Order>::bulkLoad(const std::vector<std::pair<Key, Value>>& sortedEntries,
+                                                       double fillFactor) {
+    Compare less;
+    if (fillFactor <= 0.0 || fillFactor > 1.0) {
+        std::cerr << "Error: Bulk load fill factor must be in (0, 1], got " << fillFactor << std::endl;
+        return false;
+    }
+    for (size_t i = 1; i < sortedEntries.size(); ++i) {
+        if (less(sortedEntries[i].first, sortedEntries[i - 1].first)) {
+            std::cerr << "Error: Bulk load input is not sorted at position " << i << std::endl;
+            return false;
+        }
+    }
+
+    // Merge equal keys into one key; key k's values are values[starts[k], starts[k + 1])
+    std::vector<Key> keys;
+    std::vector<Value> values;
+    std::vector<size_t> starts;
+    values.reserve(sortedEntries.size());
+    for (const auto& entry : sortedEntries) {
+        if (keys.empty() || less(keys.back(), entry.first)) {
+            keys.push_back(entry.first);
+            starts.push_back(values.size());
+        }
+        values.push_back(entry.second);
+    }
+    starts.push_back(values.size());
+
+    clear();
+    if (keys.empty()) {
+        return true;
+    }
+
+    // Never below the fill removeRange and checkStructure expect of a node
+    size_t keysPerLeaf = static_cast<size_t>(fillFactor * (Order - 1));
+    size_t childrenPerNode = static_cast<size_t>(fillFactor * Order);
+    if (keysPerLeaf < Node::MIN_LEAF_KEYS) keysPerLeaf = Node::MIN_LEAF_KEYS;
+    if (keysPerLeaf < 1) keysPerLeaf = 1;
+    if (childrenPerNode < Node::MIN_CHILDREN) childrenPerNode = Node::MIN_CHILDREN;
+    if (childrenPerNode < 2) childrenPerNode = 2;
+
+    // Pack the leaves left to right, linking each one to the next
+    std::vector<Node*> level;
+    std::vector<Key> levelMinKeys;   // Smallest key under each node of the level
+    size_t pos = 0;
+    for (size_t count : evenGroupSizes(keys.size(), keysPerLeaf, std::max<size_t>(Node::MIN_LEAF_KEYS, 1))) {
+        Node* leaf = level.empty() ? root : newNode(true);
+        leaf->keys.assign(keys.data() + pos, keys.data() + pos + count);
+        leaf->records.reserve(starts[pos + count] - starts[pos]);
+        for (size_t k = pos; k < pos + count; ++k) {
+            leaf->records.push_back(values.data() + starts[k], static_cast<uint32_t>(starts[k + 1] - starts[k]));
+        }
+        if (!level.empty()) {
+            level.back()->nextLeaf = leaf->id;
+        }
+        level.push_back(leaf);
+        levelMinKeys.push_back(keys[pos]);
+        pos += count;
+    }
+
+    // Build internal levels bottom-up until a single root remains
+    while (level.size() > 1) {
+        std::vector<Node*> parents;
+        std::vector<Key> parentMinKeys;
+        pos = 0;
+        for (size_t count : evenGroupSizes(level.size(), childrenPerNode, std::max<size_t>(Node::MIN_CHILDREN, 2))) {
+            Node* parent = newNode(false);
+            for (size_t i = 0; i < count; ++i) {
+                parent->children.push_back(level[pos + i]->id);
+                parent->childAggregates.push_back(level[pos + i]->summarize());
+            }
+            for (size_t i = 1; i < count; ++i) {
+                parent->keys.push_back(levelMinKeys[pos + i]);
+            }
+            parents.push_back(parent);
+            parentMinKeys.push_back(levelMinKeys[pos]);
+            pos += count;
+        }
+        level.swap(parents);
+        levelMinKeys.swap(parentMinKeys);
+    }
+
+    root = level[0];
+    return true;
+}
+
+// Traverse the B+ Tree
+template <typename Key, typename Value, typename Compare, int Order>
+void BasicBPTree<Key, Value, Compare, Order>::traverse(Disk& disk) {
+    if (root != nullptr) root->traverse(disk);
+}
+
+template <typename Key, typename Value, typename Compare, int Order>
+void BasicBPTree<Key, Value, Compare, Order>::serialize(const std::string& filePath) const {
+    std::ofstream outFile(filePath, std::ios::binary);
+    if (!outFile.is_open()) {
+        std::cerr << "Error: Could not open file for writing the B+ Tree" << std::endl;
+        return;
+    }
+
+    if (root != nullptr) {
+        root->serialize(outFile);
+    }
+
+    outFile.flush();  // Ensure data is flushed to disk before closing
+    TRACE("Flushed the output file.");
+
+    outFile.close();  // Properly close the file to commit the changes to the filesystem
+    if (!outFile) {
+        std::cerr << "[ERROR] There was an issue closing the file properly.\n";
+    } else {
+        TRACE("B+ Tree serialization complete at file pointer: " << outFile.tellp());
+    }
+}
+
+// Deserialize the B+ Tree
+template <typename Key, typename Value, typename Compare, int Order>
+void BasicBPTree<Key, Value, Compare, Order>::deserialize(const std::string& filePath) {
+    std::ifstream inFile(filePath, std::ios::binary);
+    if (!inFile.is_open()) {
+        std::cerr << "Error: Could not open file for reading the B+ Tree" << std::endl;
+        return;
+    }
+    TRACE("Deserializing B+ Tree at file pointer: " << inFile.tellg());
+
+    // Create a vector to hold leaf nodes
+    std::vector<Node*> leafNodes;
+
+    // Deserialize the root node directly
+    clear();
+    root->deserialize(inFile, leafNodes);
+
+    // Link the leaf nodes
+    for (size_t i = 0; i + 1 < leafNodes.size(); ++i) {
+        leafNodes[i]->nextLeaf = leafNodes[i + 1]->id;
+    }
+    if (!leafNodes.empty()) {
+        leafNodes.back()->nextLeaf = INVALID_NODE_ID;
+    }
+
+    // Child aggregates are not stored in the file
+    root->rebuildAggregates();
+
+    inFile.close();
+    TRACE("B+ Tree deserialization complete at file pointer: " << inFile.tellg());
+}
+
+template <typename Key, typename Value, typename Compare, int Order>
+BasicBPTreeNode<Key, Value, Compare, Order>*
+BasicBPTree<Key, Value, Compare, Order>::lockLeafShared(const Key& key) const {
+    for (;;) {
+        uint64_t rootVersion = rootLatch.readLock();
+        Node* node = root;
+        if (!rootLatch.validate(rootVersion)) {
+            continue;
+        }
+        STATS_ADD(stats.nodesVisited, 1);
+        if (node->isLeaf) {
+            node->latch.lockShared();
+            if (rootLatch.validate(rootVersion)) {
+                return node;
+            }
+            node->latch.unlockShared();
+            continue;
+        }
+
+        uint64_t version = node->latch.readLock();
+        if (!rootLatch.validate(rootVersion)) {
+            continue;
+        }
+        for (;;) {
+            uint32_t i = Node::Search::upperBound(node->keys, key);
+            Node* child = node->child(i);
+            if (!node->latch.validate(version)) {
+                break;
+            }
+            STATS_ADD(stats.nodesVisited, 1);
+            if (child->isLeaf) {
+                // Still the right leaf if the parent did not change while we latched it
+                child->latch.lockShared();
+                if (node->latch.validate(version)) {
+                    return child;
+                }
+                child->latch.unlockShared();
+                break;
+            }
+            uint64_t childVersion = child->latch.readLock();
+            if (!node->latch.validate(version)) {
+                break;
+            }
+            node = child;
+            version = childVersion;
+        }
+    }
+}
+
+template <typename Key, typename Value, typename Compare, int Order>
+BasicBPTreeNode<Key, Value, Compare, Order>*
+BasicBPTree<Key, Value, Compare, Order>::findLeafNode(const Key& key) const {
+    Node* leaf = lockLeafShared(key);
+    leaf->latch.unlockShared();
+    return leaf;
+}
+
+template <typename Key, typename Value, typename Compare, int Order>
+std::vector<Value> BasicBPTree<Key, Value, Compare, Order>::search(const Key& key) const {
+    STATS_TIMER(timer, stats.searchLatency);
+    STATS_ADD(stats.searches, 1);
+    STATS_ADD(stats.leavesVisited, 1);
+    std::vector<Value> result;
+    Node* leaf = lockLeafShared(key);
+    uint32_t i = Node::Search::lowerBound(leaf->keys, key);
+    if (i < leaf->keys.size() && !Compare()(key, leaf->keys[i])) {
+        PostingSpan<Value> values = leaf->records[i];
+        result.assign(values.begin(), values.end());
+    }
+    leaf->latch.unlockShared();
+    STATS_ADD(stats.entriesReturned, result.size());
+    return result;
+}
+
+// Latch the next leaf before letting go of this one, so a range scan never
+// sees a leaf halfway through a split
+template <typename Key, typename Value, typename Compare, int Order>
+static BasicBPTreeNode<Key, Value, Compare, Order>* coupleToNextLeaf(BasicBPTreeNode<Key, Value, Compare, Order>* leaf) {
+    BasicBPTreeNode<Key, Value, Compare, Order>* next = leaf->nextLeafNode();
+    if (next) {
+        next->latch.lockShared();
+    }
+    leaf->latch.unlockShared();
+    return next;
+}
+
+template <typename Key, typename Value, typename Compare, int Order>
+std::vector<Value> BasicBPTree<Key, Value, Compare, Order>::rangeQuery(const Key& startKey, const Key& endKey,
+                                                                       Disk& disk) {
+    STATS_TIMER(timer, stats.rangeQueryLatency);
+    STATS_ADD(stats.rangeQueries, 1);
+    std::vector<Value> result;
+    collectRange(startKey, endKey, true, result);
+    STATS_ADD(stats.entriesReturned, result.size());
+    return result;
+}
+
+template <typename Key, typename Value, typename Compare, int Order>
+void BasicBPTree<Key, Value, Compare, Order>::collectRange(const Key& startKey, const Key& endKey, bool includeEndKey,
+                                                           std::vector<Value>& result) const {
+    Compare less;
+
+    // Find the leaf node where the startKey would be
+    Node* currentNode = lockLeafShared(startKey);
+
+    // Skip the keys below startKey in the first leaf
+    size_t first = Node::Search::lowerBound(currentNode->keys, startKey);
+    while (currentNode) {
+        STATS_ADD(stats.leavesVisited, 1);
+        for (size_t i = first; i < currentNode->keys.size(); ++i) {
+            const Key& key = currentNode->keys[i];
+            if (includeEndKey ? less(endKey, key) : !less(key, endKey)) {
+                // We've passed the endKey, can stop the search
+                currentNode->latch.unlockShared();
+                return;
+            }
+            // Add all values for this key to the result
+            PostingSpan<Value> values = currentNode->records[i];
+            result.insert(result.end(), values.begin(), values.end());
+        }
+        // Move to the next leaf node
+        currentNode = coupleToNextLeaf(currentNode);
+        first = 0;
+        if (currentNode) {
+            STATS_ADD(stats.nodesVisited, 1);
+        }
+    }
+}
+
+// Separators are taken from the highest level that has enough of them inside
+// the range, so the split points follow how the keys are actually spread
+template <typename Key, typename Value, typename Compare, int Order>
+std::vector<Key> BasicBPTree<Key, Value, Compare, Order>::splitKeys(const Key& startKey, const Key& endKey,
+                                                                   size_t maxParts) const {
+    Compare less;
+    std::vector<Key> found;
+    if (maxParts < 2 || less(endKey, startKey)) {
+        return found;
+    }
+
+    std::vector<Node*> level;
+    for (;;) {
+        uint64_t rootVersion = rootLatch.readLock();
+        Node* rootNode = root;
+        if (rootLatch.validate(rootVersion)) {
+            level.push_back(rootNode);
+            break;
+        }
+    }
+
+    while (!level.empty()) {
+        found.clear();
+        std::vector<Node*> nextLevel;
+        for (Node* node : level) {
+            // Snapshot the node, retrying if a writer changes it meanwhile
+            std::vector<Key> keys;
+            std::vector<Node*> children;
+            for (;;) {
+                uint64_t version = node->latch.readLock();
+                keys.assign(node->keys.begin(), node->keys.end());
+                children.clear();
+                if (!node->isLeaf) {
+                    for (size_t i = 0; i <= keys.size() && i < node->children.size(); ++i) {
+                        children.push_back(node->child(i));
+                    }
+                }
+                if (node->latch.validate(version)) {
+                    break;
+                }
+            }
+            for (const Key& key : keys) {
+                if (less(startKey, key) && !less(endKey, key)) {
+                    found.push_back(key);
+                }
+            }
+            if (!node->isLeaf) {
+                uint32_t first = Node::Search::upperBound(keys, startKey);
+                uint32_t last = Node::Search::upperBound(keys, endKey);
+                nextLevel.insert(nextLevel.end(), children.begin() + first, children.begin() + last + 1);
+            }
+        }
+        if (found.size() + 1 >= maxParts || nextLevel.empty()) {
+            break;
+        }
+        level.swap(nextLevel);
+    }
+
+    // Evenly spaced picks when there are more separators than needed
+    if (found.size() + 1 > maxParts) {
+        std::vector<Key> picked;
+        for (size_t part = 1; part < maxParts; ++part) {
+            const Key& key = found[part * found.size() / maxParts];
+            if (picked.empty() || less(picked.back(), key)) {
+                picked.push_back(key);
+            }
+        }
+        found.swap(picked);
+    }
+    return found;
+}
+
+template <typename Key, typename Value, typename Compare, int Order>
+size_t BasicBPTree<Key, Value, Compare, Order>::countRange(const Key& startKey, const Key& endKey) const {
+    Compare less;
+    size_t count = 0;
+    Node* currentNode = lockLeafShared(startKey);
+    size_t first = Node::Search::lowerBound(currentNode->keys, startKey);
+    while (currentNode) {
+        for (size_t i = first; i < currentNode->keys.size(); ++i) {
+            if (less(endKey, currentNode->keys[i])) {
+                currentNode->latch.unlockShared();
+                return count;
+            }
+            count += currentNode->records[i].size();
+        }
+        currentNode = coupleToNextLeaf(currentNode);
+        first = 0;
+    }
+    return count;
+}
+
+template <typename Key, typename Value, typename Compare, int Order>
+typename BasicBPTree<Key, Value, Compare, Order>::Aggregate
+BasicBPTree<Key, Value, Compare, Order>::aggregateRange(const Key& startKey, const Key& endKey) const {
+    Aggregate result;
+    if (Compare()(endKey, startKey)) {
+        return result;
+    }
+    for (;;) {
+        result = Aggregate();
+        uint64_t rootVersion = rootLatch.readLock();
+        const Node* rootNode = root;
+        if (rootLatch.validate(rootVersion) &&
+            tryAggregate(rootNode, rootLatch, rootVersion, startKey, endKey, false, false, result)) {
+            return result;
+        }
+    }
+}
+
+// lowInside / highInside say that every key of the subtree is known to be at
+// least startKey / at most endKey, so that bound needs no more checking. A
+// child inside on both sides is taken from the node's child aggregates.
+template <typename Key, typename Value, typename Compare, int Order>
+bool BasicBPTree<Key, Value, Compare, Order>::tryAggregate(const Node* node, const NodeLatch& parentLatch,
+                                                           uint64_t parentVersion, const Key& startKey,
+                                                           const Key& endKey, bool lowInside, bool highInside,
+                                                           Aggregate& result) const {
+    Compare less;
+    STATS_ADD(stats.nodesVisited, 1);
+    if (node->isLeaf) {
+        // Still the right leaf if the parent did not change while we latched it
+        node->latch.lockShared();
+        if (!parentLatch.validate(parentVersion)) {
+            node->latch.unlockShared();
+            return false;
+        }
+        STATS_ADD(stats.leavesVisited, 1);
+        size_t first = lowInside ? 0 : Node::Search::lowerBound(node->keys, startKey);
+        for (size_t i = first; i < node->keys.size() && (highInside || !less(endKey, node->keys[i])); ++i) {
+            result.add(static_cast<double>(node->keys[i]), node->records[i]);
+        }
+        node->latch.unlockShared();
+        return true;
+    }
+
+    uint64_t version = node->latch.readLock();
+    uint64_t aggregateVersion = node->aggregateLatch.readLock();
+    if (!parentLatch.validate(parentVersion)) {
+        return false;
+    }
+    uint32_t numChildren = static_cast<uint32_t>(node->children.size());
+    uint32_t first = lowInside ? 0 : Node::Search::upperBound(node->keys, startKey);
+    uint32_t last = highInside ? numChildren - 1 : Node::Search::upperBound(node->keys, endKey);
+    if (!node->latch.validate(version) || numChildren == 0 || last >= numChildren || first > last) {
+        return false;
+    }
+
+    // Whole children from the stored aggregates first, validated as one read
+    Aggregate inner;
+    for (uint32_t i = first + 1; i < last; ++i) {
+        inner.merge(node->childAggregates[i]);
+    }
+    bool firstWhole = lowInside && (first < last || highInside);
+    bool lastWhole = highInside && last > first;
+    if (firstWhole) {
+        inner.merge(node->childAggregates[first]);
+    }
+    if (lastWhole) {
+        inner.merge(node->childAggregates[last]);
+    }
+    const Node* firstChild = node->child(first);
+    const Node* lastChild = node->child(last);
+    if (!node->aggregateLatch.validate(aggregateVersion) || !node->latch.validate(version)) {
+        return false;
+    }
+    result.merge(inner);
+
+    // Then the one or two children the range boundaries cut through
+    if (!firstWhole && !tryAggregate(firstChild, node->latch, version, startKey, endKey, lowInside,
+                                     highInside || first < last, result)) {
+        return false;
+    }
+    if (last > first && !lastWhole &&
+        !tryAggregate(lastChild, node->latch, version, startKey, endKey, true, highInside, result)) {
+        return false;
+    }
+    return true;
+}
+
+#endif // BPTREE_IMPL_H
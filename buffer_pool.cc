@@ -0,0 +1,296 @@
+// buffer_pool.cc
+#include "buffer_pool.h"
+#include <iostream>
+#include <cstring>
+#include <algorithm>
+
+// Constructor
+BufferPool::BufferPool(Disk& disk, size_t numFrames)
+    : disk(disk),
+      frameData((numFrames == 0 ? 1 : numFrames) * BLOCK_SIZE, 0),
+      frames(numFrames == 0 ? 1 : numFrames),
+      clockHand(0),
+      hits(0),
+      misses(0),
+      evictions(0),
+      writeBacks(0),
+      readAheads(0) {
+    for (Frame& frame : frames) {
+        frame.blockNumber = 0;
+        frame.pinCount = 0;
+        frame.valid = false;
+        frame.dirty = false;
+        frame.referenced = false;
+        frame.loading = false;
+    }
+    pageTable.reserve(frames.size());
+}
+
+// Destructor: dirty blocks must not be lost when the pool goes away
+BufferPool::~BufferPool() {
+    DrainReadAhead();
+    FlushAll();
+}
+
+bool BufferPool::EnableReadAhead(uint32_t queueDepth) {
+    DrainReadAhead();
+    reader = AsyncBlockReader::Create(disk, queueDepth);
+    return reader != nullptr;
+}
+
+// Mark a read-ahead as finished; a failed one leaves the frame free again
+void BufferPool::CompleteReadAhead(size_t frameIndex, bool ok) {
+    Frame& frame = frames[frameIndex];
+    frame.loading = false;
+    if (!ok) {
+        pageTable.erase(frame.blockNumber);
+        frame.valid = false;
+    }
+}
+
+// Wait until the read-ahead into frameIndex has finished; false if it failed
+bool BufferPool::WaitForReadAhead(size_t frameIndex) {
+    while (frames[frameIndex].loading) {
+        uint64_t tag;
+        bool ok;
+        if (!reader->WaitCompletion(tag, ok)) {
+            CompleteReadAhead(frameIndex, false);
+            break;
+        }
+        CompleteReadAhead(static_cast<size_t>(tag), ok);
+    }
+    return frames[frameIndex].valid;
+}
+
+void BufferPool::DrainReadAhead() {
+    uint64_t tag;
+    bool ok;
+    while (reader && reader->WaitCompletion(tag, ok)) {
+        CompleteReadAhead(static_cast<size_t>(tag), ok);
+    }
+}
+
+// Write a dirty frame back to its block on disk
+bool BufferPool::WriteBack(size_t frameIndex) {
+    Frame& frame = frames[frameIndex];
+    if (!frame.valid || !frame.dirty) {
+        return true;
+    }
+    // The disk takes no writes while reads are in flight
+    DrainReadAhead();
+    if (!disk.WriteBlock(frame.blockNumber, FrameBuffer(frameIndex))) {
+        std::cerr << "Error: Buffer pool failed to write back block " << frame.blockNumber << std::endl;
+        return false;
+    }
+    frame.dirty = false;
+    writeBacks++;
+    return true;
+}
+
+// Pick a frame to reuse: a free frame if there is one, otherwise CLOCK over
+// the unpinned frames. Two full sweeps are enough to clear every reference bit.
+bool BufferPool::FindVictim(size_t& frameIndex) {
+    size_t numFrames = frames.size();
+    for (size_t step = 0; step < 2 * numFrames; ++step) {
+        size_t candidate = clockHand;
+        clockHand = (clockHand + 1) % numFrames;
+
+        Frame& frame = frames[candidate];
+        if (!frame.valid) {
+            frameIndex = candidate;
+            return true;
+        }
+        if (frame.pinCount > 0 || frame.loading) {
+            continue;
+        }
+        if (frame.referenced) {
+            frame.referenced = false;
+            continue;
+        }
+
+        if (!WriteBack(candidate)) {
+            return false;
+        }
+        pageTable.erase(frame.blockNumber);
+        frame.valid = false;
+        evictions++;
+        frameIndex = candidate;
+        return true;
+    }
+    return false;
+}
+
+// Claim a frame for blockNumber and pin it
+uint8_t* BufferPool::PinNewFrame(uint32_t blockNumber, bool readFromDisk) {
+    size_t frameIndex;
+    if (!FindVictim(frameIndex)) {
+        std::cerr << "Error: Buffer pool has no unpinned frame for block " << blockNumber << std::endl;
+        return nullptr;
+    }
+
+    uint8_t* buffer = FrameBuffer(frameIndex);
+    if (readFromDisk) {
+        if (!disk.ReadBlock(blockNumber, buffer)) {
+            return nullptr;
+        }
+    } else {
+        std::memset(buffer, 0, BLOCK_SIZE);
+    }
+
+    Frame& frame = frames[frameIndex];
+    frame.blockNumber = blockNumber;
+    frame.pinCount = 1;
+    frame.valid = true;
+    frame.dirty = !readFromDisk;
+    frame.referenced = true;
+    pageTable[blockNumber] = frameIndex;
+    return buffer;
+}
+
+// Pin a block, loading it from disk only on a miss
+uint8_t* BufferPool::FetchBlock(uint32_t blockNumber) {
+    std::unordered_map<uint32_t, size_t>::iterator it = pageTable.find(blockNumber);
+    if (it != pageTable.end() && (!frames[it->second].loading || WaitForReadAhead(it->second))) {
+        Frame& frame = frames[it->second];
+        frame.pinCount++;
+        frame.referenced = true;
+        hits++;
+        disk.RecordCacheHit();
+        return FrameBuffer(it->second);
+    }
+
+    misses++;
+    return PinNewFrame(blockNumber, true);
+}
+
+// Start an asynchronous read of blockNumber into an unpinned frame
+bool BufferPool::PrefetchBlock(uint32_t blockNumber) {
+    if (!reader || reader->GetInFlight() >= reader->GetQueueDepth() || blockNumber >= disk.GetTotalBlocks() ||
+        pageTable.count(blockNumber) != 0) {
+        return false;
+    }
+    size_t frameIndex;
+    if (!FindVictim(frameIndex) || !reader->Submit(blockNumber, 1, FrameBuffer(frameIndex), frameIndex)) {
+        return false;
+    }
+
+    Frame& frame = frames[frameIndex];
+    frame.blockNumber = blockNumber;
+    frame.pinCount = 0;
+    frame.valid = true;
+    frame.dirty = false;
+    frame.referenced = true;
+    frame.loading = true;
+    pageTable[blockNumber] = frameIndex;
+    readAheads++;
+    return true;
+}
+
+// Pin a frame for a block that is about to be overwritten
+uint8_t* BufferPool::NewBlock(uint32_t blockNumber) {
+    std::unordered_map<uint32_t, size_t>::iterator it = pageTable.find(blockNumber);
+    if (it != pageTable.end() && (!frames[it->second].loading || WaitForReadAhead(it->second))) {
+        Frame& frame = frames[it->second];
+        frame.pinCount++;
+        frame.referenced = true;
+        frame.dirty = true;
+        std::memset(FrameBuffer(it->second), 0, BLOCK_SIZE);
+        return FrameBuffer(it->second);
+    }
+    return PinNewFrame(blockNumber, false);
+}
+
+// Release a pin taken by FetchBlock / NewBlock
+bool BufferPool::UnpinBlock(uint32_t blockNumber, bool isDirty) {
+    std::unordered_map<uint32_t, size_t>::iterator it = pageTable.find(blockNumber);
+    if (it == pageTable.end()) {
+        std::cerr << "Error: Block " << blockNumber << " is not in the buffer pool." << std::endl;
+        return false;
+    }
+
+    Frame& frame = frames[it->second];
+    if (frame.pinCount == 0) {
+        std::cerr << "Error: Block " << blockNumber << " is not pinned." << std::endl;
+        return false;
+    }
+    frame.pinCount--;
+    if (isDirty) {
+        frame.dirty = true;
+    }
+    return true;
+}
+
+// Write one cached block back to disk if it is dirty
+bool BufferPool::FlushBlock(uint32_t blockNumber) {
+    std::unordered_map<uint32_t, size_t>::iterator it = pageTable.find(blockNumber);
+    if (it == pageTable.end()) {
+        return true;
+    }
+    return WriteBack(it->second);
+}
+
+// Write every dirty block back to disk; frames holding consecutive blocks are
+// written together with one vectored write
+bool BufferPool::FlushAll() {
+    std::vector<size_t> dirtyFrames;
+    for (size_t i = 0; i < frames.size(); ++i) {
+        if (frames[i].valid && frames[i].dirty) {
+            dirtyFrames.push_back(i);
+        }
+    }
+    std::sort(dirtyFrames.begin(), dirtyFrames.end(), [this](size_t a, size_t b) {
+        return frames[a].blockNumber < frames[b].blockNumber;
+    });
+
+    bool ok = true;
+    size_t i = 0;
+    while (i < dirtyFrames.size()) {
+        size_t runEnd = i + 1;
+        while (runEnd < dirtyFrames.size() &&
+               frames[dirtyFrames[runEnd]].blockNumber == frames[dirtyFrames[i]].blockNumber + (runEnd - i)) {
+            runEnd++;
+        }
+
+        std::vector<const uint8_t*> buffers;
+        for (size_t j = i; j < runEnd; ++j) {
+            buffers.push_back(FrameBuffer(dirtyFrames[j]));
+        }
+        uint32_t firstBlock = frames[dirtyFrames[i]].blockNumber;
+        if (disk.WriteBlocks(firstBlock, buffers.data(), static_cast<uint32_t>(buffers.size()))) {
+            for (size_t j = i; j < runEnd; ++j) {
+                frames[dirtyFrames[j]].dirty = false;
+            }
+            writeBacks += runEnd - i;
+        } else {
+            std::cerr << "Error: Buffer pool failed to write back blocks starting at " << firstBlock << std::endl;
+            ok = false;
+        }
+        i = runEnd;
+    }
+    return ok;
+}
+
+double BufferPool::GetHitRatio() const {
+    uint64_t total = hits + misses;
+    return total == 0 ? 0.0 : static_cast<double>(hits) / total;
+}
+
+void BufferPool::ResetCounters() {
+    hits = 0;
+    misses = 0;
+    evictions = 0;
+    writeBacks = 0;
+    readAheads = 0;
+}
+
+// Function to print buffer pool statistics
+void BufferPool::PrintStatistics() const {
+    std::cout << "Buffer pool statistics:\n";
+    std::cout << "Frames: " << frames.size() << " (" << frames.size() * BLOCK_SIZE / 1024 << " KB)\n";
+    std::cout << "Hits: " << hits << "\n";
+    std::cout << "Misses: " << misses << "\n";
+    std::cout << "Hit ratio: " << GetHitRatio() << "\n";
+    std::cout << "Evictions: " << evictions << "\n";
+    std::cout << "Write-backs: " << writeBacks << "\n";
+    std::cout << "Read-aheads: " << readAheads << "\n";
+}
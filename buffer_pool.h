@@ -0,0 +1,100 @@
+// buffer_pool.h
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include "disk.h"
+#include "async_io.h"
+
+const size_t DEFAULT_BUFFER_POOL_FRAMES = 1024;  // 1024 x 4KB = 4MB of cached blocks
+
+// Fixed-capacity block cache that sits in front of Disk::ReadBlock / WriteBlock.
+// Callers pin a frame with FetchBlock (or NewBlock), work on the returned
+// BLOCK_SIZE bytes in place, and release it with UnpinBlock. Frames that are
+// not pinned are evicted with the CLOCK algorithm; dirty frames are written
+// back to the disk on eviction, FlushBlock / FlushAll, or destruction.
+//
+// With read-ahead enabled, PrefetchBlock starts an asynchronous read straight
+// into a frame for a block the caller expects to fetch soon, e.g. the next
+// leaf of an index scan. The frame cannot be evicted while the read is in
+// flight, and a FetchBlock of the block waits for the read instead of issuing
+// its own.
+class BufferPool {
+private:
+    struct Frame {
+        uint32_t blockNumber;  // Block held by this frame
+        uint32_t pinCount;     // Number of callers currently using the frame
+        bool valid;            // Frame holds a block
+        bool dirty;            // Frame differs from the block on disk
+        bool referenced;       // CLOCK reference bit
+        bool loading;          // Read-ahead into this frame still in flight
+    };
+
+    Disk& disk;
+    std::vector<uint8_t> frameData;                   // numFrames * BLOCK_SIZE bytes
+    std::vector<Frame> frames;
+    std::unordered_map<uint32_t, size_t> pageTable;  // Block number -> frame index
+    size_t clockHand;
+
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t writeBacks;
+    uint64_t readAheads;
+
+    std::unique_ptr<AsyncBlockReader> reader;         // Null unless read-ahead is enabled
+
+    uint8_t* FrameBuffer(size_t frameIndex) { return &frameData[frameIndex * BLOCK_SIZE]; }
+    bool FindVictim(size_t& frameIndex);
+    bool WriteBack(size_t frameIndex);
+    uint8_t* PinNewFrame(uint32_t blockNumber, bool readFromDisk);
+    bool WaitForReadAhead(size_t frameIndex);
+    void CompleteReadAhead(size_t frameIndex, bool ok);
+    void DrainReadAhead();
+
+public:
+    BufferPool(Disk& disk, size_t numFrames = DEFAULT_BUFFER_POOL_FRAMES);
+    ~BufferPool();
+
+    // Pin the frame holding blockNumber, reading it from disk on a miss.
+    // Returns nullptr if the block cannot be read or every frame is pinned.
+    uint8_t* FetchBlock(uint32_t blockNumber);
+
+    // Pin a zeroed frame for a block that the caller is about to overwrite
+    // completely, skipping the disk read. The frame starts out dirty.
+    uint8_t* NewBlock(uint32_t blockNumber);
+
+    // Keep up to queueDepth PrefetchBlock reads in flight from now on
+    bool EnableReadAhead(uint32_t queueDepth = DEFAULT_IO_QUEUE_DEPTH);
+
+    // Start reading blockNumber into a frame without pinning it. Only a hint:
+    // false if read-ahead is off, the block is cached or being read already,
+    // the read queue is full, or no frame can be freed.
+    bool PrefetchBlock(uint32_t blockNumber);
+
+    // Release one pin on blockNumber; isDirty marks the frame for write-back
+    bool UnpinBlock(uint32_t blockNumber, bool isDirty);
+
+    // Write dirty frames back to the disk
+    bool FlushBlock(uint32_t blockNumber);
+    bool FlushAll();
+
+    // Hit/miss counters for sizing the pool. A fetch of a block brought in by
+    // read-ahead counts as a hit; misses are the fetches that read synchronously.
+    uint64_t GetHits() const { return hits; }
+    uint64_t GetMisses() const { return misses; }
+    uint64_t GetEvictions() const { return evictions; }
+    uint64_t GetWriteBacks() const { return writeBacks; }
+    uint64_t GetReadAheads() const { return readAheads; }
+    double GetHitRatio() const;
+    void ResetCounters();
+    void PrintStatistics() const;
+
+    size_t GetCapacity() const { return frames.size(); }
+};
+
+#endif // BUFFER_POOL_H
@@ -0,0 +1,227 @@
+#include "disk.h"
+#include "bptree.h"
+#include "ingest.h"
+#include "tree_checkpoint.h"
+#include "test_util.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const size_t NEW_GAMES = 300;   // Held back from the initial load and added in batches
+const size_t BATCH = 15;        // New games per checkpoint, about one day of games
+
+static long fileSize(const char* path) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    return file ? static_cast<long>(file.tellg()) : -1;
+}
+
+// Every value of the tree in key order
+static std::vector<RecordId> contents(const BPTree& tree) {
+    std::vector<RecordId> values;
+    tree.collectRange(-std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity(), true, values);
+    return values;
+}
+
+// Open the files into a fresh tree and compare it with expected
+static bool reopenMatches(Disk& disk, const char* imagePath, const char* logPath, const BPTree& expected) {
+    BPTree reopened;
+    BPTreeCheckpoint checkpoint(reopened, disk, imagePath, logPath);
+    return checkpoint.open() && reopened.checkStructure() && contents(reopened) == contents(expected);
+}
+
+static std::vector<RecordId> contents(const UIntBPTree& tree) {
+    std::vector<RecordId> values;
+    tree.collectRange(0, std::numeric_limits<uint32_t>::max(), true, values);
+    return values;
+}
+
+// A tree of many distinct keys, several levels deep, so that internal node
+// images and splits of clean leaves with pending appends are checkpointed.
+// Each session reopens the files into a fresh tree, compares it with a tree
+// that saw the same changes, then adds a large batch, small batches that
+// become leaf appends and a removeRange; the last batch is only logged.
+static bool checkManyKeys(Disk& disk, const char* imagePath, const char* logPath) {
+    const int SESSIONS = 8;
+    std::remove(imagePath);
+    std::remove(logPath);
+    std::mt19937 rng(23);
+    std::uniform_int_distribution<uint32_t> key(0, 4000000);
+    UIntBPTree expected;
+    size_t checkpoints = 0, nodesWritten = 0, leafAppends = 0;
+    for (int session = 0; session <= SESSIONS; ++session) {
+        UIntBPTree tree;
+        UIntBPTreeCheckpoint checkpoint(tree, disk, imagePath, logPath);
+        if (!checkpoint.open() || !tree.checkStructure() || contents(tree) != contents(expected)) {
+            std::cerr << "Error: Reopening session " << session << " did not give back the tree" << std::endl;
+            return false;
+        }
+        if (session == SESSIONS) {
+            std::cout << "Many-key tree: " << tree.getNumberOfNodes() << " nodes, height " << tree.getHeight()
+                      << ", " << checkpoints << " checkpoints wrote " << nodesWritten << " node images and "
+                      << leafAppends << " leaf appends" << std::endl;
+            return tree.getHeight() >= 3 && leafAppends > 0;
+        }
+        for (int round = 0; round < 5; ++round) {
+            for (int i = 0; i < (round == 0 ? 30000 : 300); ++i) {
+                uint32_t k = key(rng);
+                RecordId rid = static_cast<RecordId>(rng());
+                checkpoint.insert(k, rid);
+                expected.insert(k, rid, disk);
+            }
+            if (round == 2) {
+                uint32_t lo = key(rng);
+                if (checkpoint.removeRange(lo, lo + 20000) != expected.removeRange(lo, lo + 20000)) {
+                    std::cerr << "Error: removeRange through the checkpoint differs" << std::endl;
+                    return false;
+                }
+            }
+            if (!checkpoint.syncLog() || (round < 4 && !checkpoint.checkpoint())) {
+                return false;
+            }
+            if (round < 4) {
+                checkpoints++;
+                nodesWritten += checkpoint.getStats().nodesWritten;
+                leafAppends += checkpoint.getStats().leafAppends;
+            }
+        }
+    }
+    return false;
+}
+
+int main(int argc, char* argv[]) {
+    // Load games.txt (or the given file) into a scratch data file
+    const char* dataPath = "checkpoint_disk.db";
+    const char* imagePath = "checkpoint_index.img";
+    const char* logPath = "checkpoint_index.log";
+    const char* fullPath = "checkpoint_full.dat";
+    const char* gamesFile = argc > 1 ? argv[1] : "games.txt";
+    std::remove(dataPath);
+    std::remove(imagePath);
+    std::remove(logPath);
+
+    bool ok = true;
+    {
+        Disk disk(dataPath);
+        std::vector<std::pair<float, RecordId>> entries;
+        IngestStats ingestStats;
+        if (!loadGames(gamesFile, disk, &entries, ingestStats)) {
+            return 1;
+        }
+        if (entries.size() <= NEW_GAMES) {
+            std::cerr << "Error: " << gamesFile << " has too few games" << std::endl;
+            return 1;
+        }
+
+        // The last games of the file come later, a batch at a time
+        std::sort(entries.begin(), entries.end(),
+                  [](const std::pair<float, RecordId>& a, const std::pair<float, RecordId>& b) {
+                      return a.second < b.second;
+                  });
+        std::vector<std::pair<float, RecordId>> newGames(entries.end() - NEW_GAMES, entries.end());
+        entries.resize(entries.size() - NEW_GAMES);
+        std::sort(entries.begin(), entries.end());
+
+        BPTree tree;
+        {
+            BPTreeCheckpoint checkpoint(tree, disk, imagePath, logPath);
+            if (!checkpoint.open() || !tree.bulkLoad(entries) || !checkpoint.checkpoint()) {
+                return 1;
+            }
+            std::cout << "Initial checkpoint: " << checkpoint.getStats().nodesWritten << " nodes, "
+                      << checkpoint.getStats().bytesWritten << " bytes" << std::endl;
+
+            // A batch of new games at a time: log the inserts, then checkpoint
+            size_t batches = 0, nodesWritten = 0, leafAppends = 0, bytesWritten = 0;
+            double checkpointMillis = 0;
+            for (size_t i = 0; i < newGames.size(); i += BATCH) {
+                for (size_t j = i; j < std::min(newGames.size(), i + BATCH); ++j) {
+                    checkpoint.insert(newGames[j].first, newGames[j].second);
+                }
+                Clock::time_point start = Clock::now();
+                if (!checkpoint.syncLog() || !checkpoint.checkpoint()) {
+                    return 1;
+                }
+                checkpointMillis += millisSince(start);
+                batches++;
+                nodesWritten += checkpoint.getStats().nodesWritten;
+                leafAppends += checkpoint.getStats().leafAppends;
+                bytesWritten += checkpoint.getStats().bytesWritten;
+            }
+
+            Clock::time_point start = Clock::now();
+            tree.serialize(fullPath);
+            double serializeMillis = millisSince(start);
+            std::cout << batches << " checkpoints of " << BATCH << " inserts: " << nodesWritten / batches
+                      << " node images and " << leafAppends / batches << " leaf appends, " << bytesWritten / batches
+                      << " bytes, " << checkpointMillis / batches << " ms each\n"
+                      << "serialize of the whole tree: " << fileSize(fullPath) << " bytes, " << serializeMillis
+                      << " ms" << std::endl;
+            std::remove(fullPath);
+
+            // A removeRange rewrites whole nodes, and the file once stale images
+            // outweigh live ones. A rewrite that cannot create its new file has
+            // to leave the image file and the redo log as they were.
+            checkpoint.removeRange(0.45f, 0.46f);
+            if (!checkpoint.syncLog()) {
+                return 1;
+            }
+            std::string tempPath = std::string(imagePath) + ".tmp";
+            long imageSize = fileSize(imagePath), logSize = fileSize(logPath);
+            mkdir(tempPath.c_str(), 0755);
+            std::cout << "Checkpoint with its rewrite blocked:" << std::endl;
+            bool blocked = !checkpoint.checkpoint() && fileSize(imagePath) == imageSize && fileSize(logPath) == logSize;
+            rmdir(tempPath.c_str());
+            if (!blocked || !checkpoint.checkpoint() || !checkpoint.getStats().rewritten) {
+                std::cerr << "Error: A failed rewrite did not leave the checkpoint usable" << std::endl;
+                return 1;
+            }
+            checkpoint.getStats().print();
+
+            // Changes after the last checkpoint are only in the redo log
+            checkpoint.removeRange(0.55f, 0.56f);
+            checkpoint.insert(0.999f, makeRecordId(0, 0));
+            if (!checkpoint.syncLog()) {
+                return 1;
+            }
+        }
+        if (!reopenMatches(disk, imagePath, logPath, tree)) {
+            std::cerr << "Error: The checkpoint and redo log do not give back the tree" << std::endl;
+            ok = false;
+        }
+
+        // An interrupted checkpoint: node images without their marker are ignored
+        {
+            std::ofstream image(imagePath, std::ios::binary | std::ios::app);
+            const char torn[] = {static_cast<char>(CHECKPOINT_NODE_IMAGE), 9, 0, 0, 0, 1, 2};
+            image.write(torn, sizeof(torn));
+        }
+        long tornSize = fileSize(imagePath);
+        if (!reopenMatches(disk, imagePath, logPath, tree) || fileSize(imagePath) >= tornSize) {
+            std::cerr << "Error: A torn checkpoint was not ignored" << std::endl;
+            ok = false;
+        }
+        std::cout << "Reopened from " << fileSize(imagePath) << " bytes of node images and "
+                  << fileSize(logPath) << " bytes of redo log" << std::endl;
+
+        if (!checkManyKeys(disk, imagePath, logPath)) {
+            std::cerr << "Error: The many-key tree did not survive its checkpoints" << std::endl;
+            ok = false;
+        }
+    }
+
+    std::remove(dataPath);
+    std::remove(imagePath);
+    std::remove(logPath);
+    if (!ok) {
+        return 1;
+    }
+    std::cout << "Checkpoint test passed" << std::endl;
+    return 0;
+}
+// Compile with g++ -std=c++11 -O2 -pthread checkpoint_test.cc disk.cc bptree.cc ingest.cc record_block.cc tree_checkpoint.cc -o checkpoint_test
@@ -0,0 +1,210 @@
+// column_scan.cc
+#include "column_scan.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+void ColumnScanStats::print() const {
+    std::cout << "Column scan statistics:\n";
+    std::cout << "Blocks read: " << blocksRead << " (" << paxBlocks << " PAX, " << textPaxBlocks << " text PAX, "
+              << compactBlocks << " compact)\n";
+    std::cout << "Records decoded: " << records << "\n";
+}
+
+// Each decoder walks one column of one block; Stride is the distance between
+// two slots' fields, so the minipage and record-stride variants are all
+// compiled with a constant step. Dense decoders skip the slot list because no
+// slot of the block is deleted; on a PAX block they are plain loads from one
+// contiguous array, which the compiler vectorizes.
+
+template <bool Dense>
+static inline uint32_t slotAt(const uint8_t* slots, uint32_t i) {
+    return Dense ? i : slots[i];
+}
+
+template <size_t Stride, typename T, bool Dense = false>
+static void decodeInteger(const uint8_t* base, const uint8_t* slots, uint32_t n, uint32_t* out) {
+    for (uint32_t i = 0; i < n; ++i) {
+        T value;
+        std::memcpy(&value, base + slotAt<Dense>(slots, i) * Stride, sizeof(T));
+        out[i] = value;
+    }
+}
+
+template <size_t Stride>
+static void decodeDate(const uint8_t* base, const uint8_t* slots, uint32_t n, uint32_t* out) {
+    for (uint32_t i = 0; i < n; ++i) {
+        out[i] = parseGameDate(reinterpret_cast<const char*>(base + slots[i] * Stride), GAME_DATE_EST_SIZE - 1);
+    }
+}
+
+template <size_t Stride, size_t Size>
+static void decodePercent(const uint8_t* base, const uint8_t* slots, uint32_t n, float* out) {
+    for (uint32_t i = 0; i < n; ++i) {
+        const char* text = reinterpret_cast<const char*>(base + slots[i] * Stride);
+        out[i] = text[0] == '\0' ? std::numeric_limits<float>::quiet_NaN() : parsePercent(text, Size - 1);
+    }
+}
+
+template <size_t Stride, bool Dense = false>
+static void decodeWins(const uint8_t* base, const uint8_t* slots, uint32_t n, uint32_t* out) {
+    for (uint32_t i = 0; i < n; ++i) {
+        out[i] = base[slotAt<Dense>(slots, i) * Stride] != 0;
+    }
+}
+
+template <size_t Stride, bool Dense>
+static void decodeThousandths(const uint8_t* base, const uint8_t* slots, uint32_t n, float* out) {
+    for (uint32_t i = 0; i < n; ++i) {
+        uint16_t thousandths;
+        std::memcpy(&thousandths, base + slotAt<Dense>(slots, i) * Stride, sizeof(thousandths));
+        out[i] = thousandths == PCT_MISSING ? std::numeric_limits<float>::quiet_NaN() : thousandths / 1000.0f;
+    }
+}
+
+template <size_t Stride, bool Dense>
+static void decodeTeams(const BlockView& block, const uint8_t* base, const uint8_t* slots, uint32_t n,
+                        uint32_t* out) {
+    uint32_t teams[COMPACT_MAX_TEAMS];
+    for (uint32_t code = 0; code < COMPACT_MAX_TEAMS; ++code) {
+        teams[code] = block.team(static_cast<uint8_t>(code));
+    }
+    for (uint32_t i = 0; i < n; ++i) {
+        out[i] = teams[base[slotAt<Dense>(slots, i) * Stride] % COMPACT_MAX_TEAMS];
+    }
+}
+
+// Decode one column of a compact or PAX block; its fields are binary already
+template <bool Pax, bool Dense>
+static void decodeCompactColumn(const BlockView& block, Column column, ColumnBatch& batch) {
+    const uint8_t* base = block.fieldData(column);
+    const size_t S = COMPACT_RECORD_SIZE;
+    uint32_t n = batch.size;
+    uint32_t* uintOut = batch.uintValues[column];
+    float* floatOut = batch.floatValues[column];
+    switch (column) {
+        case COLUMN_GAME_DATE_EST:
+        case COLUMN_PTS_HOME:
+        case COLUMN_AST_HOME:
+        case COLUMN_REB_HOME:
+            decodeInteger<Pax ? sizeof(uint16_t) : S, uint16_t, Dense>(base, batch.slots, n, uintOut);
+            break;
+        case COLUMN_TEAM_ID_HOME:
+            decodeTeams<Pax ? 1 : S, Dense>(block, base, batch.slots, n, uintOut);
+            break;
+        case COLUMN_FG_PCT_HOME:
+        case COLUMN_FT_PCT_HOME:
+        case COLUMN_FG3_PCT_HOME:
+            decodeThousandths<Pax ? sizeof(uint16_t) : S, Dense>(base, batch.slots, n, floatOut);
+            break;
+        case COLUMN_HOME_TEAM_WINS:
+            decodeWins<Pax ? 1 : S, Dense>(base, batch.slots, n, uintOut);
+            break;
+        default:
+            break;
+    }
+}
+
+// Decode one column of a row or text PAX block with the strides of the block's format
+template <bool Pax>
+static void decodeColumn(const BlockView& block, Column column, ColumnBatch& batch) {
+    const uint8_t* base = block.fieldData(column);
+    const size_t R = RECORD_SIZE_WITH_PADDING;
+    uint32_t n = batch.size;
+    uint32_t* uintOut = batch.uintValues[column];
+    float* floatOut = batch.floatValues[column];
+    switch (column) {
+        case COLUMN_GAME_DATE_EST:
+            decodeDate<Pax ? GAME_DATE_EST_SIZE : R>(base, batch.slots, n, uintOut);
+            break;
+        case COLUMN_TEAM_ID_HOME:
+            decodeInteger<Pax ? sizeof(uint32_t) : R, uint32_t>(base, batch.slots, n, uintOut);
+            break;
+        case COLUMN_PTS_HOME:
+            decodeInteger<Pax ? PTS_HOME_SIZE : R, uint32_t>(base, batch.slots, n, uintOut);
+            break;
+        case COLUMN_FG_PCT_HOME:
+            decodePercent<Pax ? FG_PCT_HOME_SIZE : R, FG_PCT_HOME_SIZE>(base, batch.slots, n, floatOut);
+            break;
+        case COLUMN_FT_PCT_HOME:
+            decodePercent<Pax ? FT_PCT_HOME_SIZE : R, FT_PCT_HOME_SIZE>(base, batch.slots, n, floatOut);
+            break;
+        case COLUMN_FG3_PCT_HOME:
+            decodePercent<Pax ? FG3_PCT_HOME_SIZE : R, FG3_PCT_HOME_SIZE>(base, batch.slots, n, floatOut);
+            break;
+        case COLUMN_AST_HOME:
+            decodeInteger<Pax ? AST_HOME_SIZE : R, uint16_t>(base, batch.slots, n, uintOut);
+            break;
+        case COLUMN_REB_HOME:
+            decodeInteger<Pax ? REB_HOME_SIZE : R, uint16_t>(base, batch.slots, n, uintOut);
+            break;
+        case COLUMN_HOME_TEAM_WINS:
+            decodeWins<Pax ? HOME_TEAM_WINS_SIZE : R>(base, batch.slots, n, uintOut);
+            break;
+        default:
+            break;
+    }
+}
+
+// Constructor
+ColumnScanner::ColumnScanner(Disk& disk, uint32_t maxRunBlocks)
+    : disk(disk), maxRunBlocks(maxRunBlocks == 0 ? 1 : maxRunBlocks) {}
+
+void ColumnScanner::decodeBlock(const BlockView& block, const std::vector<Column>& columns) {
+    // Live slots first, so every column decoder runs over the same list
+    uint32_t count = block.numRecords();
+    batch.size = 0;
+    for (uint32_t slot = 0; slot < count; ++slot) {
+        batch.slots[batch.size] = static_cast<uint8_t>(slot);
+        batch.size += !block.isDeleted(slot);
+    }
+
+    BlockFormat format = block.format();
+    bool dense = batch.size == count;
+    for (Column column : columns) {
+        if (format == BLOCK_FORMAT_PAX && dense) {
+            decodeCompactColumn<true, true>(block, column, batch);
+        } else if (format == BLOCK_FORMAT_PAX) {
+            decodeCompactColumn<true, false>(block, column, batch);
+        } else if (format == BLOCK_FORMAT_COMPACT) {
+            decodeCompactColumn<false, false>(block, column, batch);
+        } else if (format == BLOCK_FORMAT_TEXT_PAX) {
+            decodeColumn<true>(block, column, batch);
+        } else {
+            decodeColumn<false>(block, column, batch);
+        }
+    }
+    stats.paxBlocks += format == BLOCK_FORMAT_PAX;
+    stats.textPaxBlocks += format == BLOCK_FORMAT_TEXT_PAX;
+    stats.compactBlocks += format == BLOCK_FORMAT_COMPACT;
+    stats.records += batch.size;
+}
+
+bool ColumnScanner::scan(uint32_t firstBlock, uint32_t numBlocks, const std::vector<Column>& columns,
+                         const Visitor& visit) {
+    stats = ColumnScanStats();
+    disk.AdviseAccess(Disk::ACCESS_SEQUENTIAL);
+    for (uint32_t block = 0; block < numBlocks; block += maxRunBlocks) {
+        uint32_t runLength = std::min(maxRunBlocks, numBlocks - block);
+
+        // Use the backend's memory directly when it has a view, otherwise read the run
+        const uint8_t* runData = disk.GetBlockView(firstBlock + block);
+        if (!runData) {
+            runBuffer.resize(static_cast<size_t>(maxRunBlocks) * BLOCK_SIZE);
+            if (!disk.ReadBlocks(firstBlock + block, runLength, runBuffer.data())) {
+                std::cerr << "Error: Failed to read data blocks during a column scan." << std::endl;
+                return false;
+            }
+            runData = runBuffer.data();
+        }
+        stats.blocksRead += runLength;
+
+        for (uint32_t b = 0; b < runLength; ++b) {
+            decodeBlock(BlockView(runData + static_cast<size_t>(b) * BLOCK_SIZE), columns);
+            batch.blockNumber = firstBlock + block + b;
+            visit(batch);
+        }
+    }
+    return true;
+}
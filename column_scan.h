@@ -0,0 +1,66 @@
+// column_scan.h
+#ifndef COLUMN_SCAN_H
+#define COLUMN_SCAN_H
+
+#include <vector>
+#include <functional>
+#include "disk.h"
+#include "range_scan.h"
+#include "record_block.h"
+
+// The requested columns of the live records of one block, decoded into one
+// array per column. Integer columns (dates as day numbers) go to uintValues,
+// percentages to floatValues, with NaN where games.txt left them empty.
+// Arrays of columns that were not requested are left untouched.
+struct ColumnBatch {
+    uint32_t blockNumber;
+    uint32_t size;                                        // Live records in the batch
+    uint8_t slots[MAX_RECORDS_PER_BLOCK];                     // Slot of each of them
+    uint32_t uintValues[NUM_COLUMNS][MAX_RECORDS_PER_BLOCK];
+    float floatValues[NUM_COLUMNS][MAX_RECORDS_PER_BLOCK];
+
+    RecordId recordId(uint32_t i) const { return makeRecordId(blockNumber, slots[i]); }
+};
+
+// I/O and work done by one ColumnScanner::scan call
+struct ColumnScanStats {
+    size_t blocksRead;
+    size_t paxBlocks;       // Of those, blocks in the PAX format,
+    size_t textPaxBlocks;   // in the text PAX format
+    size_t compactBlocks;   // and in the compact format
+    size_t records;         // Live records decoded
+
+    ColumnScanStats() : blocksRead(0), paxBlocks(0), textPaxBlocks(0), compactBlocks(0), records(0) {}
+    void print() const;
+};
+
+// Column-at-a-time scan over a range of data blocks. Blocks are read in runs
+// of up to maxRunBlocks (or used in place when the backend has block views),
+// and only the requested columns are decoded, one column at a time for the
+// whole block. On PAX blocks that walks one binary minipage per column; text
+// PAX blocks are walked the same way but parse their text, and row and compact
+// blocks work too, with each column read at the record stride.
+class ColumnScanner {
+public:
+    typedef std::function<void(const ColumnBatch&)> Visitor;
+
+    ColumnScanner(Disk& disk, uint32_t maxRunBlocks = DEFAULT_SCAN_RUN_BLOCKS);
+
+    // Decode the columns of every live record in blocks [firstBlock,
+    // firstBlock + numBlocks) and hand them to visit one block at a time.
+    // Returns false if a block cannot be read.
+    bool scan(uint32_t firstBlock, uint32_t numBlocks, const std::vector<Column>& columns, const Visitor& visit);
+
+    const ColumnScanStats& getStats() const { return stats; }
+
+private:
+    Disk& disk;
+    uint32_t maxRunBlocks;
+    std::vector<uint8_t> runBuffer;   // Allocated on the first read; block views need none
+    ColumnBatch batch;
+    ColumnScanStats stats;
+
+    void decodeBlock(const BlockView& block, const std::vector<Column>& columns);
+};
+
+#endif // COLUMN_SCAN_H
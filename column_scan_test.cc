@@ -0,0 +1,333 @@
+#include "disk.h"
+#include "mapped_disk.h"
+#include "ingest.h"
+#include "column_scan.h"
+#include "range_scan.h"
+#include "record_block.h"
+#include "test_util.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// The whole-table queries: SUM(PTS_home), COUNT(*) WHERE FG_PCT_home
+// BETWEEN 0.45 AND 0.5, and AVG(FT_PCT_home) over the games that have one
+enum Query { QUERY_PTS_SUM, QUERY_FG_PCT_COUNT, QUERY_FT_PCT_AVG, NUM_QUERIES };
+const char* QUERY_NAMES[NUM_QUERIES] = {"SUM(PTS_home)", "COUNT FG_PCT_home in [0.45, 0.5]", "AVG(FT_PCT_home)"};
+const Column QUERY_COLUMNS[NUM_QUERIES] = {COLUMN_PTS_HOME, COLUMN_FG_PCT_HOME, COLUMN_FT_PCT_HOME};
+
+struct Answer {
+    double sum;
+    uint64_t count;
+
+    Answer() : sum(0), count(0) {}
+    double value(Query query) const { return query == QUERY_FT_PCT_AVG ? sum / std::max<uint64_t>(count, 1) : sum; }
+};
+
+// Row at a time: visit every record and call its RecordView getters
+static Answer rowAtATime(Disk& disk, uint32_t numBlocks, Query query) {
+    Answer answer;
+    std::vector<uint8_t> runBuffer(static_cast<size_t>(DEFAULT_SCAN_RUN_BLOCKS) * BLOCK_SIZE);
+    for (uint32_t block = 0; block < numBlocks; block += DEFAULT_SCAN_RUN_BLOCKS) {
+        uint32_t runLength = std::min<uint32_t>(DEFAULT_SCAN_RUN_BLOCKS, numBlocks - block);
+        const uint8_t* runData = disk.GetBlockView(block);
+        if (!runData) {
+            if (!disk.ReadBlocks(block, runLength, runBuffer.data())) {
+                break;
+            }
+            runData = runBuffer.data();
+        }
+        for (uint32_t b = 0; b < runLength; ++b) {
+            BlockView view(runData + static_cast<size_t>(b) * BLOCK_SIZE);
+            for (uint32_t slot = 0; slot < view.numRecords(); ++slot) {
+                if (view.isDeleted(slot)) {
+                    continue;
+                }
+                RecordView record = view.record(slot);
+                if (query == QUERY_PTS_SUM) {
+                    answer.sum += record.ptsHome();
+                } else if (query == QUERY_FG_PCT_COUNT) {
+                    float fgPct = record.fgPctHome();
+                    answer.sum += !record.fgPctMissing() && fgPct >= 0.45f && fgPct <= 0.5f;
+                } else if (!record.ftPctMissing()) {
+                    answer.sum += record.ftPctHome();
+                    answer.count++;
+                }
+            }
+        }
+    }
+    return answer;
+}
+
+// Column at a time: ColumnScanner decodes just the query's column
+static Answer columnAtATime(Disk& disk, uint32_t numBlocks, Query query) {
+    Answer answer;
+    ColumnScanner scanner(disk);
+    Column column = QUERY_COLUMNS[query];
+    scanner.scan(0, numBlocks, std::vector<Column>(1, column), [&](const ColumnBatch& batch) {
+        const uint32_t* uints = batch.uintValues[column];
+        const float* floats = batch.floatValues[column];
+        if (query == QUERY_PTS_SUM) {
+            uint64_t sum = 0;
+            for (uint32_t i = 0; i < batch.size; ++i) {
+                sum += uints[i];
+            }
+            answer.sum += sum;
+        } else if (query == QUERY_FG_PCT_COUNT) {
+            uint32_t count = 0;
+            for (uint32_t i = 0; i < batch.size; ++i) {
+                // NaN (missing) fails both comparisons
+                count += floats[i] >= 0.45f && floats[i] <= 0.5f;
+            }
+            answer.sum += count;
+        } else {
+            // Locals keep the running sum out of memory; the additions stay in row order
+            double sum = answer.sum;
+            uint64_t count = answer.count;
+            for (uint32_t i = 0; i < batch.size; ++i) {
+                if (floats[i] == floats[i]) {
+                    sum += floats[i];
+                    count++;
+                }
+            }
+            answer.sum = sum;
+            answer.count = count;
+        }
+    });
+    return answer;
+}
+
+typedef Answer (*ScanFunction)(Disk&, uint32_t, Query);
+
+static double medianMillis(ScanFunction scan, Disk& disk, uint32_t numBlocks, Query query, Answer& answer) {
+    std::vector<double> millis;
+    for (int r = 0; r < REPEATS; ++r) {
+        Clock::time_point start = Clock::now();
+        answer = scan(disk, numBlocks, query);
+        millis.push_back(millisSince(start));
+    }
+    return medianMillis(millis);
+}
+
+static bool sameAnswer(const Answer& a, const Answer& b, Query query) {
+    return std::fabs(a.value(query) - b.value(query)) <= 1e-9 * std::max(1.0, std::fabs(a.value(query)));
+}
+
+static bool sameRecord(const Record& a, const Record& b) {
+    return a.game_date_day == b.game_date_day && a.team_id_home == b.team_id_home && a.pts_home == b.pts_home &&
+           a.fg_pct_home == b.fg_pct_home && a.ft_pct_home == b.ft_pct_home && a.fg3_pct_home == b.fg3_pct_home &&
+           a.ast_home == b.ast_home && a.reb_home == b.reb_home && a.home_team_wins == b.home_team_wins;
+}
+
+// Records of two files that must hold the same records in the same slots
+static size_t countDiffering(Disk& a, Disk& b, BlockFormat formatA, BlockFormat formatB) {
+    if (a.GetTotalBlocks() != b.GetTotalBlocks()) {
+        return a.GetTotalBlocks() + b.GetTotalBlocks();
+    }
+    std::vector<uint8_t> blockA(BLOCK_SIZE), blockB(BLOCK_SIZE);
+    size_t differing = 0;
+    for (uint32_t block = 0; block < a.GetTotalBlocks(); ++block) {
+        if (!a.ReadBlock(block, blockA.data()) || !b.ReadBlock(block, blockB.data())) {
+            return a.GetTotalBlocks();
+        }
+        BlockView viewA(blockA.data()), viewB(blockB.data());
+        if (viewA.format() != formatA || viewB.format() != formatB || viewA.numRecords() != viewB.numRecords()) {
+            differing++;
+            continue;
+        }
+        for (uint32_t slot = 0; slot < viewA.numRecords(); ++slot) {
+            Record record;
+            Block::deserializeRecord(blockB.data(), slot, record);
+            differing += !sameRecord(viewA.record(slot).toRecord(), record);
+        }
+    }
+    return differing;
+}
+
+// Data files written before the compact format hold row or text PAX blocks,
+// which the tree only reads now; write copies of the compact file in them so
+// scans of old files can be checked and timed
+static void serializeRow(const Record& record, uint8_t* row) {
+    char date[GAME_DATE_EST_SIZE] = {0};
+    formatGameDate(record.game_date_day, date, sizeof(date));
+    std::memcpy(row + GAME_DATE_EST_OFFSET, date, GAME_DATE_EST_SIZE);
+    std::memcpy(row + TEAM_ID_HOME_OFFSET, &record.team_id_home, sizeof(record.team_id_home));
+    std::memcpy(row + PTS_HOME_OFFSET, &record.pts_home, sizeof(record.pts_home));
+    const uint16_t percents[3] = {record.fg_pct_home, record.ft_pct_home, record.fg3_pct_home};
+    const Column percentColumns[3] = {COLUMN_FG_PCT_HOME, COLUMN_FT_PCT_HOME, COLUMN_FG3_PCT_HOME};
+    for (int p = 0; p < 3; ++p) {
+        char text[8] = {0};
+        formatPercent(percents[p], text, FIELD_SIZES[percentColumns[p]]);
+        std::memcpy(row + ROW_FIELD_OFFSETS[percentColumns[p]], text, FIELD_SIZES[percentColumns[p]]);
+    }
+    std::memcpy(row + AST_HOME_OFFSET, &record.ast_home, sizeof(record.ast_home));
+    std::memcpy(row + REB_HOME_OFFSET, &record.reb_home, sizeof(record.reb_home));
+    row[HOME_TEAM_WINS_OFFSET] = record.home_team_wins ? 1 : 0;
+}
+
+static bool writeLegacyFile(Disk& source, Disk& target, BlockFormat format) {
+    std::vector<uint8_t> sourceBlock(BLOCK_SIZE), image(BLOCK_SIZE, 0);
+    uint32_t blockNumber = 0, recordsInBlock = 0;
+    for (uint32_t block = 0; block < source.GetTotalBlocks(); ++block) {
+        if (!source.ReadBlock(block, sourceBlock.data())) {
+            return false;
+        }
+        BlockView view(sourceBlock.data());
+        for (uint32_t slot = 0; slot < view.numRecords(); ++slot) {
+            uint8_t row[RECORD_SIZE_WITH_PADDING] = {0};
+            serializeRow(view.record(slot).toRecord(), row);
+            for (int column = 0; column < NUM_COLUMNS; ++column) {
+                size_t offset = format == BLOCK_FORMAT_ROW
+                                    ? BLOCK_HEADER_SIZE + recordsInBlock * RECORD_SIZE_WITH_PADDING + ROW_FIELD_OFFSETS[column]
+                                    : TEXT_PAX_FIELD_OFFSETS[column] + recordsInBlock * FIELD_SIZES[column];
+                std::memcpy(image.data() + offset, row + ROW_FIELD_OFFSETS[column], FIELD_SIZES[column]);
+            }
+            writeBlockHeader(image.data(), ++recordsInBlock, format);
+            if (recordsInBlock == RECORDS_PER_BLOCK) {
+                if (!target.WriteBlock(blockNumber++, image.data())) {
+                    return false;
+                }
+                std::fill(image.begin(), image.end(), 0);
+                recordsInBlock = 0;
+            }
+        }
+    }
+    return (recordsInBlock == 0 || target.WriteBlock(blockNumber, image.data())) && target.Sync();
+}
+
+int main(int argc, char* argv[]) {
+    // The same games in a row-wise, a text PAX, a compact and a PAX data file
+    const char* gamesFile = argc > 1 ? argv[1] : "games.txt";
+    const char* rowPath = "row_disk.db";
+    const char* textPaxPath = "text_pax_disk.db";
+    const char* compactPath = "compact_disk.db";
+    const char* paxPath = "pax_disk.db";
+    std::remove(rowPath);
+    std::remove(textPaxPath);
+    std::remove(compactPath);
+    std::remove(paxPath);
+
+    bool ok = true;
+    {
+        Disk rowDisk(rowPath);
+        Disk textPaxDisk(textPaxPath);
+        Disk compactDisk(compactPath);
+        Disk paxDisk(paxPath);
+        IngestOptions compactOptions, paxOptions;
+        compactOptions.blockFormat = BLOCK_FORMAT_COMPACT;
+        paxOptions.blockFormat = BLOCK_FORMAT_PAX;
+        IngestStats compactStats, paxStats;
+        if (!ingestGames(gamesFile, compactDisk, compactOptions, nullptr, compactStats) || !compactDisk.Sync() ||
+            !ingestGames(gamesFile, paxDisk, paxOptions, nullptr, paxStats) || !paxDisk.Sync() ||
+            !writeLegacyFile(compactDisk, rowDisk, BLOCK_FORMAT_ROW) ||
+            !writeLegacyFile(compactDisk, textPaxDisk, BLOCK_FORMAT_TEXT_PAX)) {
+            std::cerr << "Error: Failed to load " << gamesFile << std::endl;
+            return 1;
+        }
+
+        // New blocks are always compact or PAX
+        IngestOptions rowOptions;
+        rowOptions.blockFormat = BLOCK_FORMAT_ROW;
+        IngestStats rowStats;
+        uint32_t rowBlocks = rowDisk.GetTotalBlocks();
+        if (ingestGames(gamesFile, rowDisk, rowOptions, nullptr, rowStats) || rowDisk.GetTotalBlocks() != rowBlocks) {
+            std::cerr << "Error: Loading into row blocks succeeded" << std::endl;
+            ok = false;
+        }
+        std::cout << compactStats.records << " records, " << rowDisk.GetTotalBlocks() << " row or text PAX blocks, "
+                  << compactDisk.GetTotalBlocks() << " compact or PAX blocks" << std::endl;
+
+        // Row-at-a-time access must see the same records in the row and text
+        // PAX files, and in the compact and PAX files
+        size_t differing = countDiffering(rowDisk, textPaxDisk, BLOCK_FORMAT_ROW, BLOCK_FORMAT_TEXT_PAX);
+        if (differing != 0) {
+            std::cerr << "Error: " << differing << " records differ between the row and text PAX files" << std::endl;
+            ok = false;
+        }
+        differing = countDiffering(compactDisk, paxDisk, BLOCK_FORMAT_COMPACT, BLOCK_FORMAT_PAX);
+        if (differing != 0) {
+            std::cerr << "Error: " << differing << " records differ between the compact and PAX files" << std::endl;
+            ok = false;
+        }
+
+        // The compact file holds every field exactly as parsed, in file order
+        std::ifstream games(gamesFile);
+        std::string line;
+        std::getline(games, line);
+        differing = 0;
+        std::vector<uint8_t> compactBlock(BLOCK_SIZE);
+        size_t compared = 0;
+        for (uint32_t block = 0; block < compactDisk.GetTotalBlocks() && compactDisk.ReadBlock(block, compactBlock.data());
+             ++block) {
+            BlockView view(compactBlock.data());
+            for (uint32_t slot = 0; slot < view.numRecords(); ++slot) {
+                Record parsed;
+                while (std::getline(games, line) && !parseGameLine(line.data(), line.data() + line.size(), parsed)) {
+                }
+                differing += view.format() != BLOCK_FORMAT_COMPACT || !sameRecord(view.record(slot).toRecord(), parsed);
+                compared++;
+            }
+        }
+        if (compared != compactStats.records || differing != 0) {
+            std::cerr << "Error: " << differing << " of " << compared << " compact records differ from "
+                      << gamesFile << std::endl;
+            ok = false;
+        }
+    }
+
+    // Time the queries on mmap views of the files, so the scans themselves are
+    // measured. Compact and PAX records keep the third decimal the row layout
+    // drops, so the percentage queries are only compared within each encoding.
+    {
+        MappedDisk rowDisk(rowPath);
+        MappedDisk textPaxDisk(textPaxPath);
+        MappedDisk compactDisk(compactPath);
+        MappedDisk paxDisk(paxPath);
+        uint32_t numBlocks = rowDisk.GetTotalBlocks();
+        uint32_t compactBlocks = compactDisk.GetTotalBlocks();
+        for (int q = 0; q < NUM_QUERIES; ++q) {
+            Query query = static_cast<Query>(q);
+            Answer expected, textPaxAnswer, compactExpected, compactAnswer, paxAnswer;
+            double rowMillis = medianMillis(rowAtATime, rowDisk, numBlocks, query, expected);
+            double textPaxMillis = medianMillis(columnAtATime, textPaxDisk, numBlocks, query, textPaxAnswer);
+            double compactRowMillis = medianMillis(rowAtATime, compactDisk, compactBlocks, query, compactExpected);
+            double compactColumnMillis = medianMillis(columnAtATime, compactDisk, compactBlocks, query, compactAnswer);
+            double paxMillis = medianMillis(columnAtATime, paxDisk, compactBlocks, query, paxAnswer);
+            bool same = sameAnswer(textPaxAnswer, expected, query) && sameAnswer(compactAnswer, compactExpected, query) &&
+                        sameAnswer(paxAnswer, compactExpected, query);
+            // The other pairings must agree as well
+            same = sameAnswer(rowAtATime(textPaxDisk, numBlocks, query), expected, query) && same;
+            same = sameAnswer(columnAtATime(rowDisk, numBlocks, query), expected, query) && same;
+            same = sameAnswer(rowAtATime(paxDisk, compactBlocks, query), compactExpected, query) && same;
+            if (query == QUERY_PTS_SUM) {
+                same = sameAnswer(compactExpected, expected, query) && same;
+            }
+            std::cout << QUERY_NAMES[q] << " = " << expected.value(query) << " (compact " << compactExpected.value(query)
+                      << ")\n  row blocks, row at a time: " << rowMillis << " ms\n  text PAX blocks, column at a time: "
+                      << textPaxMillis << " ms\n  compact blocks, row at a time: " << compactRowMillis
+                      << " ms\n  compact blocks, column at a time: " << compactColumnMillis
+                      << " ms\n  PAX blocks, column at a time: " << paxMillis << " ms ("
+                      << rowMillis / std::max(paxMillis, 1e-6) << "x row blocks, "
+                      << compactRowMillis / std::max(paxMillis, 1e-6) << "x compact blocks row at a time)" << std::endl;
+            if (!same) {
+                std::cerr << "Error: Scans of the formats disagree on " << QUERY_NAMES[q] << std::endl;
+                ok = false;
+            }
+        }
+    }
+
+    std::remove(rowPath);
+    std::remove(textPaxPath);
+    std::remove(compactPath);
+    std::remove(paxPath);
+    if (!ok) {
+        return 1;
+    }
+    std::cout << "Column scan test passed" << std::endl;
+    return 0;
+}
+// Compile with g++ -std=c++11 -O2 -pthread column_scan_test.cc disk.cc mapped_disk.cc ingest.cc column_scan.cc record_block.cc -o column_scan_test
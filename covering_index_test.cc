@@ -0,0 +1,101 @@
+#include "disk.h"
+#include "ingest.h"
+#include "record_block.h"
+#include "secondary_index.h"
+#include "test_util.h"
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <tuple>
+#include <vector>
+
+typedef std::tuple<RecordId, uint32_t, bool> Row;   // Id, PTS_home, HOME_TEAM_WINS
+
+// The dashboard columns of each record, in RecordId order
+static std::vector<Row> rows(const std::vector<Record>& records, const std::vector<RecordId>& ids) {
+    std::vector<Row> result;
+    for (size_t i = 0; i < records.size(); ++i) {
+        result.push_back(Row(ids[i], records[i].pts_home, records[i].home_team_wins));
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+static double medianMillis(SecondaryIndexes& indexes, const ColumnRange& range, const std::vector<Column>& columns) {
+    std::vector<double> millis;
+    for (int run = 0; run < REPEATS; ++run) {
+        std::vector<Record> records;
+        Clock::time_point start = Clock::now();
+        indexes.rangeQuery(range, columns, records);
+        millis.push_back(millisSince(start));
+    }
+    return medianMillis(millis);
+}
+
+int main(int argc, char* argv[]) {
+    // Load games.txt (or the given file) into a scratch data file
+    const char* dataPath = "covering_disk.db";
+    const char* gamesFile = argc > 1 ? argv[1] : "games.txt";
+    std::remove(dataPath);
+
+    bool ok = true;
+    {
+        Disk disk(dataPath);
+        IngestStats ingestStats;
+        if (!loadGames(gamesFile, disk, nullptr, ingestStats)) {
+            return 1;
+        }
+
+        // FG_PCT_home indexed with PTS_home and HOME_TEAM_WINS in its leaves, and without
+        std::vector<Column> dashboard = {COLUMN_PTS_HOME, COLUMN_HOME_TEAM_WINS};
+        SecondaryIndexes covering(disk), plain(disk);
+        if (!covering.addIndex(COLUMN_FG_PCT_HOME, dashboard) || !plain.addIndex(COLUMN_FG_PCT_HOME) ||
+            !covering.build(0, disk.GetTotalBlocks()) || !plain.build(0, disk.GetTotalBlocks())) {
+            return 1;
+        }
+        std::cout << covering.getNumRecords() << " records in " << disk.GetTotalBlocks() << " blocks" << std::endl;
+
+        const double bounds[][2] = {{0.3, 0.35}, {0.45, 0.5}, {0.4, 0.6}, {0.0, 1.0}, {0.6, 0.5}};
+        for (const auto& bound : bounds) {
+            ColumnRange range(COLUMN_FG_PCT_HOME, bound[0], bound[1]);
+            std::vector<Record> coveredRecords, fetchedRecords;
+            std::vector<RecordId> coveredIds, fetchedIds;
+            covering.rangeQuery(range, dashboard, coveredRecords, &coveredIds);
+            size_t coveredBlocks = covering.getBlocksFetched();
+            plain.rangeQuery(range, dashboard, fetchedRecords, &fetchedIds);
+            size_t fetchedBlocks = plain.getBlocksFetched();
+            bool same = rows(coveredRecords, coveredIds) == rows(fetchedRecords, fetchedIds) &&
+                        coveredRecords.size() == covering.countRange(range);
+            std::cout << "FG_PCT_home in [" << bound[0] << ", " << bound[1] << "]: " << coveredRecords.size()
+                      << " records, " << coveredBlocks << " data blocks read from the covering index, "
+                      << fetchedBlocks << " without it" << std::endl;
+            if (!same || coveredBlocks != 0) {
+                std::cerr << "Error: The covering index answered differently" << std::endl;
+                ok = false;
+            }
+        }
+
+        // A column the index does not include still has to be read from the records
+        ColumnRange wide(COLUMN_FG_PCT_HOME, 0.4, 0.6);
+        std::vector<Record> records;
+        covering.rangeQuery(wide, std::vector<Column>(1, COLUMN_AST_HOME), records);
+        if (!covering.covers(COLUMN_FG_PCT_HOME, dashboard) ||
+            covering.covers(COLUMN_FG_PCT_HOME, std::vector<Column>(1, COLUMN_AST_HOME)) ||
+            covering.getBlocksFetched() == 0 || records.size() != covering.countRange(wide)) {
+            std::cerr << "Error: A query on AST_home was not read from the data file" << std::endl;
+            ok = false;
+        }
+
+        std::cout << "PTS_home, HOME_TEAM_WINS for FG_PCT_home in [0.4, 0.6]:\n"
+                  << "  from the covering index leaves: " << medianMillis(covering, wide, dashboard) << " ms\n"
+                  << "  index and data blocks: " << medianMillis(plain, wide, dashboard) << " ms" << std::endl;
+    }
+
+    std::remove(dataPath);
+    if (!ok) {
+        return 1;
+    }
+    std::cout << "Covering index test passed" << std::endl;
+    return 0;
+}
+// Compile with g++ -std=c++11 -O2 -pthread covering_index_test.cc disk.cc async_io.cc bptree.cc ingest.cc range_scan.cc record_block.cc secondary_index.cc -o covering_index_test
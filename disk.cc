@@ -2,117 +2,272 @@
 #include "disk.h"
 #include <iostream>
 #include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <climits>
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
 
 // Constructor
 Disk::Disk(const std::string& path) 
     : filePath(path), 
+      fd(-1),
       currentBlock(0), 
       totalRecordsInCurrentBlock(0), 
-      totalBlocks(1), 
-      recordsPerBlock(RECORDS_PER_BLOCK) { // Initialize from record_block.h
-    std::cout << "Attempting to open disk file: " << filePath << std::endl;
+      totalBlocks(0), 
+      recordsPerBlock(static_cast<uint32_t>(::recordsPerBlock(DEFAULT_BLOCK_FORMAT))), // Slots of the format new blocks use
+      pendingFirstBlock(0),
+      pendingBlocks(0),
+      preallocatedBlocks(0),
+      preallocateSupported(true) {
+    TRACE("Opening disk file: " << filePath);
 
     // Open the disk file in read/write mode, create if it doesn't exist
-    diskFile.open(filePath, std::ios::in | std::ios::out | std::ios::binary);
-
-    if (!diskFile.is_open()) {
-        std::cerr << "Error: Could not open disk file: " << filePath << std::endl;
-        std::cerr << "Attempting to create the file." << std::endl;
-
-        // Create the file if it doesn't exist
-        diskFile.clear();
-        diskFile.open(filePath, std::ios::out | std::ios::binary);
-        if (!diskFile.is_open()) {
-            std::cerr << "Error: Could not create disk file: " << filePath << std::endl;
-            return;
-        }
-        std::cout << "File created successfully." << std::endl;
-
-        diskFile.close();
-        // Reopen in read/write mode
-        diskFile.open(filePath, std::ios::in | std::ios::out | std::ios::binary);
-        if (!diskFile.is_open()) {
-            std::cerr << "Error: Could not reopen disk file: " << filePath << std::endl;
-            return;
-        }
-    } else {
-        std::cout << "File opened successfully." << std::endl;
+    fd = ::open(filePath.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        std::cerr << "Error: Could not open disk file: " << filePath << " (" << std::strerror(errno) << ")" << std::endl;
+        return;
+    }
 
-        // Determine total blocks by file size
-        diskFile.seekg(0, std::ios::end);
-        std::streampos fileSize = diskFile.tellg();
-        totalBlocks = static_cast<uint32_t>(fileSize) / BLOCK_SIZE;
-        diskFile.seekg(0, std::ios::beg);
-        std::cout << "Total blocks on disk: " << totalBlocks << std::endl;
+    // Determine total blocks by file size
+    struct stat st;
+    if (fstat(fd, &st) == 0) {
+        totalBlocks = static_cast<uint32_t>(st.st_size / BLOCK_SIZE);
+        preallocatedBlocks = totalBlocks;
     }
+    TRACE("Total blocks on disk: " << totalBlocks);
 }
 
 // Destructor
 Disk::~Disk() {
-    if (diskFile.is_open()) {
-        std::cout << "Closing the disk file: " << filePath << std::endl;
-        diskFile.close();
+    if (fd >= 0) {
+        Sync();
+        TRACE("Closing disk file: " << filePath);
+        ::close(fd);
     }
 }
 
-// Write data to a block
-bool Disk::WriteBlock(uint32_t blockNumber, const uint8_t* buffer) {
-    std::cout << "Writing to block: " << blockNumber << std::endl;
+// Reserve file extents ahead of the write position in large chunks so that
+// appending blocks does not grow the file one block at a time. The file size
+// is left alone, so GetTotalBlocks stays correct when the file is reopened.
+void Disk::Preallocate(uint32_t blockNumber) {
+#ifdef __linux__
+    if (!preallocateSupported || blockNumber < preallocatedBlocks) {
+        return;
+    }
+    uint32_t newAllocated = (blockNumber / DISK_PREALLOCATE_BLOCKS + 1) * DISK_PREALLOCATE_BLOCKS;
+    off_t offset = static_cast<off_t>(preallocatedBlocks) * BLOCK_SIZE;
+    off_t length = static_cast<off_t>(newAllocated - preallocatedBlocks) * BLOCK_SIZE;
+    if (fallocate(fd, FALLOC_FL_KEEP_SIZE, offset, length) != 0) {
+        // Not supported by this file system: the writes extend the file themselves
+        preallocateSupported = false;
+        return;
+    }
+    preallocatedBlocks = newAllocated;
+#else
+    (void)blockNumber;
+#endif
+}
 
-    // Expand the disk file if necessary
-    if (blockNumber >= totalBlocks) {
-        std::cout << "Expanding disk for block number: " << blockNumber << std::endl;
-        diskFile.seekp(0, std::ios::end);
-        uint32_t newBlocks = blockNumber - totalBlocks + 1;
-        char zero = 0;
-        for (uint32_t i = 0; i < newBlocks; ++i) {
-            for (uint32_t j = 0; j < BLOCK_SIZE; ++j) {
-                diskFile.write(&zero, 1); // Write zeros to expand the file
+// Write count consecutive blocks from separate buffers
+bool Disk::WriteBlocks(uint32_t firstBlock, const uint8_t* const* buffers, uint32_t count) {
+    if (fd < 0) {
+        return false;
+    }
+    // Staged blocks in the range are older than these; write them first so a
+    // later flush cannot put them back over the new data
+    if (pendingBlocks > 0 && firstBlock < pendingFirstBlock + pendingBlocks && pendingFirstBlock < firstBlock + count) {
+        if (!FlushPending()) {
+            return false;
+        }
+    }
+    return WriteRun(firstBlock, buffers, count);
+}
+
+// Write count consecutive blocks with as few pwritev calls as possible
+bool Disk::WriteRun(uint32_t firstBlock, const uint8_t* const* buffers, uint32_t count) {
+    STATS_TIMER(timer, stats.writeLatency);
+    TRACE("Writing blocks " << firstBlock << " to " << firstBlock + count - 1);
+    Preallocate(firstBlock + count - 1);
+
+    uint32_t done = 0;
+    while (done < count) {
+        uint32_t batch = std::min<uint32_t>(count - done, IOV_MAX);
+        std::vector<struct iovec> iov(batch);
+        for (uint32_t i = 0; i < batch; ++i) {
+            iov[i].iov_base = const_cast<uint8_t*>(buffers[done + i]);
+            iov[i].iov_len = BLOCK_SIZE;
+        }
+
+        off_t offset = static_cast<off_t>(firstBlock + done) * BLOCK_SIZE;
+        size_t remaining = static_cast<size_t>(batch) * BLOCK_SIZE;
+        struct iovec* next = iov.data();
+        int iovCount = static_cast<int>(batch);
+        while (remaining > 0) {
+            ssize_t written = pwritev(fd, next, iovCount, offset);
+            STATS_ADD(stats.writeCalls, 1);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                std::cerr << "Error: Failed to write blocks starting at " << firstBlock + done
+                          << " (" << std::strerror(errno) << ")" << std::endl;
+                return false;
+            }
+            // Skip the iovecs (or part of one) that were fully written
+            offset += written;
+            remaining -= static_cast<size_t>(written);
+            while (written > 0 && static_cast<size_t>(written) >= next->iov_len) {
+                written -= next->iov_len;
+                next++;
+                iovCount--;
+            }
+            if (written > 0) {
+                next->iov_base = static_cast<uint8_t*>(next->iov_base) + written;
+                next->iov_len -= written;
             }
         }
-        totalBlocks += newBlocks;
-        std::cout << "Disk expanded, new total blocks: " << totalBlocks << std::endl;
+        done += batch;
+    }
+
+    if (firstBlock + count > totalBlocks) {
+        totalBlocks = firstBlock + count;
+    }
+    STATS_ADD(stats.blocksWritten, count);
+    STATS_ADD(stats.bytesWritten, static_cast<uint64_t>(count) * BLOCK_SIZE);
+    return true;
+}
+
+// Write the staged run of blocks. The run stays staged if the write fails, so
+// a later flush or Sync retries it.
+bool Disk::FlushPending() {
+    if (pendingBlocks == 0) {
+        return true;
+    }
+    const uint8_t* buffer = pendingData.data();
+    std::vector<const uint8_t*> buffers(pendingBlocks);
+    for (uint32_t i = 0; i < pendingBlocks; ++i) {
+        buffers[i] = buffer + static_cast<size_t>(i) * BLOCK_SIZE;
+    }
+    if (!WriteRun(pendingFirstBlock, buffers.data(), pendingBlocks)) {
+        return false;
+    }
+    pendingBlocks = 0;
+    return true;
+}
+
+bool Disk::Sync() {
+    if (fd < 0) {
+        return false;
     }
+    bool ok = FlushPending();
+    if (fsync(fd) != 0) {
+        std::cerr << "Error: Failed to sync disk file: " << filePath << std::endl;
+        ok = false;
+    }
+    return ok;
+}
 
-    // Seek to the block and write the data
-    diskFile.seekp(blockNumber * BLOCK_SIZE, std::ios::beg);
-    diskFile.write(reinterpret_cast<const char*>(buffer), BLOCK_SIZE);
-    if (!diskFile) {
-        std::cerr << "Error: Failed to write to block " << blockNumber << std::endl;
+// Write data to a block
+bool Disk::WriteBlock(uint32_t blockNumber, const uint8_t* buffer) {
+    if (fd < 0) {
         return false;
     }
 
-    diskFile.flush();
-    std::cout << "Write operation to block " << blockNumber << " successful." << std::endl;
+    // Rewrite of a block that is still staged
+    if (pendingBlocks > 0 && blockNumber >= pendingFirstBlock && blockNumber < pendingFirstBlock + pendingBlocks) {
+        std::memcpy(&pendingData[static_cast<size_t>(blockNumber - pendingFirstBlock) * BLOCK_SIZE], buffer, BLOCK_SIZE);
+        return true;
+    }
+
+    // Start a new run unless this block extends the staged one
+    bool extendsRun = pendingBlocks > 0 && blockNumber == pendingFirstBlock + pendingBlocks
+                      && pendingBlocks < DISK_WRITE_COMBINE_BLOCKS;
+    if (!extendsRun) {
+        if (!FlushPending()) {
+            return false;
+        }
+        pendingFirstBlock = blockNumber;
+    }
+    if (pendingData.size() < static_cast<size_t>(DISK_WRITE_COMBINE_BLOCKS) * BLOCK_SIZE) {
+        pendingData.resize(static_cast<size_t>(DISK_WRITE_COMBINE_BLOCKS) * BLOCK_SIZE);
+    }
+    std::memcpy(&pendingData[static_cast<size_t>(pendingBlocks) * BLOCK_SIZE], buffer, BLOCK_SIZE);
+    pendingBlocks++;
+
+    // Blocks past the end of the file read as zeros once written
+    if (blockNumber >= totalBlocks) {
+        totalBlocks = blockNumber + 1;
+    }
+    if (pendingBlocks == DISK_WRITE_COMBINE_BLOCKS) {
+        return FlushPending();
+    }
     return true;
 }
 
 // Read data from a block
 bool Disk::ReadBlock(uint32_t blockNumber, uint8_t* buffer) {
-    std::cout << "Reading from block: " << blockNumber << std::endl;
+    return ReadBlocks(blockNumber, 1, buffer);
+}
 
-    if (blockNumber >= totalBlocks) {
-        std::cerr << "Error: Block " << blockNumber << " does not exist." << std::endl;
+// Read a run of consecutive blocks
+bool Disk::ReadBlocks(uint32_t firstBlock, uint32_t count, uint8_t* buffer) {
+    if (fd < 0 || count == 0 || firstBlock + count > totalBlocks) {
+        std::cerr << "Error: Blocks " << firstBlock << " to " << firstBlock + count - 1 << " do not exist." << std::endl;
         return false;
     }
 
-    diskFile.seekg(blockNumber * BLOCK_SIZE, std::ios::beg);
-    diskFile.read(reinterpret_cast<char*>(buffer), BLOCK_SIZE);
-    if (!diskFile) {
-        std::cerr << "Error: Failed to read from block " << blockNumber << std::endl;
-        return false;
+    // Staged writes overlapping the range must reach the file first
+    if (pendingBlocks > 0 && firstBlock < pendingFirstBlock + pendingBlocks && pendingFirstBlock < firstBlock + count) {
+        if (!FlushPending()) {
+            return false;
+        }
     }
-    std::cout << "Read operation from block " << blockNumber << " successful." << std::endl;
+
+    STATS_TIMER(timer, stats.readLatency);
+    TRACE("Reading blocks " << firstBlock << " to " << firstBlock + count - 1);
+    size_t length = static_cast<size_t>(count) * BLOCK_SIZE;
+    size_t done = 0;
+    while (done < length) {
+        ssize_t n = pread(fd, buffer + done, length - done, static_cast<off_t>(firstBlock) * BLOCK_SIZE + done);
+        STATS_ADD(stats.readCalls, 1);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            std::cerr << "Error: Failed to read blocks starting at " << firstBlock << std::endl;
+            return false;
+        }
+        if (n == 0) {
+            // Blocks inside a hole at the end of the file read as zeros
+            std::memset(buffer + done, 0, length - done);
+            break;
+        }
+        done += static_cast<size_t>(n);
+    }
+    STATS_ADD(stats.blocksRead, count);
+    STATS_ADD(stats.bytesRead, length);
     return true;
 }
 
+int Disk::GetReadDescriptor() {
+    if (fd < 0 || !FlushPending()) {
+        return -1;
+    }
+    return fd;
+}
+
 // Get the next free block (dynamic)
 uint32_t Disk::GetNextFreeBlock() {
     if (totalRecordsInCurrentBlock >= recordsPerBlock) {
         // Move to the next block when the current block is full
         currentBlock++;
         totalRecordsInCurrentBlock = 0;  // Reset the record count for the new block
-        std::cout << "Switching to new block: " << currentBlock << std::endl;
+        TRACE("Switching to new block: " << currentBlock);
     }
     return currentBlock;
 }
@@ -120,5 +275,11 @@ uint32_t Disk::GetNextFreeBlock() {
 // Increment the record count for the current block
 void Disk::IncrementRecordCount() {
     totalRecordsInCurrentBlock++;
-    std::cout << "Records in current block: " << totalRecordsInCurrentBlock << "/" << recordsPerBlock << std::endl;
+    TRACE("Records in current block: " << totalRecordsInCurrentBlock << "/" << recordsPerBlock);
+}
+
+// Move record placement to a new, empty block
+void Disk::SetNextFreeBlock(uint32_t blockNumber) {
+    currentBlock = blockNumber;
+    totalRecordsInCurrentBlock = 0;
 }
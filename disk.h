@@ -3,28 +3,69 @@
 #define DISK_H
 
 #include <string>
-#include <fstream>
+#include <vector>
 #include <cstdint>
 #include <iostream>
 #include <cstring>
 #include "record_block.h"  // Include the record and block definitions
+#include "stats.h"
+
+const uint32_t DISK_PREALLOCATE_BLOCKS = 2048;     // File extents are reserved 8MB at a time
+const uint32_t DISK_WRITE_COMBINE_BLOCKS = 64;     // Longest run of staged writes (256KB)
 
 class Disk {
-private:
+protected:
     std::string filePath;
-    std::fstream diskFile;
+    int fd;                               // Disk file descriptor, -1 if not open
     uint32_t currentBlock;                // The block currently being written to
     uint32_t totalRecordsInCurrentBlock;  // Number of records in the current block
     uint32_t totalBlocks;                 // Total number of blocks allocated
-    const uint32_t recordsPerBlock;       // Number of records per block (from record_block.h)
+    const uint32_t recordsPerBlock;       // Number of records per block of DEFAULT_BLOCK_FORMAT
+
+    // Writes are staged here while they extend one run of consecutive blocks
+    // and reach the file in one call when the run breaks, fills up or on Sync
+    std::vector<uint8_t> pendingData;
+    uint32_t pendingFirstBlock;
+    uint32_t pendingBlocks;
+
+    uint32_t preallocatedBlocks;          // Blocks covered by reserved file extents
+    bool preallocateSupported;
+
+    mutable IoStats stats;                // Only counted when built with ENABLE_STATS
+
+    bool FlushPending();
+    bool WriteRun(uint32_t firstBlock, const uint8_t* const* buffers, uint32_t count);
+    void Preallocate(uint32_t blockNumber);
 
 public:
+    // Hint for how blocks are about to be accessed
+    enum AccessPattern { ACCESS_NORMAL, ACCESS_SEQUENTIAL, ACCESS_RANDOM };
+
     Disk(const std::string& path);
-    ~Disk();
+    virtual ~Disk();
+
+    // Write and read methods. Reads may come from several threads at once as
+    // long as no writes are staged (Sync first after writing); the ENABLE_STATS
+    // counters are not kept per thread and may undercount then.
+    virtual bool WriteBlock(uint32_t blockNumber, const uint8_t* buffer);
+    virtual bool ReadBlock(uint32_t blockNumber, uint8_t* buffer);
+
+    // Read count consecutive blocks starting at firstBlock with one sequential read
+    virtual bool ReadBlocks(uint32_t firstBlock, uint32_t count, uint8_t* buffer);
 
-    // Write and read methods
-    bool WriteBlock(uint32_t blockNumber, const uint8_t* buffer);
-    bool ReadBlock(uint32_t blockNumber, uint8_t* buffer);
+    // Write count consecutive blocks from separate buffers with vectored writes
+    virtual bool WriteBlocks(uint32_t firstBlock, const uint8_t* const* buffers, uint32_t count);
+
+    // Durability point: push staged writes to the file and fsync it.
+    // WriteBlock alone does not guarantee the block has reached the disk.
+    virtual bool Sync();
+
+    // Read-only view of a block without copying it, or nullptr when the backend
+    // can only copy blocks out (the file backend always returns nullptr)
+    virtual const uint8_t* GetBlockView(uint32_t blockNumber) const { return nullptr; }
+
+    // Tell the backend how the following reads will walk the file
+    virtual void AdviseAccess(AccessPattern pattern) {}
 
     // Dynamic method to get next free block
     uint32_t GetNextFreeBlock();
@@ -32,10 +73,33 @@ public:
     // Utility method to increment the record count in the current block
     void IncrementRecordCount();
 
+    // Continue record placement at an empty blockNumber, e.g. after a bulk
+    // loader has written whole blocks directly
+    void SetNextFreeBlock(uint32_t blockNumber);
+
     uint32_t GetTotalBlocks() const { return totalBlocks; }
 
+    // I/O counters since the last reset; reset before a query to measure just that query
+    const IoStats& GetStats() const { return stats; }
+    void ResetStats() { stats.reset(); }
+
+    // Called by a cache in front of this disk when it serves a block itself
+    void RecordCacheHit() { STATS_ADD(stats.cacheHits, 1); }
+
+    // File descriptor for readers that issue their own reads (AsyncBlockReader);
+    // staged writes are pushed to the file first so those reads see them.
+    // Returns -1 if the disk is not open or the staged writes cannot be written.
+    int GetReadDescriptor();
+
+    // Called by such a reader for each read it completes without ReadBlocks
+    void RecordExternalRead(uint32_t count) {
+        STATS_ADD(stats.readCalls, 1);
+        STATS_ADD(stats.blocksRead, count);
+        STATS_ADD(stats.bytesRead, static_cast<uint64_t>(count) * BLOCK_SIZE);
+    }
+
     // Check if the disk is open
-    bool isOpen() const { return diskFile.is_open(); }
+    virtual bool isOpen() const { return fd >= 0; }
 };
 
 #endif // DISK_H
@@ -0,0 +1,429 @@
+// disk_bptree.cc
+#include "disk_bptree.h"
+#include "key_search.h"
+#include <iostream>
+#include <cstring>
+
+// Typed accessors over one index page held in a buffer pool frame
+class DiskBPTreePage {
+private:
+    uint8_t* data;
+
+    uint32_t readU32(size_t offset) const {
+        uint32_t v;
+        std::memcpy(&v, data + offset, sizeof(v));
+        return v;
+    }
+    void writeU32(size_t offset, uint32_t v) { std::memcpy(data + offset, &v, sizeof(v)); }
+
+    size_t keyOffset(uint32_t i) const { return DISK_BPTREE_NODE_HEADER_SIZE + i * sizeof(float); }
+    size_t slotOffset(uint32_t i) const {
+        return DISK_BPTREE_NODE_HEADER_SIZE + capacity() * sizeof(float) + i * sizeof(uint32_t);
+    }
+
+public:
+    explicit DiskBPTreePage(uint8_t* data) : data(data) {}
+
+    void init(bool leaf) {
+        std::memset(data, 0, BLOCK_SIZE);
+        data[0] = leaf ? 1 : 0;
+        setNextLeaf(DISK_BPTREE_INVALID_PAGE);
+    }
+
+    bool isLeaf() const { return data[0] != 0; }
+    uint32_t capacity() const { return isLeaf() ? DISK_BPTREE_LEAF_CAPACITY : DISK_BPTREE_INTERNAL_CAPACITY; }
+
+    uint32_t numKeys() const {
+        uint16_t n;
+        std::memcpy(&n, data + 2, sizeof(n));
+        return n;
+    }
+    void setNumKeys(uint32_t n) {
+        uint16_t v = static_cast<uint16_t>(n);
+        std::memcpy(data + 2, &v, sizeof(v));
+    }
+
+    uint32_t nextLeaf() const { return readU32(4); }
+    void setNextLeaf(uint32_t page) { writeU32(4, page); }
+
+    float key(uint32_t i) const {
+        float k;
+        std::memcpy(&k, data + keyOffset(i), sizeof(k));
+        return k;
+    }
+    void setKey(uint32_t i, float k) { std::memcpy(data + keyOffset(i), &k, sizeof(k)); }
+
+    // Leaf value i, or child page i of an internal node
+    uint32_t slot(uint32_t i) const { return readU32(slotOffset(i)); }
+    void setSlot(uint32_t i, uint32_t v) { writeU32(slotOffset(i), v); }
+
+    // Open a gap at pos (leaf: one key and value, internal: key pos and child pos + 1)
+    void insertAt(uint32_t pos, float k, uint32_t v) {
+        uint32_t n = numKeys();
+        uint32_t slotPos = isLeaf() ? pos : pos + 1;
+        uint32_t numSlots = isLeaf() ? n : n + 1;
+        std::memmove(data + keyOffset(pos + 1), data + keyOffset(pos), (n - pos) * sizeof(float));
+        std::memmove(data + slotOffset(slotPos + 1), data + slotOffset(slotPos),
+                     (numSlots - slotPos) * sizeof(uint32_t));
+        setKey(pos, k);
+        setSlot(slotPos, v);
+        setNumKeys(n + 1);
+    }
+
+    // The keys are stored back to back, so they are searched in place
+    const float* keys() const { return reinterpret_cast<const float*>(data + keyOffset(0)); }
+
+    // First key position with key(pos) >= k
+    uint32_t lowerBound(float k) const { return keyLowerBound(keys(), numKeys(), k); }
+
+    // First key position with key(pos) > k
+    uint32_t upperBound(float k) const { return keyUpperBound(keys(), numKeys(), k); }
+};
+
+// Constructor
+DiskBPTree::DiskBPTree(BufferPool& bufferPool)
+    : bufferPool(bufferPool),
+      rootPage(DISK_BPTREE_INVALID_PAGE),
+      height(0),
+      numPages(0),
+      numEntries(0),
+      headerDirty(false) {}
+
+// Destructor: keep the header in step with the pages already in the pool
+DiskBPTree::~DiskBPTree() {
+    if (headerDirty) {
+        writeHeader();
+    }
+}
+
+uint32_t DiskBPTree::allocatePage() {
+    headerDirty = true;
+    return numPages++;
+}
+
+bool DiskBPTree::writeHeader() {
+    uint8_t* data = bufferPool.NewBlock(DISK_BPTREE_HEADER_PAGE);
+    if (!data) {
+        return false;
+    }
+    uint32_t fields[6] = {DISK_BPTREE_MAGIC, DISK_BPTREE_VERSION, rootPage, height, numPages, numEntries};
+    std::memcpy(data, fields, sizeof(fields));
+    bufferPool.UnpinBlock(DISK_BPTREE_HEADER_PAGE, true);
+    headerDirty = false;
+    return true;
+}
+
+// Format an empty index: header page followed by an empty root leaf
+bool DiskBPTree::create() {
+    numPages = 1;
+    numEntries = 0;
+    rootPage = allocatePage();
+    height = 1;
+
+    uint8_t* data = bufferPool.NewBlock(rootPage);
+    if (!data) {
+        return false;
+    }
+    DiskBPTreePage(data).init(true);
+    bufferPool.UnpinBlock(rootPage, true);
+    return writeHeader();
+}
+
+// Load the header of an existing index
+bool DiskBPTree::open() {
+    const uint8_t* data = bufferPool.FetchBlock(DISK_BPTREE_HEADER_PAGE);
+    if (!data) {
+        std::cerr << "Error: Could not read the B+ Tree index header." << std::endl;
+        return false;
+    }
+    uint32_t fields[6];
+    std::memcpy(fields, data, sizeof(fields));
+    bufferPool.UnpinBlock(DISK_BPTREE_HEADER_PAGE, false);
+
+    if (fields[0] != DISK_BPTREE_MAGIC || fields[1] != DISK_BPTREE_VERSION) {
+        std::cerr << "Error: Not a B+ Tree index file (bad magic or version)." << std::endl;
+        return false;
+    }
+    rootPage = fields[2];
+    height = fields[3];
+    numPages = fields[4];
+    numEntries = fields[5];
+    headerDirty = false;
+    return true;
+}
+
+bool DiskBPTree::flush() {
+    if (!writeHeader()) {
+        return false;
+    }
+    return bufferPool.FlushAll();
+}
+
+// Insert into the subtree rooted at pageId. On return result.split tells the
+// caller whether it has to add result.separator / result.newPage to its node.
+bool DiskBPTree::insertRecursive(uint32_t pageId, float key, uint32_t value, SplitResult& result) {
+    result.split = false;
+
+    uint8_t* data = bufferPool.FetchBlock(pageId);
+    if (!data) {
+        return false;
+    }
+    STATS_ADD(stats.nodesVisited, 1);
+    DiskBPTreePage page(data);
+    uint32_t n = page.numKeys();
+
+    if (page.isLeaf()) {
+        uint32_t pos = page.upperBound(key);
+        numEntries++;
+        headerDirty = true;
+
+        if (n < DISK_BPTREE_LEAF_CAPACITY) {
+            page.insertAt(pos, key, value);
+            bufferPool.UnpinBlock(pageId, true);
+            return true;
+        }
+
+        // Leaf is full: gather the entries with the new one in place
+        std::vector<float> keys(n + 1);
+        std::vector<uint32_t> values(n + 1);
+        for (uint32_t i = 0, j = 0; i <= n; ++i) {
+            if (i == pos) {
+                keys[i] = key;
+                values[i] = value;
+            } else {
+                keys[i] = page.key(j);
+                values[i] = page.slot(j);
+                j++;
+            }
+        }
+
+        // Split: upper half moves to a new leaf linked after this one
+        uint32_t leftCount = (n + 1) / 2;
+        uint32_t newPageId = allocatePage();
+        uint8_t* newData = bufferPool.NewBlock(newPageId);
+        if (!newData) {
+            bufferPool.UnpinBlock(pageId, false);
+            return false;
+        }
+        DiskBPTreePage newPage(newData);
+        newPage.init(true);
+        for (uint32_t i = leftCount; i <= n; ++i) {
+            newPage.setKey(i - leftCount, keys[i]);
+            newPage.setSlot(i - leftCount, values[i]);
+        }
+        newPage.setNumKeys(n + 1 - leftCount);
+        newPage.setNextLeaf(page.nextLeaf());
+        page.setNextLeaf(newPageId);
+        bufferPool.UnpinBlock(newPageId, true);
+
+        for (uint32_t i = 0; i < leftCount; ++i) {
+            page.setKey(i, keys[i]);
+            page.setSlot(i, values[i]);
+        }
+        page.setNumKeys(leftCount);
+        bufferPool.UnpinBlock(pageId, true);
+
+        result.split = true;
+        result.separator = keys[leftCount];
+        result.newPage = newPageId;
+        return true;
+    }
+
+    // Internal node: descend, then absorb a split of the child if there was one
+    uint32_t childIndex = page.upperBound(key);
+    SplitResult childResult;
+    if (!insertRecursive(page.slot(childIndex), key, value, childResult)) {
+        bufferPool.UnpinBlock(pageId, false);
+        return false;
+    }
+    if (!childResult.split) {
+        bufferPool.UnpinBlock(pageId, false);
+        return true;
+    }
+    if (n < DISK_BPTREE_INTERNAL_CAPACITY) {
+        page.insertAt(childIndex, childResult.separator, childResult.newPage);
+        bufferPool.UnpinBlock(pageId, true);
+        return true;
+    }
+
+    // Node is full: gather keys and children with the new separator in place
+    std::vector<float> keys(n + 1);
+    std::vector<uint32_t> children(n + 2);
+    for (uint32_t i = 0, j = 0; i <= n; ++i) {
+        if (i == childIndex) {
+            keys[i] = childResult.separator;
+        } else {
+            keys[i] = page.key(j++);
+        }
+    }
+    for (uint32_t i = 0, j = 0; i <= n + 1; ++i) {
+        if (i == childIndex + 1) {
+            children[i] = childResult.newPage;
+        } else {
+            children[i] = page.slot(j++);
+        }
+    }
+
+    // Split: the middle key moves up, keys to its right go to a new node
+    uint32_t leftKeys = (n + 1) / 2;
+    uint32_t newPageId = allocatePage();
+    uint8_t* newData = bufferPool.NewBlock(newPageId);
+    if (!newData) {
+        bufferPool.UnpinBlock(pageId, false);
+        return false;
+    }
+    DiskBPTreePage newPage(newData);
+    newPage.init(false);
+    uint32_t rightKeys = n - leftKeys;
+    for (uint32_t i = 0; i < rightKeys; ++i) {
+        newPage.setKey(i, keys[leftKeys + 1 + i]);
+    }
+    for (uint32_t i = 0; i <= rightKeys; ++i) {
+        newPage.setSlot(i, children[leftKeys + 1 + i]);
+    }
+    newPage.setNumKeys(rightKeys);
+    bufferPool.UnpinBlock(newPageId, true);
+
+    for (uint32_t i = 0; i < leftKeys; ++i) {
+        page.setKey(i, keys[i]);
+    }
+    for (uint32_t i = 0; i <= leftKeys; ++i) {
+        page.setSlot(i, children[i]);
+    }
+    page.setNumKeys(leftKeys);
+    bufferPool.UnpinBlock(pageId, true);
+
+    result.split = true;
+    result.separator = keys[leftKeys];
+    result.newPage = newPageId;
+    return true;
+}
+
+// Insert into the B+ Tree, growing a new root when the old one splits
+bool DiskBPTree::insert(float key, uint32_t value) {
+    if (rootPage == DISK_BPTREE_INVALID_PAGE) {
+        std::cerr << "Error: B+ Tree index has not been created or opened." << std::endl;
+        return false;
+    }
+    STATS_TIMER(timer, stats.insertLatency);
+    STATS_ADD(stats.inserts, 1);
+    STATS_ADD(stats.leavesVisited, 1);
+
+    SplitResult result;
+    if (!insertRecursive(rootPage, key, value, result)) {
+        return false;
+    }
+    if (result.split) {
+        uint32_t newRoot = allocatePage();
+        uint8_t* data = bufferPool.NewBlock(newRoot);
+        if (!data) {
+            return false;
+        }
+        DiskBPTreePage page(data);
+        page.init(false);
+        page.setKey(0, result.separator);
+        page.setSlot(0, rootPage);
+        page.setSlot(1, result.newPage);
+        page.setNumKeys(1);
+        bufferPool.UnpinBlock(newRoot, true);
+
+        rootPage = newRoot;
+        height++;
+        headerDirty = true;
+    }
+    return true;
+}
+
+// Walk from the root to the leftmost leaf that can hold key
+uint32_t DiskBPTree::findLeafPage(float key) {
+    uint32_t pageId = rootPage;
+    while (pageId != DISK_BPTREE_INVALID_PAGE) {
+        uint8_t* data = bufferPool.FetchBlock(pageId);
+        if (!data) {
+            return DISK_BPTREE_INVALID_PAGE;
+        }
+        STATS_ADD(stats.nodesVisited, 1);
+        DiskBPTreePage page(data);
+        if (page.isLeaf()) {
+            bufferPool.UnpinBlock(pageId, false);
+            return pageId;
+        }
+        uint32_t next = page.slot(page.lowerBound(key));
+        bufferPool.UnpinBlock(pageId, false);
+        pageId = next;
+    }
+    return DISK_BPTREE_INVALID_PAGE;
+}
+
+// Values of every entry with startKey <= key <= endKey, in key order
+std::vector<uint32_t> DiskBPTree::collectRange(float startKey, float endKey) {
+    std::vector<uint32_t> result;
+
+    uint32_t pageId = findLeafPage(startKey);
+    bool first = true;
+    while (pageId != DISK_BPTREE_INVALID_PAGE) {
+        uint8_t* data = bufferPool.FetchBlock(pageId);
+        if (!data) {
+            break;
+        }
+        if (!first) {
+            STATS_ADD(stats.nodesVisited, 1);
+        }
+        STATS_ADD(stats.leavesVisited, 1);
+        DiskBPTreePage page(data);
+        uint32_t n = page.numKeys();
+        uint32_t i = first ? page.lowerBound(startKey) : 0;
+        first = false;
+
+        // If the range goes on past this leaf, start reading the next one now
+        if (n > 0 && page.key(n - 1) <= endKey && page.nextLeaf() != DISK_BPTREE_INVALID_PAGE) {
+            bufferPool.PrefetchBlock(page.nextLeaf());
+        }
+
+        for (; i < n; ++i) {
+            if (page.key(i) > endKey) {
+                // We've passed the endKey, can stop the search
+                bufferPool.UnpinBlock(pageId, false);
+                return result;
+            }
+            result.push_back(page.slot(i));
+        }
+
+        uint32_t next = page.nextLeaf();
+        bufferPool.UnpinBlock(pageId, false);
+        pageId = next;
+    }
+    return result;
+}
+
+std::vector<uint32_t> DiskBPTree::rangeQuery(float startKey, float endKey) {
+    STATS_TIMER(timer, stats.rangeQueryLatency);
+    STATS_ADD(stats.rangeQueries, 1);
+    std::vector<uint32_t> result = collectRange(startKey, endKey);
+    STATS_ADD(stats.entriesReturned, result.size());
+    return result;
+}
+
+std::vector<uint32_t> DiskBPTree::search(float key) {
+    STATS_TIMER(timer, stats.searchLatency);
+    STATS_ADD(stats.searches, 1);
+    std::vector<uint32_t> result = collectRange(key, key);
+    STATS_ADD(stats.entriesReturned, result.size());
+    return result;
+}
+
+// Print the keys of the root node
+void DiskBPTree::printRootKeys() {
+    uint8_t* data = bufferPool.FetchBlock(rootPage);
+    if (!data) {
+        std::cout << "The B+ Tree index is empty." << std::endl;
+        return;
+    }
+    DiskBPTreePage page(data);
+    std::cout << "Keys in root node: ";
+    for (uint32_t i = 0; i < page.numKeys(); ++i) {
+        std::cout << page.key(i) << " ";
+    }
+    std::cout << std::endl;
+    bufferPool.UnpinBlock(rootPage, false);
+}
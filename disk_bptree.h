@@ -0,0 +1,79 @@
+// disk_bptree.h
+#ifndef DISK_BPTREE_H
+#define DISK_BPTREE_H
+
+#include "buffer_pool.h"
+#include "stats.h"
+#include <vector>
+#include <string>
+
+// Index file layout: page 0 holds the header, every other page is one node.
+// Nodes are addressed by their block number in the index file and every
+// access goes through the buffer pool, so a lookup only touches the pages on
+// its root-to-leaf path.
+const uint32_t DISK_BPTREE_MAGIC = 0x58495042;          // "BPIX"
+const uint32_t DISK_BPTREE_VERSION = 1;
+const uint32_t DISK_BPTREE_HEADER_PAGE = 0;
+const uint32_t DISK_BPTREE_INVALID_PAGE = 0xFFFFFFFF;
+const uint32_t DISK_BPTREE_NODE_HEADER_SIZE = 8;        // isLeaf, unused, numKeys, nextLeaf
+
+// Leaves hold (key, value) pairs, internal nodes hold keys and one more child page id
+const uint32_t DISK_BPTREE_LEAF_CAPACITY =
+    (BLOCK_SIZE - DISK_BPTREE_NODE_HEADER_SIZE) / (sizeof(float) + sizeof(uint32_t));
+const uint32_t DISK_BPTREE_INTERNAL_CAPACITY =
+    (BLOCK_SIZE - DISK_BPTREE_NODE_HEADER_SIZE - sizeof(uint32_t)) / (sizeof(float) + sizeof(uint32_t));
+
+// B+ Tree whose nodes live as BLOCK_SIZE pages inside an index file.
+// Duplicate keys are stored as separate leaf entries, so a key may span leaves.
+// Range scans ask the buffer pool to read the next leaf ahead while they walk
+// the current one; that only takes effect once the pool has read-ahead enabled.
+class DiskBPTree {
+private:
+    BufferPool& bufferPool;
+    uint32_t rootPage;
+    uint32_t height;
+    uint32_t numPages;      // Pages in use, including the header page
+    uint32_t numEntries;
+    bool headerDirty;
+    IndexStats stats;       // Only counted when built with ENABLE_STATS
+
+    // Set by insertRecursive when the node it inserted into was split
+    struct SplitResult {
+        bool split;
+        float separator;
+        uint32_t newPage;
+    };
+
+    uint32_t allocatePage();
+    bool writeHeader();
+    bool insertRecursive(uint32_t pageId, float key, uint32_t value, SplitResult& result);
+    uint32_t findLeafPage(float key);
+    std::vector<uint32_t> collectRange(float startKey, float endKey);
+
+public:
+    DiskBPTree(BufferPool& bufferPool);
+    ~DiskBPTree();
+
+    // Format an empty index (header + empty root leaf), or load an existing one
+    bool create();
+    bool open();
+
+    bool insert(float key, uint32_t value);
+    std::vector<uint32_t> search(float key);
+    std::vector<uint32_t> rangeQuery(float startKey, float endKey);
+
+    // Write the header and every cached index page to disk
+    bool flush();
+
+    uint32_t getNumberOfNodes() const { return numPages - 1; }
+    uint32_t getHeight() const { return height; }
+    uint32_t getNumberOfEntries() const { return numEntries; }
+    void printRootKeys();
+
+    // Node visits and latencies since the last reset; page reads and cache
+    // hits are counted by the Disk under the buffer pool
+    const IndexStats& getStats() const { return stats; }
+    void resetStats() { stats.reset(); }
+};
+
+#endif // DISK_BPTREE_H
@@ -0,0 +1,143 @@
+#include "disk.h"
+#include "buffer_pool.h"
+#include "mapped_disk.h"
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include <sys/resource.h>
+
+// Block filled with one byte, so a block read back tells which write it came from
+static std::vector<uint8_t> filled(uint8_t byte) {
+    return std::vector<uint8_t>(BLOCK_SIZE, byte);
+}
+
+// First byte of blockNumber as a freshly opened Disk reads it from the file
+static int readBack(const char* path, uint32_t blockNumber) {
+    Disk disk(path);
+    std::vector<uint8_t> buffer(BLOCK_SIZE);
+    if (!disk.ReadBlock(blockNumber, buffer.data())) {
+        return -1;
+    }
+    return buffer[0];
+}
+
+int main() {
+    const char* path = "disk_write_test.db";
+    bool ok = true;
+
+    // A vectored write over a block that WriteBlock still has staged
+    std::remove(path);
+    {
+        Disk disk(path);
+        std::vector<uint8_t> a = filled('A'), b = filled('B');
+        const uint8_t* buffers[] = {b.data()};
+        ok = disk.WriteBlock(0, a.data()) && disk.WriteBlocks(0, buffers, 1) && disk.Sync();
+    }
+    int block0 = readBack(path, 0);
+    std::cout << "WriteBlock(0, A), WriteBlocks(0, {B}), Sync: block 0 holds " << static_cast<char>(block0)
+              << std::endl;
+    if (!ok || block0 != 'B') {
+        std::cerr << "Error: A staged write replaced a newer vectored write" << std::endl;
+        ok = false;
+    }
+
+    // The same through a one-frame buffer pool: evictions stage blocks with
+    // WriteBlock, FlushAll writes the newer copy with WriteBlocks
+    std::remove(path);
+    {
+        Disk disk(path);
+        BufferPool pool(disk, 1);
+        uint8_t* frame = pool.NewBlock(0);
+        ok = frame != nullptr && ok;
+        if (frame) {
+            std::memset(frame, 'A', BLOCK_SIZE);
+            pool.UnpinBlock(0, true);
+        }
+        frame = pool.NewBlock(1);   // Evicts block 0
+        ok = frame != nullptr && ok;
+        if (frame) {
+            std::memset(frame, 'C', BLOCK_SIZE);
+            pool.UnpinBlock(1, true);
+        }
+        frame = pool.NewBlock(0);   // Evicts block 1
+        ok = frame != nullptr && ok;
+        if (frame) {
+            std::memset(frame, 'B', BLOCK_SIZE);
+            pool.UnpinBlock(0, true);
+        }
+        ok = pool.FlushAll() && disk.Sync() && ok;
+    }
+    block0 = readBack(path, 0);
+    int block1 = readBack(path, 1);
+    std::cout << "Evict, NewBlock, FlushAll: blocks 0 and 1 hold " << static_cast<char>(block0) << " and "
+              << static_cast<char>(block1) << std::endl;
+    if (!ok || block0 != 'B' || block1 != 'C') {
+        std::cerr << "Error: FlushAll lost the newest version of a block" << std::endl;
+        ok = false;
+    }
+
+    // A flush that fails keeps its blocks staged: with the file size limited to
+    // two blocks Sync fails, and once the limit is lifted Sync writes all four
+    std::remove(path);
+    {
+        Disk disk(path);
+        struct rlimit limit;
+        getrlimit(RLIMIT_FSIZE, &limit);
+        struct rlimit small = limit;
+        small.rlim_cur = 2 * BLOCK_SIZE;
+        std::signal(SIGXFSZ, SIG_IGN);   // Writes past the limit fail with EFBIG instead
+        setrlimit(RLIMIT_FSIZE, &small);
+        std::vector<uint8_t> d = filled('D');
+        for (uint32_t block = 0; block < 4; ++block) {
+            ok = disk.WriteBlock(block, d.data()) && ok;
+        }
+        std::cout << "Sync past the file size limit (an error is expected):" << std::endl;
+        bool limitedSync = disk.Sync();
+        setrlimit(RLIMIT_FSIZE, &limit);
+        ok = !limitedSync && disk.Sync() && ok;
+    }
+    int block3 = readBack(path, 3);
+    std::cout << "Failed Sync, then Sync: block 3 holds " << static_cast<char>(block3 < 0 ? '-' : block3) << std::endl;
+    if (!ok || block3 != 'D') {
+        std::cerr << "Error: A failed flush dropped the blocks it was writing" << std::endl;
+        ok = false;
+    }
+
+    // Appends through a mapped disk extend the file ahead of the writes; a
+    // reopened file must still hold exactly the blocks written
+    const uint32_t appended = 5000;
+    std::remove(path);
+    {
+        MappedDisk disk(path);
+        for (uint32_t block = 0; block < appended; ++block) {
+            std::vector<uint8_t> data = filled(static_cast<uint8_t>(block));
+            ok = disk.WriteBlock(block, data.data()) && ok;
+        }
+        ok = disk.Sync() && ok;
+    }
+    uint32_t reopenedBlocks = 0;
+    bool sameBlocks = true;
+    {
+        MappedDisk disk(path);
+        reopenedBlocks = disk.GetTotalBlocks();
+        for (uint32_t block = 0; block < appended && block < reopenedBlocks; ++block) {
+            const uint8_t* view = disk.GetBlockView(block);
+            sameBlocks = view != nullptr && view[0] == static_cast<uint8_t>(block) && sameBlocks;
+        }
+    }
+    std::cout << "Appended " << appended << " mapped blocks, reopened file has " << reopenedBlocks << std::endl;
+    if (!ok || reopenedBlocks != appended || !sameBlocks) {
+        std::cerr << "Error: The mapped file does not hold the blocks appended to it" << std::endl;
+        ok = false;
+    }
+
+    std::remove(path);
+    if (!ok) {
+        return 1;
+    }
+    std::cout << "Disk write test passed" << std::endl;
+    return 0;
+}
+// Compile with g++ -std=c++11 -O2 -pthread disk_write_test.cc disk.cc mapped_disk.cc buffer_pool.cc async_io.cc -o disk_write_test
@@ -0,0 +1,289 @@
+// ingest.cc
+#include "ingest.h"
+#include <iostream>
+#include <cstring>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+const int GAME_LINE_COLUMNS = 9;
+
+void IngestStats::print() const {
+    std::cout << "Ingest statistics:\n";
+    std::cout << "Records loaded: " << records << "\n";
+    std::cout << "Lines skipped: " << skippedLines << "\n";
+    std::cout << "Blocks written: " << blocksWritten << " (starting at block " << firstBlock << ")\n";
+    std::cout << "Time: " << seconds << " s";
+    if (seconds > 0) {
+        std::cout << " (" << static_cast<size_t>(records / seconds) << " records/s)";
+    }
+    std::cout << "\n";
+}
+
+// Unsigned integer from a field; an empty field reads as 0
+static uint32_t parseUnsigned(const char* begin, const char* end) {
+    uint32_t value = 0;
+    for (const char* p = begin; p < end && *p >= '0' && *p <= '9'; ++p) {
+        value = value * 10 + (*p - '0');
+    }
+    return value;
+}
+
+bool parseGameLine(const char* begin, const char* end, Record& record) {
+    if (end > begin && end[-1] == '\r') {
+        end--;
+    }
+
+    // Find the 9 tab-separated fields in place
+    const char* fieldBegin[GAME_LINE_COLUMNS];
+    const char* fieldEnd[GAME_LINE_COLUMNS];
+    int field = 0;
+    fieldBegin[0] = begin;
+    for (const char* p = begin; p < end; ++p) {
+        if (*p == '\t') {
+            if (field == GAME_LINE_COLUMNS - 1) {
+                return false;
+            }
+            fieldEnd[field] = p;
+            fieldBegin[++field] = p + 1;
+        }
+    }
+    fieldEnd[field] = end;
+    if (field != GAME_LINE_COLUMNS - 1) {
+        return false;
+    }
+
+    record.game_date_day = parseGameDate(fieldBegin[0], fieldEnd[0] - fieldBegin[0]);
+    record.team_id_home = parseUnsigned(fieldBegin[1], fieldEnd[1]);
+    record.pts_home = parseUnsigned(fieldBegin[2], fieldEnd[2]);
+    record.fg_pct_home = parsePercentThousandths(fieldBegin[3], fieldEnd[3] - fieldBegin[3]);
+    record.ft_pct_home = parsePercentThousandths(fieldBegin[4], fieldEnd[4] - fieldBegin[4]);
+    record.fg3_pct_home = parsePercentThousandths(fieldBegin[5], fieldEnd[5] - fieldBegin[5]);
+    record.ast_home = static_cast<uint16_t>(parseUnsigned(fieldBegin[6], fieldEnd[6]));
+    record.reb_home = static_cast<uint16_t>(parseUnsigned(fieldBegin[7], fieldEnd[7]));
+    record.home_team_wins = parseUnsigned(fieldBegin[8], fieldEnd[8]) != 0;
+    return true;
+}
+
+// Output of one parser thread for one chunk: parsed records in file order
+struct ParsedChunk {
+    std::vector<Record> records;
+    size_t skippedLines;
+    bool ready;
+
+    ParsedChunk() : skippedLines(0), ready(false) {}
+};
+
+static void parseChunk(const char* begin, const char* end, ParsedChunk& chunk) {
+    chunk.records.reserve(static_cast<size_t>(end - begin) / 40);
+    const char* line = begin;
+    while (line < end) {
+        const char* lineEnd = static_cast<const char*>(std::memchr(line, '\n', end - line));
+        if (!lineEnd) {
+            lineEnd = end;
+        }
+
+        Record record;
+        if (lineEnd > line && parseGameLine(line, lineEnd, record)) {
+            chunk.records.push_back(record);
+        } else if (lineEnd > line) {
+            chunk.skippedLines++;
+        }
+        line = lineEnd + 1;
+    }
+}
+
+bool ingestGames(const std::string& path, Disk& disk, const IngestOptions& options,
+                 std::vector<std::pair<float, RecordId>>* fgPctEntries, IngestStats& stats) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    stats = IngestStats();
+    if (!isCompactFormat(options.blockFormat)) {
+        std::cerr << "Error: Block format " << options.blockFormat << " is read-only; load into compact or PAX blocks."
+                  << std::endl;
+        return false;
+    }
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Error: Could not open " << path << " for reading." << std::endl;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        std::cerr << "Error: Could not stat " << path << std::endl;
+        ::close(fd);
+        return false;
+    }
+    size_t fileSize = static_cast<size_t>(st.st_size);
+
+    const char* text = nullptr;
+    if (fileSize > 0) {
+        void* addr = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            std::cerr << "Error: Could not map " << path << std::endl;
+            ::close(fd);
+            return false;
+        }
+        text = static_cast<const char*>(addr);
+        madvise(addr, fileSize, MADV_SEQUENTIAL);
+    }
+    ::close(fd);
+
+    // Skip the header, then cut the rest into chunks that end on a newline
+    const char* dataBegin = text;
+    const char* fileEnd = text + fileSize;
+    if (fileSize > 0) {
+        const char* headerEnd = static_cast<const char*>(std::memchr(text, '\n', fileSize));
+        dataBegin = headerEnd ? headerEnd + 1 : fileEnd;
+    }
+    size_t chunkBytes = options.chunkBytes > 0 ? options.chunkBytes : 1;
+    std::vector<std::pair<const char*, const char*>> chunkRanges;
+    for (const char* p = dataBegin; p < fileEnd;) {
+        const char* chunkEnd = p + chunkBytes < fileEnd ? p + chunkBytes : fileEnd;
+        if (chunkEnd < fileEnd) {
+            const char* newline = static_cast<const char*>(std::memchr(chunkEnd, '\n', fileEnd - chunkEnd));
+            chunkEnd = newline ? newline + 1 : fileEnd;
+        }
+        chunkRanges.push_back(std::make_pair(p, chunkEnd));
+        p = chunkEnd;
+    }
+
+    std::vector<ParsedChunk> chunks(chunkRanges.size());
+    std::mutex mutex;
+    std::condition_variable chunkReady;     // A parser finished a chunk
+    std::condition_variable chunkWritten;   // The writer released a chunk
+    size_t nextToParse = 0;
+    size_t nextToWrite = 0;
+    size_t maxInFlight = options.maxChunksInFlight > 0 ? options.maxChunksInFlight : 1;
+
+    // Parsers claim chunks in order but stay at most maxInFlight ahead of the writer
+    unsigned numThreads = options.numThreads > 0 ? options.numThreads : std::thread::hardware_concurrency();
+    if (numThreads == 0) {
+        numThreads = 1;
+    }
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < numThreads; ++t) {
+        workers.push_back(std::thread([&]() {
+            while (true) {
+                size_t index;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    chunkWritten.wait(lock, [&]() {
+                        return nextToParse >= chunks.size() || nextToParse < nextToWrite + maxInFlight;
+                    });
+                    if (nextToParse >= chunks.size()) {
+                        return;
+                    }
+                    index = nextToParse++;
+                }
+                parseChunk(chunkRanges[index].first, chunkRanges[index].second, chunks[index]);
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    chunks[index].ready = true;
+                }
+                chunkReady.notify_all();
+            }
+        }));
+    }
+
+    // Single writer: pack records into block images in file order
+    bool ok = true;
+    bool unstorable = false;
+    uint32_t blockNumber = disk.GetNextFreeBlock();
+    stats.firstBlock = blockNumber;
+    std::vector<uint8_t> blockImage(BLOCK_SIZE, 0);
+    uint32_t recordsInBlock = 0;
+    size_t blockCapacity = recordsPerBlock(options.blockFormat);
+
+    // Write the block image out and start an empty one
+    auto flushBlock = [&]() {
+        bool written = disk.WriteBlock(blockNumber, blockImage.data());
+        std::fill(blockImage.begin(), blockImage.end(), 0);
+        blockNumber++;
+        recordsInBlock = 0;
+        stats.blocksWritten++;
+        return written;
+    };
+
+    for (size_t c = 0; c < chunks.size(); ++c) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            chunkReady.wait(lock, [&]() { return chunks[c].ready; });
+        }
+        ParsedChunk& chunk = chunks[c];
+
+        for (size_t r = 0; r < chunk.records.size() && ok; ++r) {
+            // A compact block also ends early once its team dictionary is full
+            bool stored = storeRecord(blockImage.data(), options.blockFormat, recordsInBlock, chunk.records[r]);
+            if (!stored && recordsInBlock > 0) {
+                ok = flushBlock();
+                stored = ok && storeRecord(blockImage.data(), options.blockFormat, recordsInBlock, chunk.records[r]);
+            }
+            if (!stored) {
+                if (ok) {
+                    std::cerr << "Error: Record " << stats.records + r + 1 << " does not fit the block format."
+                              << std::endl;
+                    unstorable = true;
+                }
+                ok = false;
+                break;
+            }
+            recordsInBlock++;
+            writeBlockHeader(blockImage.data(), recordsInBlock, options.blockFormat);
+
+            if (fgPctEntries) {
+                // Key on the value as stored, in thousandths
+                RecordView record = BlockView(blockImage.data()).record(recordsInBlock - 1);
+                if (!record.fgPctMissing()) {
+                    fgPctEntries->push_back(
+                        std::make_pair(record.fgPctHome(), makeRecordId(blockNumber, recordsInBlock - 1)));
+                }
+            }
+
+            if (recordsInBlock == blockCapacity) {
+                ok = flushBlock();
+            }
+        }
+        stats.records += chunk.records.size();
+        stats.skippedLines += chunk.skippedLines;
+
+        // Release the chunk's memory and let the parsers move ahead
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            std::vector<Record>().swap(chunk.records);
+            nextToWrite = c + 1;
+            if (!ok) {
+                nextToParse = chunks.size();  // Stop the parsers early
+            }
+        }
+        chunkWritten.notify_all();
+        if (!ok) {
+            break;
+        }
+    }
+
+    if (ok && recordsInBlock > 0) {
+        ok = flushBlock();
+    }
+
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    if (text) {
+        munmap(const_cast<char*>(text), fileSize);
+    }
+
+    // Later records go after the blocks written here
+    disk.SetNextFreeBlock(blockNumber);
+
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (!ok && !unstorable) {
+        std::cerr << "Error: Failed to write block " << blockNumber - 1 << " during ingest." << std::endl;
+    }
+    return ok;
+}
@@ -0,0 +1,48 @@
+// ingest.h
+#ifndef INGEST_H
+#define INGEST_H
+
+#include <string>
+#include <vector>
+#include <utility>
+#include "disk.h"
+#include "record_block.h"
+
+// Tuning knobs for ingestGames
+struct IngestOptions {
+    unsigned numThreads;        // Parser threads; 0 means one per hardware thread
+    size_t chunkBytes;          // Target size of the newline-aligned chunks handed to parsers
+    size_t maxChunksInFlight;   // Parsed chunks allowed to wait for the writer (bounds memory)
+    BlockFormat blockFormat;    // Compact or PAX blocks; the text formats are read-only
+
+    IngestOptions()
+        : numThreads(0), chunkBytes(4 * 1024 * 1024), maxChunksInFlight(16), blockFormat(DEFAULT_BLOCK_FORMAT) {}
+};
+
+// What one ingestGames call did
+struct IngestStats {
+    size_t records;
+    size_t skippedLines;        // Lines without the 9 tab-separated columns
+    uint32_t firstBlock;
+    uint32_t blocksWritten;
+    double seconds;
+
+    IngestStats() : records(0), skippedLines(0), firstBlock(0), blocksWritten(0), seconds(0) {}
+    void print() const;
+};
+
+// Parse one games.txt line (no newline) into record; returns false if it does
+// not have all 9 columns. Fields are tokenized in place, nothing is allocated.
+bool parseGameLine(const char* begin, const char* end, Record& record);
+
+// Load a games.txt-style file (header line, then 9 tab-separated columns per
+// line) into disk. The file is memory-mapped and cut into newline-aligned
+// chunks that are parsed on worker threads; a single writer packs the parsed
+// records into blocks in file order, starting at disk.GetNextFreeBlock().
+// When fgPctEntries is given, (FG_PCT_home, RecordId) of every record that
+// has an FG_PCT_home value is appended to it in file order, with the value as
+// the block format stores it.
+bool ingestGames(const std::string& path, Disk& disk, const IngestOptions& options,
+                 std::vector<std::pair<float, RecordId>>* fgPctEntries, IngestStats& stats);
+
+#endif // INGEST_H
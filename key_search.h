@@ -0,0 +1,69 @@
+// key_search.h
+#ifndef KEY_SEARCH_H
+#define KEY_SEARCH_H
+
+#include <cstdint>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Lower/upper bound over a sorted, contiguous array of float keys, as used
+// inside B+ tree nodes. A branch-free binary search (the compare feeds a
+// conditional move, not a jump) narrows the range to KEY_SEARCH_WINDOW keys,
+// which are then compared all at once with AVX or SSE and the matches
+// counted. Without SSE2 the window is counted with a scalar loop.
+// Build with -mavx2 (or -march=native) to use the 8-wide compares.
+const uint32_t KEY_SEARCH_WINDOW = 16;
+
+// Number of keys[0..n) below key (orEqual: at or below key)
+template <bool orEqual>
+inline uint32_t countKeysBelow(const float* keys, uint32_t n, float key) {
+    uint32_t count = 0;
+    uint32_t i = 0;
+#if defined(__AVX__)
+    const __m256 target = _mm256_set1_ps(key);
+    for (; i + 8 <= n; i += 8) {
+        __m256 cmp = _mm256_cmp_ps(_mm256_loadu_ps(keys + i), target, orEqual ? _CMP_LE_OQ : _CMP_LT_OQ);
+        count += __builtin_popcount(_mm256_movemask_ps(cmp));
+    }
+#elif defined(__SSE2__)
+    const __m128 target = _mm_set1_ps(key);
+    for (; i + 4 <= n; i += 4) {
+        __m128 values = _mm_loadu_ps(keys + i);
+        __m128 cmp = orEqual ? _mm_cmple_ps(values, target) : _mm_cmplt_ps(values, target);
+        count += __builtin_popcount(_mm_movemask_ps(cmp));
+    }
+#endif
+    for (; i < n; ++i) {
+        count += orEqual ? (keys[i] <= key) : (keys[i] < key);
+    }
+    return count;
+}
+
+template <bool orEqual>
+inline uint32_t searchKeys(const float* keys, uint32_t n, float key) {
+    // The answer always lies in [base, base + n]
+    uint32_t base = 0;
+    while (n > KEY_SEARCH_WINDOW) {
+        uint32_t half = n / 2;
+        bool right = orEqual ? keys[base + half] <= key : keys[base + half] < key;
+        base = right ? base + half : base;
+        n -= half;
+    }
+    return base + countKeysBelow<orEqual>(keys + base, n, key);
+}
+
+// First position with keys[pos] >= key, or n
+inline uint32_t keyLowerBound(const float* keys, uint32_t n, float key) {
+    return searchKeys<false>(keys, n, key);
+}
+
+// First position with keys[pos] > key, or n
+inline uint32_t keyUpperBound(const float* keys, uint32_t n, float key) {
+    return searchKeys<true>(keys, n, key);
+}
+
+#endif // KEY_SEARCH_H
@@ -0,0 +1,88 @@
+// latch.h
+#ifndef LATCH_H
+#define LATCH_H
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Back off inside a spin loop
+inline void latchPause() {
+#ifdef __SSE2__
+    _mm_pause();
+#else
+    std::this_thread::yield();
+#endif
+}
+
+// Latch for one B+ tree node, used with optimistic lock coupling.
+//
+// The version word is odd while a writer holds the node and grows by 2 on
+// every write unlock. Optimistic readers take no latch at all: they remember
+// the version from readLock, read the node, and call validate afterwards; if
+// the version moved, what they read may be torn and they restart. Writers
+// upgrade a remembered version with tryUpgrade, which fails if anybody wrote
+// in between, so a writer never acts on a stale read either.
+//
+// Leaves are also handed out shared (lockShared) to readers that copy
+// variable-length record lists out of them; a writer that has upgraded waits
+// for those readers to drain before it touches the node.
+class NodeLatch {
+private:
+    std::atomic<uint64_t> version;
+    std::atomic<uint32_t> sharedCount;
+
+public:
+    NodeLatch() : version(0), sharedCount(0) {}
+
+    // Wait until no writer holds the node and return its version
+    uint64_t readLock() const {
+        uint64_t v = version.load();
+        while (v & 1) {
+            latchPause();
+            v = version.load();
+        }
+        return v;
+    }
+
+    // Whether nobody has written the node since readLock returned v
+    bool validate(uint64_t v) const { return version.load() == v; }
+
+    // Turn an optimistic read at version v into the write latch; false if
+    // the node changed since, in which case the caller restarts
+    bool tryUpgrade(uint64_t v) {
+        if (!version.compare_exchange_strong(v, v | 1)) {
+            return false;
+        }
+        while (sharedCount.load() != 0) {
+            latchPause();
+        }
+        return true;
+    }
+
+    void writeLock() {
+        while (!tryUpgrade(readLock())) {
+        }
+    }
+
+    void writeUnlock() { version.fetch_add(1); }
+
+    void lockShared() {
+        for (;;) {
+            readLock();
+            sharedCount.fetch_add(1);
+            if ((version.load() & 1) == 0) {
+                return;
+            }
+            // A writer got in first; let it finish
+            sharedCount.fetch_sub(1);
+        }
+    }
+
+    void unlockShared() { sharedCount.fetch_sub(1); }
+};
+
+#endif // LATCH_H
@@ -0,0 +1,377 @@
+// mapped_bptree.cc
+#include "mapped_bptree.h"
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Deepest tree open accepts; far beyond any real height
+const uint32_t MAX_MAPPED_HEIGHT = 64;
+
+// CRC-32 (the zlib polynomial), one table lookup per byte
+struct Crc32Table {
+    uint32_t entries[256];
+
+    Crc32Table() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+            }
+            entries[i] = c;
+        }
+    }
+};
+
+static uint32_t crc32(const uint8_t* data, size_t size) {
+    static const Crc32Table table;
+    uint32_t c = 0xFFFFFFFF;
+    for (size_t i = 0; i < size; ++i) {
+        c = table.entries[(c ^ data[i]) & 0xFF] ^ (c >> 8);
+    }
+    return c ^ 0xFFFFFFFF;
+}
+
+template <typename T>
+static void appendRaw(std::vector<uint8_t>& out, const T& value) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+static uint32_t headerChecksum(const MappedBPTreeHeader& header) {
+    return crc32(reinterpret_cast<const uint8_t*>(&header), offsetof(MappedBPTreeHeader, checksum));
+}
+
+template <typename Key, typename Value>
+bool BasicMappedBPTree<Key, Value>::write(const Tree& tree, const std::string& filePath) {
+    static_assert(sizeof(Key) % sizeof(uint32_t) == 0 && sizeof(Value) % sizeof(uint32_t) == 0 &&
+                      alignof(Key) <= MAPPED_BPTREE_NODE_ALIGNMENT && alignof(Value) <= MAPPED_BPTREE_NODE_ALIGNMENT,
+                  "Keys and values are read in place, after uint32 fields");
+    typedef typename Tree::Node Node;
+
+    // Number the nodes level by level; the children of a node get consecutive ids
+    std::vector<const Node*> nodes(1, tree.root);
+    std::vector<uint32_t> firstChild;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        firstChild.push_back(static_cast<uint32_t>(nodes.size()));
+        for (uint32_t c = 0; c < nodes[i]->children.size(); ++c) {
+            nodes.push_back(nodes[i]->child(c));
+        }
+    }
+
+    std::ofstream outFile(filePath, std::ios::binary | std::ios::trunc);
+    if (!outFile.is_open()) {
+        std::cerr << "Error: Could not open " << filePath << " for writing the B+ Tree" << std::endl;
+        return false;
+    }
+    MappedBPTreeHeader header;
+    std::memset(&header, 0, sizeof(header));
+    outFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    std::vector<MappedBPTreeNodeEntry> table(nodes.size());
+    std::vector<uint8_t> out;
+    uint64_t offset = sizeof(header);
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        const Node* node = nodes[i];
+        out.assign((MAPPED_BPTREE_NODE_ALIGNMENT - offset % MAPPED_BPTREE_NODE_ALIGNMENT) % MAPPED_BPTREE_NODE_ALIGNMENT,
+                   0);
+        offset += out.size();
+        size_t start = out.size();
+        bool lastLeaf = i + 1 == nodes.size();
+        out.push_back(node->isLeaf ? 1 : 0);
+        out.insert(out.end(), 3, 0);
+        appendRaw(out, static_cast<uint32_t>(node->keys.size()));
+        appendRaw(out, static_cast<uint32_t>(i));
+        appendRaw(out, node->isLeaf && !lastLeaf ? static_cast<uint32_t>(i + 1) : MAPPED_BPTREE_INVALID_NODE);
+        for (const Key& key : node->keys) {
+            appendRaw(out, key);
+        }
+        if (node->isLeaf) {
+            uint32_t valueOffset = 0;
+            appendRaw(out, valueOffset);
+            for (uint32_t k = 0; k < node->records.size(); ++k) {
+                valueOffset += static_cast<uint32_t>(node->records[k].size());
+                appendRaw(out, valueOffset);
+            }
+            for (uint32_t k = 0; k < node->records.size(); ++k) {
+                for (const Value& value : node->records[k]) {
+                    appendRaw(out, value);
+                }
+            }
+            header.numValues += valueOffset;
+        } else {
+            for (size_t c = 0; c < node->children.size(); ++c) {
+                appendRaw(out, static_cast<uint32_t>(firstChild[i] + c));
+            }
+        }
+        table[i].offset = offset;
+        table[i].size = static_cast<uint32_t>(out.size() - start);
+        table[i].checksum = crc32(out.data() + start, table[i].size);
+        outFile.write(reinterpret_cast<const char*>(out.data()), out.size());
+        offset += table[i].size;
+    }
+
+    out.assign((MAPPED_BPTREE_NODE_ALIGNMENT - offset % MAPPED_BPTREE_NODE_ALIGNMENT) % MAPPED_BPTREE_NODE_ALIGNMENT, 0);
+    outFile.write(reinterpret_cast<const char*>(out.data()), out.size());
+    outFile.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(MappedBPTreeNodeEntry));
+
+    header.magic = MAPPED_BPTREE_MAGIC;
+    header.version = MAPPED_BPTREE_VERSION;
+    header.keySize = sizeof(Key);
+    header.valueSize = sizeof(Value);
+    header.order = Tree::ORDER;
+    header.numNodes = static_cast<uint32_t>(nodes.size());
+    header.height = static_cast<uint32_t>(tree.getHeight());
+    header.headerSize = sizeof(header);
+    header.tableOffset = offset + out.size();
+    header.checksum = headerChecksum(header);
+    outFile.seekp(0);
+    outFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    outFile.close();
+    if (!outFile) {
+        std::cerr << "Error: Failed to write the B+ Tree to " << filePath << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Constructor
+template <typename Key, typename Value>
+BasicMappedBPTree<Key, Value>::BasicMappedBPTree(const std::string& filePath)
+    : filePath(filePath), fd(-1), mapping(nullptr), fileSize(0), table(nullptr), nodesLoaded(0) {
+    std::memset(&header, 0, sizeof(header));
+}
+
+template <typename Key, typename Value>
+BasicMappedBPTree<Key, Value>::~BasicMappedBPTree() {
+    close();
+}
+
+template <typename Key, typename Value>
+void BasicMappedBPTree<Key, Value>::close() {
+    if (mapping) {
+        munmap(const_cast<uint8_t*>(mapping), fileSize);
+        mapping = nullptr;
+    }
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+template <typename Key, typename Value>
+bool BasicMappedBPTree<Key, Value>::open() {
+    close();
+    fd = ::open(filePath.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        std::cerr << "Error: Could not open " << filePath << ": " << std::strerror(errno) << std::endl;
+        close();
+        return false;
+    }
+    fileSize = static_cast<size_t>(st.st_size);
+    if (fileSize < sizeof(header)) {
+        std::cerr << "Error: " << filePath << " is too short for an index file" << std::endl;
+        close();
+        return false;
+    }
+    void* addr = mmap(nullptr, fileSize, PROT_READ, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+        std::cerr << "Error: Could not map " << filePath << " (" << std::strerror(errno) << ")" << std::endl;
+        close();
+        return false;
+    }
+    mapping = static_cast<const uint8_t*>(addr);
+
+    std::memcpy(&header, mapping, sizeof(header));
+    const char* problem = nullptr;
+    if (header.magic != MAPPED_BPTREE_MAGIC) {
+        problem = "is not a mapped B+ Tree index";
+    } else if (header.checksum != headerChecksum(header)) {
+        problem = "has a damaged header";
+    } else if (header.version != MAPPED_BPTREE_VERSION || header.headerSize != sizeof(header)) {
+        problem = "has an unsupported format version";
+    } else if (header.keySize != sizeof(Key) || header.valueSize != sizeof(Value)) {
+        problem = "holds keys or values of another type";
+    } else if (header.numNodes == 0 || header.order < 3 || header.height == 0 || header.height > MAX_MAPPED_HEIGHT ||
+               header.tableOffset % MAPPED_BPTREE_NODE_ALIGNMENT != 0 || header.tableOffset > fileSize ||
+               (fileSize - header.tableOffset) / sizeof(MappedBPTreeNodeEntry) < header.numNodes) {
+        problem = "is cut short or has an invalid header";
+    }
+    if (problem) {
+        std::cerr << "Error: " << filePath << " " << problem << std::endl;
+        close();
+        return false;
+    }
+    table = reinterpret_cast<const MappedBPTreeNodeEntry*>(mapping + header.tableOffset);
+
+    // Zeroed, i.e. NODE_UNCHECKED, without touching each entry
+    nodeState.reset(new std::atomic<uint8_t>[header.numNodes]());
+    nodesLoaded = 0;
+    return true;
+}
+
+// Check the checksum and layout of node id, as far as the node itself goes
+template <typename Key, typename Value>
+bool BasicMappedBPTree<Key, Value>::checkNode(uint32_t id) const {
+    const MappedBPTreeNodeEntry& entry = table[id];
+    if (entry.offset % MAPPED_BPTREE_NODE_ALIGNMENT != 0 || entry.offset < sizeof(header) ||
+        entry.offset > header.tableOffset || entry.size > header.tableOffset - entry.offset ||
+        entry.size < MAPPED_BPTREE_NODE_HEADER_SIZE || crc32(mapping + entry.offset, entry.size) != entry.checksum) {
+        return false;
+    }
+
+    const uint8_t* data = mapping + entry.offset;
+    uint32_t numKeys, storedId, nextLeaf;
+    std::memcpy(&numKeys, data + 4, sizeof(numKeys));
+    std::memcpy(&storedId, data + 8, sizeof(storedId));
+    std::memcpy(&nextLeaf, data + 12, sizeof(nextLeaf));
+    bool isLeaf = data[0] != 0;
+    uint64_t fixedSize = MAPPED_BPTREE_NODE_HEADER_SIZE + static_cast<uint64_t>(numKeys) * sizeof(Key) +
+                         (static_cast<uint64_t>(numKeys) + 1) * sizeof(uint32_t);
+    if (data[0] > 1 || storedId != id || numKeys >= header.order || (!isLeaf && numKeys == 0) ||
+        fixedSize > entry.size) {
+        return false;
+    }
+
+    const Key* keys = reinterpret_cast<const Key*>(data + MAPPED_BPTREE_NODE_HEADER_SIZE);
+    const uint32_t* slots = reinterpret_cast<const uint32_t*>(keys + numKeys);
+    for (uint32_t i = 1; i < numKeys; ++i) {
+        if (!std::less<Key>()(keys[i - 1], keys[i])) {
+            return false;
+        }
+    }
+    if (isLeaf) {
+        for (uint32_t i = 0; i < numKeys; ++i) {
+            if (slots[i] > slots[i + 1]) {
+                return false;
+            }
+        }
+        // Leaves only link forward, so a scan cannot loop
+        return slots[0] == 0 && fixedSize + static_cast<uint64_t>(slots[numKeys]) * sizeof(Value) == entry.size &&
+               (nextLeaf == MAPPED_BPTREE_INVALID_NODE || (nextLeaf > id && nextLeaf < header.numNodes));
+    }
+    // Children have higher ids than their parent, so a descent cannot loop
+    for (uint32_t i = 0; i <= numKeys; ++i) {
+        if (slots[i] <= id || slots[i] >= header.numNodes) {
+            return false;
+        }
+    }
+    return fixedSize == entry.size;
+}
+
+// View of node id, checking it first if no query has reached it before
+template <typename Key, typename Value>
+bool BasicMappedBPTree<Key, Value>::node(uint32_t id, NodeView& view) const {
+    uint8_t state = nodeState[id].load(std::memory_order_acquire);
+    if (state == NODE_UNCHECKED) {
+        uint8_t checked = checkNode(id) ? NODE_VALID : NODE_INVALID;
+        if (nodeState[id].compare_exchange_strong(state, checked, std::memory_order_acq_rel)) {
+            nodesLoaded++;
+        }
+        state = checked;
+    }
+    if (state != NODE_VALID) {
+        std::cerr << "Error: Node " << id << " of " << filePath << " is damaged" << std::endl;
+        return false;
+    }
+
+    const uint8_t* data = mapping + table[id].offset;
+    view.isLeaf = data[0] != 0;
+    std::memcpy(&view.numKeys, data + 4, sizeof(view.numKeys));
+    std::memcpy(&view.nextLeaf, data + 12, sizeof(view.nextLeaf));
+    view.keys = reinterpret_cast<const Key*>(data + MAPPED_BPTREE_NODE_HEADER_SIZE);
+    view.slots = reinterpret_cast<const uint32_t*>(view.keys + view.numKeys);
+    view.values = reinterpret_cast<const Value*>(view.slots + view.numKeys + 1);
+    return true;
+}
+
+// Leaf that may hold key
+template <typename Key, typename Value>
+bool BasicMappedBPTree<Key, Value>::findLeaf(const Key& key, NodeView& leaf) const {
+    if (!mapping) {
+        std::cerr << "Error: Query on an index that is not open" << std::endl;
+        return false;
+    }
+    uint32_t id = 0;
+    for (uint32_t level = 0; level < header.height; ++level) {
+        if (!node(id, leaf)) {
+            return false;
+        }
+        if (leaf.isLeaf) {
+            return true;
+        }
+        id = leaf.slots[Search::upperBound(leaf.keys, leaf.numKeys, key)];
+    }
+    std::cerr << "Error: " << filePath << " is deeper than its header says" << std::endl;
+    return false;
+}
+
+template <typename Key, typename Value>
+bool BasicMappedBPTree<Key, Value>::search(const Key& key, std::vector<Value>& result) const {
+    NodeView leaf;
+    if (!findLeaf(key, leaf)) {
+        return false;
+    }
+    uint32_t i = Search::lowerBound(leaf.keys, leaf.numKeys, key);
+    if (i < leaf.numKeys && !std::less<Key>()(key, leaf.keys[i])) {
+        result.insert(result.end(), leaf.values + leaf.slots[i], leaf.values + leaf.slots[i + 1]);
+    }
+    return true;
+}
+
+template <typename Key, typename Value>
+bool BasicMappedBPTree<Key, Value>::collectRange(const Key& startKey, const Key& endKey, bool includeEndKey,
+                                                 std::vector<Value>& result) const {
+    NodeView leaf;
+    if (!findLeaf(startKey, leaf)) {
+        return false;
+    }
+    uint32_t first = Search::lowerBound(leaf.keys, leaf.numKeys, startKey);
+    for (;;) {
+        // Keys of this leaf up to endKey
+        uint32_t last = includeEndKey ? Search::upperBound(leaf.keys, leaf.numKeys, endKey)
+                                      : Search::lowerBound(leaf.keys, leaf.numKeys, endKey);
+        if (first < last) {
+            result.insert(result.end(), leaf.values + leaf.slots[first], leaf.values + leaf.slots[last]);
+        }
+        if (last < leaf.numKeys || leaf.nextLeaf == MAPPED_BPTREE_INVALID_NODE) {
+            return true;
+        }
+        if (!node(leaf.nextLeaf, leaf)) {
+            return false;
+        }
+        first = 0;
+    }
+}
+
+template <typename Key, typename Value>
+bool BasicMappedBPTree<Key, Value>::countRange(const Key& startKey, const Key& endKey, size_t& count) const {
+    count = 0;
+    NodeView leaf;
+    if (!findLeaf(startKey, leaf)) {
+        return false;
+    }
+    uint32_t first = Search::lowerBound(leaf.keys, leaf.numKeys, startKey);
+    for (;;) {
+        uint32_t last = Search::upperBound(leaf.keys, leaf.numKeys, endKey);
+        if (first < last) {
+            count += leaf.slots[last] - leaf.slots[first];
+        }
+        if (last < leaf.numKeys || leaf.nextLeaf == MAPPED_BPTREE_INVALID_NODE) {
+            return true;
+        }
+        if (!node(leaf.nextLeaf, leaf)) {
+            return false;
+        }
+        first = 0;
+    }
+}
+
+template class BasicMappedBPTree<float>;
+template class BasicMappedBPTree<uint32_t>;
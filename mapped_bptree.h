@@ -0,0 +1,124 @@
+// mapped_bptree.h
+#ifndef MAPPED_BPTREE_H
+#define MAPPED_BPTREE_H
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include "bptree.h"
+
+// Index file layout: a header, the nodes, then a node offset table with one
+// entry per node id. Node 0 is the root and the ids follow the levels from the
+// root down, so the leaves come last and in key order. Every node starts on an
+// 8-byte boundary with isLeaf, three unused bytes, uint32 numKeys, its own id
+// and the id of the next leaf, followed by the keys; a leaf then holds
+// numKeys + 1 uint32 offsets into its value array and the values, an internal
+// node numKeys + 1 child ids. Nodes are read in place from a read-only mmap.
+const uint32_t MAPPED_BPTREE_MAGIC = 0x4D545042;     // "BPTM"
+const uint32_t MAPPED_BPTREE_VERSION = 1;
+const uint32_t MAPPED_BPTREE_NODE_HEADER_SIZE = 16;
+const uint32_t MAPPED_BPTREE_NODE_ALIGNMENT = 8;
+const uint32_t MAPPED_BPTREE_INVALID_NODE = 0xFFFFFFFF;
+
+struct MappedBPTreeHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t keySize;
+    uint32_t valueSize;
+    uint32_t order;
+    uint32_t numNodes;
+    uint32_t height;
+    uint32_t headerSize;   // sizeof(MappedBPTreeHeader) when written
+    uint64_t numValues;
+    uint64_t tableOffset;
+    uint32_t reserved;     // Zero
+    uint32_t checksum;     // CRC-32 of the fields above
+};
+
+struct MappedBPTreeNodeEntry {
+    uint64_t offset;
+    uint32_t size;
+    uint32_t checksum;   // CRC-32 of the node's bytes
+};
+
+// Read-only B+ tree served straight from an index file written by write().
+// open maps the file and checks only the header, so it takes about as long
+// for any size of index; each node's checksum and layout are checked the
+// first time a query reaches it, and queries only fault in the pages of the
+// nodes they visit. A node that fails its check fails just the queries that
+// reach it (they print an error and return false) instead of the whole load.
+// Queries may run from any number of threads at once.
+template <typename Key, typename Value = RecordId>
+class BasicMappedBPTree {
+public:
+    typedef BasicBPTree<Key, Value> Tree;
+    typedef NodeKeySearch<Key, std::less<Key>> Search;
+
+    // Write tree to filePath in the mapped index format
+    static bool write(const Tree& tree, const std::string& filePath);
+
+    BasicMappedBPTree(const std::string& filePath);
+    ~BasicMappedBPTree();
+
+    // Map the file and check its header; false if it is not a valid index
+    // file of this key and value type
+    bool open();
+    bool isOpen() const { return mapping != nullptr; }
+
+    // Values stored under key
+    bool search(const Key& key, std::vector<Value>& result) const;
+
+    // Append the values of the keys in [startKey, endKey], or [startKey, endKey)
+    // when includeEndKey is false, to result in key order
+    bool collectRange(const Key& startKey, const Key& endKey, bool includeEndKey, std::vector<Value>& result) const;
+    bool rangeQuery(const Key& startKey, const Key& endKey, std::vector<Value>& result) const {
+        return collectRange(startKey, endKey, true, result);
+    }
+
+    // Number of values rangeQuery would return, without collecting them
+    bool countRange(const Key& startKey, const Key& endKey, size_t& count) const;
+
+    uint32_t getNumberOfNodes() const { return header.numNodes; }
+    uint32_t getHeight() const { return header.height; }
+    uint64_t getNumberOfValues() const { return header.numValues; }
+
+    // Nodes checked so far, i.e. the distinct nodes queries have reached
+    size_t getNodesLoaded() const { return nodesLoaded.load(); }
+
+private:
+    // One node as it lies in the mapping
+    struct NodeView {
+        bool isLeaf;
+        uint32_t numKeys;
+        uint32_t nextLeaf;
+        const Key* keys;
+        const uint32_t* slots;   // Value offsets (leaf, numKeys + 1) or child ids (internal)
+        const Value* values;
+    };
+
+    // Node states in nodeState
+    enum { NODE_UNCHECKED, NODE_VALID, NODE_INVALID };
+
+    std::string filePath;
+    int fd;
+    const uint8_t* mapping;
+    size_t fileSize;
+    MappedBPTreeHeader header;
+    const MappedBPTreeNodeEntry* table;
+    std::unique_ptr<std::atomic<uint8_t>[]> nodeState;
+    mutable std::atomic<size_t> nodesLoaded;
+
+    bool node(uint32_t id, NodeView& view) const;
+    bool checkNode(uint32_t id) const;
+    bool findLeaf(const Key& key, NodeView& leaf) const;
+    void close();
+};
+
+typedef BasicMappedBPTree<float> MappedBPTree;
+typedef BasicMappedBPTree<uint32_t> UIntMappedBPTree;
+
+extern template class BasicMappedBPTree<float>;
+extern template class BasicMappedBPTree<uint32_t>;
+
+#endif // MAPPED_BPTREE_H
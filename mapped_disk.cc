@@ -0,0 +1,180 @@
+// mapped_disk.cc
+#include "mapped_disk.h"
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/mman.h>
+
+// Constructor: the base class opens the file, this maps it
+MappedDisk::MappedDisk(const std::string& path)
+    : Disk(path),
+      mapping(nullptr),
+      mappedBytes(0),
+      fileBlocks(totalBlocks) {
+    if (fd < 0) {
+        return;
+    }
+    TRACE("Mapping disk file: " << filePath);
+    Remap(static_cast<size_t>(totalBlocks) * BLOCK_SIZE);
+}
+
+// Destructor: write the mapped pages back before the base class closes the file
+MappedDisk::~MappedDisk() {
+    if (mapping) {
+        msync(mapping, static_cast<size_t>(totalBlocks) * BLOCK_SIZE, MS_SYNC);
+        munmap(mapping, mappedBytes);
+        TrimFile();
+    }
+}
+
+// Replace the mapping with one of at least minBytes, doubling the reservation
+bool MappedDisk::Remap(size_t minBytes) {
+    size_t newBytes = mappedBytes > 0 ? mappedBytes : MAPPED_DISK_MIN_MAPPING;
+    while (newBytes < minBytes) {
+        newBytes *= 2;
+    }
+
+    if (mapping) {
+        munmap(mapping, mappedBytes);
+        mapping = nullptr;
+    }
+    void* addr = mmap(nullptr, newBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+        std::cerr << "Error: Could not map disk file: " << filePath << " (" << std::strerror(errno) << ")" << std::endl;
+        mappedBytes = 0;
+        return false;
+    }
+    mapping = static_cast<uint8_t*>(addr);
+    mappedBytes = newBytes;
+    return true;
+}
+
+// Add blocks at the end (new blocks read as zeros). Only when the file is too
+// short is it extended, to the whole mapping after remapping if that is too small.
+bool MappedDisk::Grow(uint32_t newTotalBlocks) {
+    if (newTotalBlocks > fileBlocks) {
+        size_t newSize = static_cast<size_t>(newTotalBlocks) * BLOCK_SIZE;
+        if (newSize > mappedBytes && !Remap(newSize)) {
+            return false;
+        }
+        if (ftruncate(fd, static_cast<off_t>(mappedBytes)) != 0) {
+            std::cerr << "Error: Could not extend disk file to " << newTotalBlocks << " blocks" << std::endl;
+            return false;
+        }
+        fileBlocks = static_cast<uint32_t>(mappedBytes / BLOCK_SIZE);
+    }
+    totalBlocks = newTotalBlocks;
+    return true;
+}
+
+// Cut the file back to the blocks written, dropping the zeros Grow reserved
+bool MappedDisk::TrimFile() {
+    if (fileBlocks == totalBlocks) {
+        return true;
+    }
+    if (ftruncate(fd, static_cast<off_t>(totalBlocks) * BLOCK_SIZE) != 0) {
+        std::cerr << "Error: Could not trim disk file to " << totalBlocks << " blocks" << std::endl;
+        return false;
+    }
+    fileBlocks = totalBlocks;
+    return true;
+}
+
+// Write data to a block
+bool MappedDisk::WriteBlock(uint32_t blockNumber, const uint8_t* buffer) {
+    if (!mapping) {
+        return false;
+    }
+    if (blockNumber >= totalBlocks && !Grow(blockNumber + 1)) {
+        return false;
+    }
+    STATS_TIMER(timer, stats.writeLatency);
+    std::memcpy(mapping + static_cast<size_t>(blockNumber) * BLOCK_SIZE, buffer, BLOCK_SIZE);
+    STATS_ADD(stats.writeCalls, 1);
+    STATS_ADD(stats.blocksWritten, 1);
+    STATS_ADD(stats.bytesWritten, BLOCK_SIZE);
+    return true;
+}
+
+bool MappedDisk::WriteBlocks(uint32_t firstBlock, const uint8_t* const* buffers, uint32_t count) {
+    if (!mapping || count == 0) {
+        return false;
+    }
+    if (firstBlock + count > totalBlocks && !Grow(firstBlock + count)) {
+        return false;
+    }
+    STATS_TIMER(timer, stats.writeLatency);
+    for (uint32_t i = 0; i < count; ++i) {
+        std::memcpy(mapping + static_cast<size_t>(firstBlock + i) * BLOCK_SIZE, buffers[i], BLOCK_SIZE);
+    }
+    STATS_ADD(stats.writeCalls, 1);
+    STATS_ADD(stats.blocksWritten, count);
+    STATS_ADD(stats.bytesWritten, static_cast<uint64_t>(count) * BLOCK_SIZE);
+    return true;
+}
+
+bool MappedDisk::Sync() {
+    if (!mapping) {
+        return false;
+    }
+    if (msync(mapping, static_cast<size_t>(totalBlocks) * BLOCK_SIZE, MS_SYNC) != 0) {
+        std::cerr << "Error: Failed to sync disk file: " << filePath << std::endl;
+        return false;
+    }
+    // The synced file has exactly the blocks written; fsync makes its size durable
+    if (fileBlocks != totalBlocks && (!TrimFile() || fsync(fd) != 0)) {
+        std::cerr << "Error: Failed to sync disk file size: " << filePath << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Read data from a block
+bool MappedDisk::ReadBlock(uint32_t blockNumber, uint8_t* buffer) {
+    const uint8_t* view = GetBlockView(blockNumber);
+    if (!view) {
+        std::cerr << "Error: Block " << blockNumber << " does not exist." << std::endl;
+        return false;
+    }
+    std::memcpy(buffer, view, BLOCK_SIZE);
+    STATS_ADD(stats.bytesRead, BLOCK_SIZE);
+    return true;
+}
+
+// Read a run of consecutive blocks
+bool MappedDisk::ReadBlocks(uint32_t firstBlock, uint32_t count, uint8_t* buffer) {
+    if (!mapping || count == 0 || firstBlock + count > totalBlocks) {
+        std::cerr << "Error: Blocks " << firstBlock << " to " << firstBlock + count - 1 << " do not exist." << std::endl;
+        return false;
+    }
+    STATS_TIMER(timer, stats.readLatency);
+    std::memcpy(buffer, mapping + static_cast<size_t>(firstBlock) * BLOCK_SIZE, static_cast<size_t>(count) * BLOCK_SIZE);
+    STATS_ADD(stats.readCalls, 1);
+    STATS_ADD(stats.blocksRead, count);
+    STATS_ADD(stats.bytesRead, static_cast<uint64_t>(count) * BLOCK_SIZE);
+    return true;
+}
+
+const uint8_t* MappedDisk::GetBlockView(uint32_t blockNumber) const {
+    if (!mapping || blockNumber >= totalBlocks) {
+        return nullptr;
+    }
+    // A view is a block read that moves no bytes
+    STATS_ADD(stats.readCalls, 1);
+    STATS_ADD(stats.blocksRead, 1);
+    return mapping + static_cast<size_t>(blockNumber) * BLOCK_SIZE;
+}
+
+void MappedDisk::AdviseAccess(AccessPattern pattern) {
+    if (!mapping) {
+        return;
+    }
+    int advice = MADV_NORMAL;
+    if (pattern == ACCESS_SEQUENTIAL) {
+        advice = MADV_SEQUENTIAL;
+    } else if (pattern == ACCESS_RANDOM) {
+        advice = MADV_RANDOM;
+    }
+    madvise(mapping, mappedBytes, advice);
+}
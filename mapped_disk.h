@@ -0,0 +1,47 @@
+// mapped_disk.h
+#ifndef MAPPED_DISK_H
+#define MAPPED_DISK_H
+
+#include "disk.h"
+
+const size_t MAPPED_DISK_MIN_MAPPING = 64 * 1024 * 1024;   // Address space reserved up front (64MB)
+
+// Disk backed by an mmap of the disk file. Reads are served straight from the
+// mapping and GetBlockView hands out pointers into it, so callers that can
+// work on const block memory skip both the read syscall and the copy.
+//
+// The mapping reserves more address space than the file needs. Appending a
+// block past the end of the file extends the file to the whole reservation,
+// which doubles when it runs out, so appends cost one ftruncate per doubling.
+// Sync and the destructor cut the file back to the blocks written, so a
+// reopened file has the right block count. A remap moves the mapping, so views
+// returned by GetBlockView are valid only until the next WriteBlock past the
+// end of the file.
+class MappedDisk : public Disk {
+private:
+    uint8_t* mapping;
+    size_t mappedBytes;    // Size of the reserved mapping, at least the file size
+    uint32_t fileBlocks;   // Blocks the file is extended to, at least totalBlocks
+
+    bool Remap(size_t minBytes);
+    bool Grow(uint32_t newTotalBlocks);
+    bool TrimFile();
+
+public:
+    MappedDisk(const std::string& path);
+    ~MappedDisk();
+
+    bool WriteBlock(uint32_t blockNumber, const uint8_t* buffer);
+    bool ReadBlock(uint32_t blockNumber, uint8_t* buffer);
+    bool ReadBlocks(uint32_t firstBlock, uint32_t count, uint8_t* buffer);
+    bool WriteBlocks(uint32_t firstBlock, const uint8_t* const* buffers, uint32_t count);
+    bool Sync();
+    const uint8_t* GetBlockView(uint32_t blockNumber) const;
+
+    // madvise the whole mapping: read-ahead for scans, no read-ahead for lookups
+    void AdviseAccess(AccessPattern pattern);
+
+    bool isOpen() const { return fd >= 0 && mapping != nullptr; }
+};
+
+#endif // MAPPED_DISK_H
@@ -0,0 +1,176 @@
+#include "disk.h"
+#include "bptree.h"
+#include "ingest.h"
+#include "mapped_bptree.h"
+#include "test_util.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <vector>
+
+const uint32_t SYNTHETIC_KEYS = 4000000;   // Distinct keys of the large index
+
+// Random ranges and point lookups on the mapped index against the tree
+template <typename Key>
+static size_t countDifferences(const BasicBPTree<Key>& tree, const BasicMappedBPTree<Key>& mapped,
+                               const std::vector<Key>& probes, std::mt19937& rng) {
+    std::uniform_int_distribution<size_t> pick(0, probes.size() - 1);
+    size_t wrong = 0;
+    for (int i = 0; i < 200; ++i) {
+        Key a = probes[pick(rng)], b = probes[pick(rng)];
+        Key lo = std::min(a, b), hi = std::max(a, b);
+        std::vector<RecordId> expected, found, point;
+        tree.collectRange(lo, hi, i % 2 == 0, expected);
+        size_t count = 0;
+        bool ok = mapped.collectRange(lo, hi, i % 2 == 0, found) && mapped.countRange(lo, hi, count) &&
+                  mapped.search(a, point);
+        wrong += !ok || found != expected || (i % 2 == 0 && count != expected.size()) || point != tree.search(a);
+    }
+    std::vector<RecordId> all;
+    wrong += !mapped.rangeQuery(probes.front(), probes.back(), all) ||
+             all.size() != tree.countRange(probes.front(), probes.back());
+    return wrong;
+}
+
+static void flipByte(const char* path, uint64_t offset) {
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekg(offset);
+    char byte = 0;
+    file.read(&byte, 1);
+    byte ^= 0x5A;
+    file.seekp(offset);
+    file.write(&byte, 1);
+}
+
+int main(int argc, char* argv[]) {
+    // Load games.txt (or the given file) into a scratch data file
+    const char* dataPath = "mapped_index_disk.db";
+    const char* mappedPath = "mapped_index.bpt";
+    const char* fullPath = "mapped_index_full.dat";
+    const char* gamesFile = argc > 1 ? argv[1] : "games.txt";
+    std::remove(dataPath);
+    std::mt19937 rng(24);
+
+    bool ok = true;
+    {
+        Disk disk(dataPath);
+        std::vector<std::pair<float, RecordId>> entries;
+        IngestStats ingestStats;
+        if (!loadGames(gamesFile, disk, &entries, ingestStats)) {
+            return 1;
+        }
+        std::sort(entries.begin(), entries.end());
+
+        // FG_PCT_home index, written in the mapped format and checked against the tree
+        BPTree tree;
+        if (!tree.bulkLoad(entries) || !MappedBPTree::write(tree, mappedPath)) {
+            return 1;
+        }
+        MappedBPTree mapped(mappedPath);
+        std::vector<float> probes;
+        for (const auto& entry : entries) {
+            probes.push_back(entry.first);
+        }
+        probes.push_back(-1.0f);
+        probes.push_back(2.0f);
+        std::sort(probes.begin(), probes.end());
+        size_t wrong = mapped.open() ? countDifferences(tree, mapped, probes, rng) : 1;
+        std::cout << "FG_PCT_home index of " << mapped.getNumberOfValues() << " records in "
+                  << mapped.getNumberOfNodes() << " nodes: " << wrong
+                  << " of 201 queries differ from the in-memory tree" << std::endl;
+        if (wrong != 0 || mapped.getNumberOfValues() != entries.size()) {
+            std::cerr << "Error: The mapped index disagrees with the tree" << std::endl;
+            ok = false;
+        }
+    }
+    std::remove(dataPath);
+
+    // A large index: load it with deserialize, or open it and run one lookup
+    {
+        std::vector<std::pair<uint32_t, RecordId>> entries;
+        std::vector<uint32_t> probes;
+        for (uint32_t i = 0; i < SYNTHETIC_KEYS; ++i) {
+            entries.push_back(std::make_pair(i * 3, static_cast<RecordId>(rng())));
+            probes.push_back(i * 3);
+        }
+        UIntBPTree tree;
+        if (!tree.bulkLoad(entries) || !UIntMappedBPTree::write(tree, mappedPath)) {
+            return 1;
+        }
+        tree.serialize(fullPath);
+
+        Clock::time_point start = Clock::now();
+        UIntBPTree loaded;
+        loaded.deserialize(fullPath);
+        std::vector<RecordId> fromLoaded = loaded.search(probes[SYNTHETIC_KEYS / 2]);
+        double deserializeMillis = millisSince(start);
+
+        start = Clock::now();
+        UIntMappedBPTree mapped(mappedPath);
+        std::vector<RecordId> fromMapped;
+        bool opened = mapped.open() && mapped.search(probes[SYNTHETIC_KEYS / 2], fromMapped);
+        double openMillis = millisSince(start);
+        size_t nodesForLookup = mapped.getNodesLoaded();
+
+        size_t wrong = opened ? countDifferences(tree, mapped, probes, rng) : 1;
+        std::cout << SYNTHETIC_KEYS << " keys in " << mapped.getNumberOfNodes() << " nodes, height "
+                  << mapped.getHeight() << ":\n"
+                  << "  deserialize and one lookup: " << deserializeMillis << " ms\n"
+                  << "  open and one lookup: " << openMillis << " ms, " << nodesForLookup << " nodes read\n"
+                  << "  " << wrong << " of 201 queries differ from the in-memory tree, "
+                  << mapped.getNodesLoaded() << " nodes read by them" << std::endl;
+        if (!opened || wrong != 0 || fromMapped != fromLoaded || nodesForLookup != mapped.getHeight()) {
+            std::cerr << "Error: The large mapped index disagrees with the tree" << std::endl;
+            ok = false;
+        }
+
+        // A damaged leaf fails only the queries that reach it
+        std::vector<RecordId> values;
+        flipByte(mappedPath, 4096 * 1024);
+        UIntMappedBPTree damaged(mappedPath);
+        size_t failed = 0;
+        if (damaged.open()) {
+            for (uint32_t i = 0; i < SYNTHETIC_KEYS; i += 997) {
+                values.clear();
+                failed += !damaged.search(probes[i], values);
+            }
+        }
+        std::cout << "Lookups failed after damaging one byte: " << failed << " of "
+                  << (SYNTHETIC_KEYS + 996) / 997 << std::endl;
+        if (!damaged.isOpen() || failed == 0 || failed > 10) {
+            std::cerr << "Error: A damaged node was not confined to its own queries" << std::endl;
+            ok = false;
+        }
+
+        // A damaged header is refused at open
+        flipByte(mappedPath, 20);
+        UIntMappedBPTree badHeader(mappedPath);
+        if (badHeader.open()) {
+            std::cerr << "Error: A damaged header was accepted" << std::endl;
+            ok = false;
+        }
+    }
+
+    // An empty tree round trips
+    {
+        BPTree empty;
+        MappedBPTree mapped(mappedPath);
+        std::vector<RecordId> values;
+        if (!MappedBPTree::write(empty, mappedPath) || !mapped.open() || !mapped.rangeQuery(0.0f, 1.0f, values) ||
+            !values.empty()) {
+            std::cerr << "Error: The empty index did not round trip" << std::endl;
+            ok = false;
+        }
+    }
+
+    std::remove(mappedPath);
+    std::remove(fullPath);
+    if (!ok) {
+        return 1;
+    }
+    std::cout << "Mapped index test passed" << std::endl;
+    return 0;
+}
+// Compile with g++ -std=c++11 -O2 -pthread mapped_index_test.cc disk.cc bptree.cc ingest.cc record_block.cc mapped_bptree.cc -o mapped_index_test
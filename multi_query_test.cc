@@ -0,0 +1,99 @@
+#include "disk.h"
+#include "secondary_index.h"
+#include "query_planner.h"
+#include "record_block.h"
+#include <iostream>
+#include <vector>
+
+static bool sameRecord(const Record& a, const Record& b) {
+    return a.game_date_day == b.game_date_day && a.team_id_home == b.team_id_home && a.pts_home == b.pts_home &&
+           a.fg_pct_home == b.fg_pct_home && a.ft_pct_home == b.ft_pct_home && a.fg3_pct_home == b.fg3_pct_home &&
+           a.ast_home == b.ast_home && a.reb_home == b.reb_home && a.home_team_wins == b.home_team_wins;
+}
+
+// Both plans return records in RecordId order, so the lists must match one for one
+static bool sameRecords(const std::vector<Record>& a, const std::vector<Record>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (!sameRecord(a[i], b[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Answer the predicates by reading every block
+static std::vector<Record> scanAll(QueryPlanner& planner, const std::vector<ColumnRange>& predicates) {
+    QueryPlan scanPlan;
+    scanPlan.residual = predicates;
+    std::vector<Record> scanned;
+    planner.execute(scanPlan, scanned);
+    std::cout << "Full scan found " << scanned.size() << " records reading "
+              << planner.getStats().blocksRead << " data blocks" << std::endl;
+    return scanned;
+}
+
+int main() {
+    // Initialize the Disk
+    Disk disk("test_disk.db");
+
+    // Secondary indexes over several columns, built in one pass over the data file
+    SecondaryIndexes indexes(disk);
+    indexes.addIndex(COLUMN_TEAM_ID_HOME);
+    indexes.addIndex(COLUMN_PTS_HOME);
+    indexes.addIndex(COLUMN_FG_PCT_HOME);
+    indexes.addIndex(COLUMN_GAME_DATE_EST);
+    if (!indexes.build(0, disk.GetTotalBlocks())) {
+        return 1;
+    }
+    QueryPlanner planner(indexes);
+    bool ok = true;
+
+    // Home games of the Warriors with FG_PCT_home >= 0.5 and PTS_home >= 110,
+    // answered by intersecting all three indexes whatever the planner would pick
+    std::vector<ColumnRange> predicates;
+    predicates.push_back(ColumnRange(COLUMN_TEAM_ID_HOME, 1610612744, 1610612744));
+    predicates.push_back(ColumnRange(COLUMN_FG_PCT_HOME, 0.5, 1.0));
+    predicates.push_back(ColumnRange(COLUMN_PTS_HOME, 110, 1000));
+
+    QueryPlan intersectPlan;
+    intersectPlan.fullScan = false;
+    intersectPlan.indexRanges = predicates;
+    std::cout << "Intersecting the TEAM_ID_home, FG_PCT_home and PTS_home indexes" << std::endl;
+    std::vector<Record> records;
+    planner.execute(intersectPlan, records);
+    std::cout << "Number of records found: " << records.size() << std::endl;
+    planner.getStats().print();
+    if (planner.getStats().ridsAfterIntersection != records.size() || !sameRecords(records, scanAll(planner, predicates))) {
+        std::cerr << "Error: Intersecting the indexes and scanning the data file disagree" << std::endl;
+        ok = false;
+    }
+
+    // Selective enough for the planner to intersect indexes on its own: home
+    // games of the Warriors with PTS_home >= 130
+    std::vector<ColumnRange> selective;
+    selective.push_back(ColumnRange(COLUMN_TEAM_ID_HOME, 1610612744, 1610612744));
+    selective.push_back(ColumnRange(COLUMN_PTS_HOME, 130, 1000));
+    QueryPlan plan = planner.plan(selective);
+    plan.print();
+    std::vector<Record> selected;
+    planner.execute(plan, selected);
+    planner.getStats().print();
+    if (plan.fullScan || plan.indexRanges.size() < 2) {
+        std::cerr << "Error: The planner did not intersect indexes for a selective query" << std::endl;
+        ok = false;
+    }
+    if (!sameRecords(selected, scanAll(planner, selective))) {
+        std::cerr << "Error: The planner's plan and a full scan disagree" << std::endl;
+        ok = false;
+    }
+
+    if (!ok) {
+        return 1;
+    }
+    std::cout << "Multi query test passed" << std::endl;
+    return 0;
+}
+// Compile with g++ -std=c++11 -pthread multi_query_test.cc disk.cc async_io.cc bptree.cc record_block.cc range_scan.cc secondary_index.cc query_planner.cc -o multi_query_test
@@ -0,0 +1,322 @@
+// node_arena.h
+#ifndef NODE_ARENA_H
+#define NODE_ARENA_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Nodes of a BasicBPTree refer to each other by 32-bit ids into the tree's
+// NodeArena instead of by pointer
+typedef uint32_t NodeId;
+const NodeId INVALID_NODE_ID = 0xFFFFFFFF;
+
+// Fixed-capacity array stored inline, with the parts of the std::vector
+// interface the B+ tree nodes use. T must be trivially copyable: elements
+// are moved with memmove and left uninitialized until written, so creating
+// a node does not touch its arrays. Like the reserved vectors it replaces,
+// it never reallocates under an optimistic reader.
+template <typename T, uint32_t Capacity>
+class InlineVector {
+private:
+    uint32_t count;
+    T items[Capacity];
+
+public:
+    typedef T value_type;
+    typedef T* iterator;
+    typedef const T* const_iterator;
+
+    InlineVector() : count(0) {}
+
+    uint32_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    static uint32_t capacity() { return Capacity; }
+
+    T* data() { return items; }
+    const T* data() const { return items; }
+    T* begin() { return items; }
+    T* end() { return items + count; }
+    const T* begin() const { return items; }
+    const T* end() const { return items + count; }
+    T& operator[](size_t i) { return items[i]; }
+    const T& operator[](size_t i) const { return items[i]; }
+    T& front() { return items[0]; }
+    const T& front() const { return items[0]; }
+    T& back() { return items[count - 1]; }
+    const T& back() const { return items[count - 1]; }
+
+    void clear() { count = 0; }
+    void resize(uint32_t n) { count = n; }   // Shrinking, or growing into elements set afterwards
+    void push_back(const T& value) { items[count++] = value; }
+
+    T* insert(T* pos, const T& value) {
+        T copy = value;   // value may live in this array
+        std::memmove(pos + 1, pos, (end() - pos) * sizeof(T));
+        *pos = copy;
+        count++;
+        return pos;
+    }
+    // [first, last) must not overlap this array
+    T* insert(T* pos, const T* first, const T* last) {
+        size_t n = last - first;
+        std::memmove(pos + n, pos, (end() - pos) * sizeof(T));
+        std::memcpy(pos, first, n * sizeof(T));
+        count += static_cast<uint32_t>(n);
+        return pos;
+    }
+    T* erase(T* pos) { return erase(pos, pos + 1); }
+    T* erase(T* first, T* last) {
+        std::memmove(first, last, (end() - last) * sizeof(T));
+        count -= static_cast<uint32_t>(last - first);
+        return first;
+    }
+    void assign(const T* first, const T* last) {
+        count = static_cast<uint32_t>(last - first);
+        std::memmove(items, first, count * sizeof(T));
+    }
+};
+
+// Read-only view of one posting list: the values stored under one key
+template <typename Value>
+class PostingSpan {
+private:
+    const Value* first;
+    const Value* last;
+
+public:
+    PostingSpan(const Value* first, const Value* last) : first(first), last(last) {}
+
+    const Value* begin() const { return first; }
+    const Value* end() const { return last; }
+    size_t size() const { return last - first; }
+    bool empty() const { return first == last; }
+    const Value& operator[](size_t i) const { return first[i]; }
+};
+
+// The posting lists of one leaf, one per key, packed into a single value
+// array. Each list owns a slice of the array sized to the next power of two
+// of its length, so the slice size need not be stored; a list that outgrows
+// its slice moves to the end of the array with twice the room, so appending
+// stays amortized O(1). The slices left behind are reclaimed by compacting
+// the array once they make up more than half of it.
+template <typename Value, uint32_t MaxLists>
+class PostingLists {
+private:
+    struct Extent {
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    InlineVector<Extent, MaxLists> extents;
+    std::vector<Value> values;
+    size_t wasted;   // Slots of values no list owns
+
+    // Slots of the slice of a list of size values
+    static uint32_t capacityFor(uint32_t size) { return size < 2 ? size : 1u << (32 - __builtin_clz(size - 1)); }
+
+    // A slice at the end of values for a list of size values
+    Extent grow(uint32_t size) {
+        Extent extent = {static_cast<uint32_t>(values.size()), size};
+        values.resize(values.size() + capacityFor(size));
+        return extent;
+    }
+
+    void release(const Extent& extent) {
+        if (extent.offset + capacityFor(extent.size) == values.size()) {
+            values.resize(extent.offset);
+        } else {
+            wasted += capacityFor(extent.size);
+        }
+    }
+
+    void compactIfSparse() {
+        if (wasted > 0 && wasted * 2 >= values.size()) {
+            compact();
+        }
+    }
+
+public:
+    PostingLists() : wasted(0) {}
+
+    uint32_t size() const { return extents.size(); }
+    bool empty() const { return extents.empty(); }
+
+    PostingSpan<Value> operator[](uint32_t i) const {
+        const Value* first = values.data() + extents[i].offset;
+        return PostingSpan<Value>(first, first + extents[i].size);
+    }
+
+    // Bytes held by the value array, including room to grow
+    size_t capacityBytes() const { return values.capacity() * sizeof(Value); }
+
+    // Add value to the end of list i
+    void append(uint32_t i, const Value& value) {
+        Extent& extent = extents[i];
+        uint32_t capacity = capacityFor(extent.size);
+        if (extent.size == capacity) {
+            if (extent.offset + capacity == values.size()) {
+                values.resize(extent.offset + capacityFor(extent.size + 1));
+            } else {
+                Extent moved = grow(extent.size + 1);
+                std::copy(values.begin() + extent.offset, values.begin() + extent.offset + extent.size,
+                          values.begin() + moved.offset);
+                wasted += capacity;
+                extent.offset = moved.offset;
+            }
+        }
+        values[extent.offset + extent.size++] = value;
+    }
+
+    // New list holding just value at position i
+    void insert(uint32_t i, const Value& value) {
+        Extent extent = grow(1);
+        values[extent.offset] = value;
+        extents.insert(extents.begin() + i, extent);
+    }
+
+    // Copies of lists [first, last) of from at position i
+    void insert(uint32_t i, const PostingLists& from, uint32_t first, uint32_t last) {
+        Extent copied[MaxLists];
+        for (uint32_t j = first; j < last; ++j) {
+            PostingSpan<Value> list = from[j];
+            copied[j - first] = grow(static_cast<uint32_t>(list.size()));
+            std::copy(list.begin(), list.end(), values.begin() + copied[j - first].offset);
+        }
+        extents.insert(extents.begin() + i, copied, copied + (last - first));
+    }
+
+    // Room for lists totalling count values without reallocating
+    void reserve(size_t count) { values.reserve(count); }
+
+    // New list at the end holding count values
+    void push_back(const Value* first, uint32_t count) {
+        Extent extent = grow(count);
+        std::copy(first, first + count, values.begin() + extent.offset);
+        extents.push_back(extent);
+    }
+
+    void erase(uint32_t first, uint32_t last) {
+        // Later slices first, so the ones at the end of the array are trimmed off it
+        std::vector<Extent> dropped(extents.begin() + first, extents.begin() + last);
+        std::sort(dropped.begin(), dropped.end(),
+                  [](const Extent& a, const Extent& b) { return a.offset > b.offset; });
+        for (const Extent& extent : dropped) {
+            release(extent);
+        }
+        extents.erase(extents.begin() + first, extents.begin() + last);
+        compactIfSparse();
+    }
+    void resize(uint32_t n) { erase(n, extents.size()); }
+
+    void clear() {
+        extents.clear();
+        values.clear();
+        wasted = 0;
+    }
+
+    // Store the slices back to back in key order, dropping the unused ones
+    void compact() {
+        std::vector<Value> packed;
+        packed.reserve(values.size() - wasted);
+        for (Extent& extent : extents) {
+            uint32_t offset = static_cast<uint32_t>(packed.size());
+            packed.insert(packed.end(), values.begin() + extent.offset,
+                          values.begin() + extent.offset + extent.size);
+            packed.resize(offset + capacityFor(extent.size));
+            extent.offset = offset;
+        }
+        values.swap(packed);
+        wasted = 0;
+    }
+};
+
+// Storage for the nodes of one tree, addressed by NodeId. Chunk c holds 2^c
+// nodes, so an id maps to its chunk with one bit scan and nodes never move
+// once allocated: an optimistic reader can turn a child id into a pointer
+// without a latch, and must only validate before dereferencing it. Released
+// ids are reused. allocate may be called from several threads at once;
+// release and clear need the tree to themselves.
+template <typename Node>
+class NodeArena {
+private:
+    static const int MAX_CHUNKS = 32;
+
+    std::atomic<Node*> chunks[MAX_CHUNKS];
+    NodeId nextId;                  // Ids below it have been handed out
+    std::vector<NodeId> freeIds;    // Released ids, their nodes destroyed
+    std::mutex mutex;
+
+    static int chunkOf(NodeId id) { return 31 - __builtin_clz((id + 1) | 1); }
+
+    void destroyAll() {
+        std::sort(freeIds.begin(), freeIds.end());
+        size_t f = 0;
+        for (NodeId id = 0; id < nextId; ++id) {
+            if (f < freeIds.size() && freeIds[f] == id) {
+                f++;
+            } else {
+                get(id)->~Node();
+            }
+        }
+        freeIds.clear();
+        nextId = 0;
+    }
+
+public:
+    NodeArena() : nextId(0) {
+        for (int c = 0; c < MAX_CHUNKS; ++c) {
+            chunks[c].store(nullptr);
+        }
+    }
+    ~NodeArena() {
+        destroyAll();
+        for (int c = 0; c < MAX_CHUNKS; ++c) {
+            ::operator delete(chunks[c].load());
+        }
+    }
+    NodeArena(const NodeArena&) = delete;
+    NodeArena& operator=(const NodeArena&) = delete;
+
+    // Construct a node from args (after its own id) and return its id
+    template <typename... Args>
+    NodeId allocate(Args&&... args) {
+        std::lock_guard<std::mutex> lock(mutex);
+        NodeId id;
+        if (!freeIds.empty()) {
+            id = freeIds.back();
+            freeIds.pop_back();
+        } else {
+            id = nextId;
+            int c = chunkOf(id);
+            if (!chunks[c].load()) {
+                chunks[c].store(static_cast<Node*>(::operator new(sizeof(Node) << c)), std::memory_order_release);
+            }
+            nextId++;
+        }
+        new (get(id)) Node(id, std::forward<Args>(args)...);
+        return id;
+    }
+
+    Node* get(NodeId id) const {
+        int c = chunkOf(id);
+        return chunks[c].load(std::memory_order_acquire) + (id + 1 - (1u << c));
+    }
+
+    void release(NodeId id) {
+        get(id)->~Node();
+        freeIds.push_back(id);
+    }
+
+    // Destroy every node; the chunks stay allocated for reuse
+    void clear() { destroyAll(); }
+
+    size_t liveNodes() const { return nextId - freeIds.size(); }
+};
+
+#endif // NODE_ARENA_H
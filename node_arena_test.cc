@@ -0,0 +1,170 @@
+#include "disk.h"
+#include "bptree.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <malloc.h>
+#include <map>
+#include <new>
+#include <random>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+const uint32_t NUM_KEYS = 1000000;   // Distinct keys of the large trees
+
+// Every heap allocation of the process, so the trees' share can be measured.
+// Bytes are counted as the allocator hands them out, rounding included.
+static std::atomic<size_t> allocations(0);
+static std::atomic<size_t> liveBytes(0);
+
+void* operator new(size_t size) {
+    void* p = std::malloc(size);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    allocations++;
+    liveBytes += malloc_usable_size(p);
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    if (p) {
+        liveBytes -= malloc_usable_size(p);
+        std::free(p);
+    }
+}
+
+static double millisSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Heap use of building a tree (also returned in bytes), then the time of
+// point lookups and of a scan over all of it
+template <typename Build>
+static bool measure(const char* name, const std::vector<uint32_t>& probes, Build build, size_t& bytes) {
+    size_t allocationsBefore = allocations.load(), bytesBefore = liveBytes.load();
+    Clock::time_point start = Clock::now();
+    UIntBPTree* tree = new UIntBPTree();
+    build(*tree);
+    double buildMillis = millisSince(start);
+    size_t treeAllocations = allocations.load() - allocationsBefore;
+    size_t treeBytes = liveBytes.load() - bytesBefore;
+
+    start = Clock::now();
+    size_t found = 0;
+    for (uint32_t key : probes) {
+        found += tree->search(key).size();
+    }
+    double lookupMillis = millisSince(start);
+
+    start = Clock::now();
+    std::vector<RecordId> all;
+    tree->collectRange(0, NUM_KEYS * 2, true, all);
+    double scanMillis = millisSince(start);
+
+    std::cout << name << ": " << tree->getNumberOfNodes() << " nodes, " << treeAllocations << " allocations, "
+              << treeBytes / (1024 * 1024) << " MB (" << treeBytes / NUM_KEYS << " bytes per key), built in "
+              << buildMillis << " ms\n"
+              << "  " << probes.size() << " lookups: " << lookupMillis << " ms, full scan: " << scanMillis << " ms"
+              << std::endl;
+    bool ok = found == probes.size() && all.size() == NUM_KEYS && tree->checkStructure();
+    delete tree;
+    bytes = treeBytes;
+    return ok;
+}
+
+// Random inserts with duplicate keys and removeRange, checked against a
+// std::multimap after every step
+static bool checkAgainstReference(Disk& disk) {
+    std::mt19937 rng(25);
+    std::uniform_int_distribution<uint32_t> key(0, 200000);
+    UIntBPTree tree;
+    std::multimap<uint32_t, RecordId> reference;
+    for (int step = 0; step < 200; ++step) {
+        for (int i = 0; i < 1000; ++i) {
+            uint32_t k = key(rng);
+            RecordId rid = static_cast<RecordId>(rng());
+            tree.insert(k, rid, disk);
+            reference.insert(std::make_pair(k, rid));
+        }
+        uint32_t lo = key(rng), hi = lo + key(rng) / (step % 5 == 0 ? 4 : 200);
+        std::vector<RecordId> removed = tree.removeRange(lo, hi);
+        size_t expectedRemoved = 0;
+        for (auto it = reference.lower_bound(lo); it != reference.end() && it->first <= hi;) {
+            it = reference.erase(it);
+            expectedRemoved++;
+        }
+
+        std::vector<RecordId> all, expected;
+        tree.collectRange(0, 400000, true, all);
+        for (const auto& entry : reference) {
+            expected.push_back(entry.second);
+        }
+        // Equal keys keep their values in insertion order, as the multimap does
+        size_t expectedCount = std::distance(reference.lower_bound(lo / 2), reference.upper_bound(lo / 2 + 5000));
+        if (removed.size() != expectedRemoved || all != expected || !tree.checkStructure() ||
+            tree.countRange(lo / 2, lo / 2 + 5000) != expectedCount) {
+            std::cerr << "Error: The tree disagrees with the reference after step " << step << std::endl;
+            return false;
+        }
+    }
+    std::cout << "200 rounds of inserts and removeRange match the reference, "
+              << tree.getNumberOfNodes() << " nodes left" << std::endl;
+    return true;
+}
+
+int main() {
+    const char* dataPath = "node_arena_disk.db";
+    const char* treePath = "node_arena_tree.dat";
+    std::remove(dataPath);
+    bool ok = true;
+    {
+        Disk disk(dataPath);
+        ok = checkAgainstReference(disk);
+
+        std::mt19937 rng(2025);
+        std::vector<uint32_t> keys;
+        std::vector<std::pair<uint32_t, RecordId>> entries;
+        for (uint32_t i = 0; i < NUM_KEYS; ++i) {
+            keys.push_back(i * 2);
+            entries.push_back(std::make_pair(i * 2, static_cast<RecordId>(i)));
+        }
+        std::vector<uint32_t> probes;
+        for (int i = 0; i < 1000000; ++i) {
+            probes.push_back(keys[rng() % NUM_KEYS]);
+        }
+        std::shuffle(keys.begin(), keys.end(), rng);
+
+        size_t bulkLoadBytes = 0, deserializeBytes = 0, insertBytes = 0;
+        ok = measure("bulkLoad", probes, [&](UIntBPTree& tree) { tree.bulkLoad(entries); }, bulkLoadBytes) && ok;
+        {
+            UIntBPTree source;
+            source.bulkLoad(entries);
+            source.serialize(treePath);
+        }
+        // A loaded tree takes no more memory than the one it was saved from
+        ok = measure("deserialize", probes, [&](UIntBPTree& tree) { tree.deserialize(treePath); }, deserializeBytes) &&
+             deserializeBytes <= bulkLoadBytes + bulkLoadBytes / 20 && ok;
+        ok = measure("Random inserts", probes,
+                     [&](UIntBPTree& tree) {
+                         for (uint32_t key : keys) {
+                             tree.insert(key, static_cast<RecordId>(key / 2), disk);
+                         }
+                     },
+                     insertBytes) &&
+             ok;
+    }
+    std::remove(dataPath);
+    std::remove(treePath);
+    if (!ok) {
+        std::cerr << "Error: Node arena test failed" << std::endl;
+        return 1;
+    }
+    std::cout << "Node arena test passed" << std::endl;
+    return 0;
+}
+// Compile with g++ -std=c++11 -O2 -pthread node_arena_test.cc disk.cc bptree.cc -o node_arena_test
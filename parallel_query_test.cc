@@ -0,0 +1,108 @@
+#include "disk.h"
+#include "bptree.h"
+#include "ingest.h"
+#include "range_scan.h"
+#include "parallel_range.h"
+#include "thread_pool.h"
+#include "record_block.h"
+#include "test_util.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+// Ordered output must follow the index: FG_PCT_home never decreases
+static bool inKeyOrder(const std::vector<Record>& records) {
+    for (size_t i = 1; i < records.size(); ++i) {
+        if (records[i].fg_pct_home < records[i - 1].fg_pct_home) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    // With a games.txt-style file, load it into a scratch data file first;
+    // otherwise query test_disk.db through bptree_structure.dat
+    const char* scratchPath = "parallel_disk.db";
+    bool scratch = argc > 1;
+    if (scratch) {
+        std::remove(scratchPath);
+    }
+    Disk disk(scratch ? scratchPath : "test_disk.db");
+    BPTree bptree;
+    if (scratch) {
+        std::vector<std::pair<float, RecordId>> entries;
+        IngestStats ingestStats;
+        if (!loadGames(argv[1], disk, &entries, ingestStats)) {
+            return 1;
+        }
+        std::sort(entries.begin(), entries.end());
+        if (!bptree.bulkLoad(entries)) {
+            return 1;
+        }
+    } else {
+        bptree.deserialize("bptree_structure.dat");
+    }
+
+    // Wide analytical range with a filter on another column
+    float startKey = 0.3f;
+    float endKey = 0.7f;
+    RangeScanExecutor::Predicate predicate = [](const RecordView& record) { return record.ptsHome() >= 100; };
+
+    // Single-threaded baseline: leaf walk, then one RangeScanExecutor
+    std::vector<double> millis;
+    size_t expected = 0;
+    for (int run = 0; run < REPEATS; ++run) {
+        Clock::time_point start = Clock::now();
+        std::vector<RecordId> rids = bptree.rangeQuery(startKey, endKey, disk);
+        RangeScanExecutor scan(disk);
+        std::vector<Record> records;
+        expected = scan.execute(rids, predicate, records);
+        millis.push_back(millisSince(start));
+    }
+    double baseline = medianMillis(millis);
+    std::cout << "Records with FG_PCT_home in [" << startKey << ", " << endKey << "] and PTS_home >= 100: "
+              << expected << std::endl;
+    std::cout << "Single thread: " << baseline << " ms" << std::endl;
+
+    unsigned maxThreads = argc > 2 ? std::atoi(argv[2]) : 8;
+    bool ok = true;
+    for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+        WorkStealingPool pool(threads);
+        ParallelRangeExecutor executor(bptree, disk, pool);
+        millis.clear();
+        std::vector<Record> records;
+        for (int run = 0; run < REPEATS; ++run) {
+            records.clear();
+            Clock::time_point start = Clock::now();
+            executor.execute(startKey, endKey, predicate, records);
+            millis.push_back(millisSince(start));
+        }
+        double parallel = medianMillis(millis);
+
+        size_t streamed = 0;
+        executor.executeUnordered(startKey, endKey, predicate,
+                                  [&streamed](const std::vector<Record>& batch) { streamed += batch.size(); });
+
+        std::cout << threads << " thread(s): " << parallel << " ms (" << baseline / parallel << "x), "
+                  << executor.getStats().keyPartitions << " key partitions, " << executor.getStats().fetchTasks
+                  << " block range tasks, " << executor.getStats().blocksRead << " blocks read, "
+                  << executor.getStats().steals << " steals" << std::endl;
+        if (records.size() != expected || streamed != expected || !inKeyOrder(records)) {
+            std::cerr << "Error: Parallel results differ from the single-threaded scan" << std::endl;
+            ok = false;
+        }
+    }
+
+    if (scratch) {
+        std::remove(scratchPath);
+    }
+    if (!ok) {
+        return 1;
+    }
+    std::cout << "Parallel range test passed" << std::endl;
+    return 0;
+}
+// Compile with g++ -std=c++11 -O2 -pthread parallel_query_test.cc disk.cc bptree.cc ingest.cc async_io.cc range_scan.cc parallel_range.cc thread_pool.cc record_block.cc -o parallel_query_test
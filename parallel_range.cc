@@ -0,0 +1,194 @@
+// parallel_range.cc
+#include "parallel_range.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+
+typedef std::chrono::steady_clock Clock;
+
+static double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void ParallelRangeStats::print() const {
+    std::cout << "Parallel range statistics:\n";
+    std::cout << "Key partitions: " << keyPartitions << "\n";
+    std::cout << "Block range tasks: " << fetchTasks << "\n";
+    std::cout << "Record ids: " << recordIds << "\n";
+    std::cout << "Data blocks read: " << blocksRead << "\n";
+    std::cout << "Records matched: " << recordsMatched << "\n";
+    std::cout << "Tasks stolen: " << steals << "\n";
+    std::cout << "Leaf walk: " << walkSeconds * 1000 << " ms, block reads: " << fetchSeconds * 1000 << " ms\n";
+}
+
+// Constructor
+ParallelRangeExecutor::ParallelRangeExecutor(BPTree& index, Disk& disk, WorkStealingPool& pool,
+                                             unsigned tasksPerThread)
+    : index(index),
+      disk(disk),
+      pool(pool),
+      tasksPerThread(tasksPerThread == 0 ? 1 : tasksPerThread) {}
+
+std::vector<RecordId> ParallelRangeExecutor::collectRecordIds(float startKey, float endKey) {
+    Clock::time_point start = Clock::now();
+    std::vector<float> cuts = index.splitKeys(startKey, endKey, static_cast<size_t>(pool.size()) * tasksPerThread);
+    size_t numParts = cuts.size() + 1;
+    stats.keyPartitions = numParts;
+
+    // Part p covers [cuts[p - 1], cuts[p]); the first starts at startKey, the last ends at endKey inclusive
+    std::vector<std::vector<RecordId>> partIds(numParts);
+    std::vector<WorkStealingPool::Task> tasks;
+    for (size_t p = 0; p < numParts; ++p) {
+        float low = p == 0 ? startKey : cuts[p - 1];
+        float high = p + 1 == numParts ? endKey : cuts[p];
+        bool includeHigh = p + 1 == numParts;
+        std::vector<RecordId>* ids = &partIds[p];
+        tasks.push_back([this, low, high, includeHigh, ids]() { index.collectRange(low, high, includeHigh, *ids); });
+    }
+    pool.runAll(tasks);
+
+    std::vector<RecordId> rids;
+    for (const std::vector<RecordId>& ids : partIds) {
+        rids.insert(rids.end(), ids.begin(), ids.end());
+    }
+    stats.recordIds = rids.size();
+    stats.walkSeconds = secondsSince(start);
+    return rids;
+}
+
+size_t ParallelRangeExecutor::fetch(const std::vector<RecordId>& sortedIds, const Predicate& predicate,
+                                    std::vector<Record>* slots, std::vector<uint8_t>* matched,
+                                    const RecordSink* sink) {
+    Clock::time_point start = Clock::now();
+    if (sortedIds.empty()) {
+        return 0;
+    }
+
+    // Cut the ids into runs of about the same number of distinct blocks,
+    // never splitting one block between two tasks
+    size_t distinctBlocks = 1;
+    for (size_t i = 1; i < sortedIds.size(); ++i) {
+        distinctBlocks += recordIdBlock(sortedIds[i]) != recordIdBlock(sortedIds[i - 1]);
+    }
+    size_t maxTasks = static_cast<size_t>(pool.size()) * tasksPerThread;
+    size_t blocksPerTask = (distinctBlocks + maxTasks - 1) / maxTasks;
+
+    std::atomic<size_t> blocksRead(0), recordsMatched(0);
+    std::mutex sinkMutex;
+    std::vector<WorkStealingPool::Task> tasks;
+    size_t begin = 0;
+    while (begin < sortedIds.size()) {
+        size_t end = begin + 1;
+        size_t blocks = 1;
+        while (end < sortedIds.size()) {
+            if (recordIdBlock(sortedIds[end]) != recordIdBlock(sortedIds[end - 1])) {
+                if (blocks == blocksPerTask) {
+                    break;
+                }
+                blocks++;
+            }
+            end++;
+        }
+
+        tasks.push_back([&, begin, end]() {
+            std::vector<RecordId> ids(sortedIds.begin() + begin, sortedIds.begin() + end);
+            RangeScanExecutor scan(disk);
+            std::vector<Record> records;
+            std::vector<RecordId> matchedIds;
+            scan.execute(ids, predicate, records, slots ? &matchedIds : nullptr);
+            blocksRead += scan.getStats().distinctBlocks;
+            recordsMatched += records.size();
+
+            if (slots) {
+                // Both lists are in RecordId order
+                size_t j = begin;
+                for (size_t k = 0; k < matchedIds.size(); ++k) {
+                    while (sortedIds[j] != matchedIds[k]) j++;
+                    (*slots)[j] = records[k];
+                    (*matched)[j] = 1;
+                }
+            } else if (!records.empty()) {
+                std::lock_guard<std::mutex> lock(sinkMutex);
+                (*sink)(records);
+            }
+        });
+        begin = end;
+    }
+    stats.fetchTasks = tasks.size();
+    pool.runAll(tasks);
+
+    stats.blocksRead = blocksRead;
+    stats.recordsMatched = recordsMatched;
+    stats.fetchSeconds = secondsSince(start);
+    return recordsMatched;
+}
+
+size_t ParallelRangeExecutor::execute(float startKey, float endKey, const Predicate& predicate,
+                                      std::vector<Record>& results) {
+    stats = ParallelRangeStats();
+    pool.resetSteals();
+    std::vector<RecordId> keyOrder = collectRecordIds(startKey, endKey);
+
+    if (keyOrder.empty()) {
+        return 0;
+    }
+
+    // Sort and deduplicate the ids with a table over every slot of the blocks
+    // they span, which also maps each id to its position in the sorted list;
+    // a wide range touches most slots of that span anyway
+    const uint32_t notListed = 0xFFFFFFFFu;
+    uint32_t minBlock = recordIdBlock(keyOrder[0]), maxBlock = minBlock;
+    for (RecordId rid : keyOrder) {
+        minBlock = std::min(minBlock, recordIdBlock(rid));
+        maxBlock = std::max(maxBlock, recordIdBlock(rid));
+    }
+    std::vector<uint32_t> position((maxBlock - minBlock + 1) * MAX_RECORDS_PER_BLOCK, notListed);
+    for (RecordId rid : keyOrder) {
+        if (recordIdSlot(rid) < MAX_RECORDS_PER_BLOCK) {
+            position[(recordIdBlock(rid) - minBlock) * MAX_RECORDS_PER_BLOCK + recordIdSlot(rid)] = 0;
+        }
+    }
+    std::vector<RecordId> sortedIds;
+    for (size_t k = 0; k < position.size(); ++k) {
+        if (position[k] != notListed) {
+            position[k] = static_cast<uint32_t>(sortedIds.size());
+            sortedIds.push_back(makeRecordId(minBlock + static_cast<uint32_t>(k / MAX_RECORDS_PER_BLOCK),
+                                             static_cast<uint32_t>(k % MAX_RECORDS_PER_BLOCK)));
+        }
+    }
+
+    // Each task stores its records at their ids' positions in sortedIds
+    std::vector<Record> fetched(sortedIds.size());
+    std::vector<uint8_t> matched(sortedIds.size(), 0);
+    fetch(sortedIds, predicate, &fetched, &matched, nullptr);
+
+    // Emit them in the order the index returned their ids
+    size_t added = 0;
+    results.reserve(results.size() + sortedIds.size());
+    for (RecordId rid : keyOrder) {
+        if (recordIdSlot(rid) >= MAX_RECORDS_PER_BLOCK) {
+            continue;
+        }
+        uint32_t j = position[(recordIdBlock(rid) - minBlock) * MAX_RECORDS_PER_BLOCK + recordIdSlot(rid)];
+        if (matched[j]) {
+            results.push_back(fetched[j]);
+            added++;
+        }
+    }
+    stats.steals = pool.getSteals();
+    return added;
+}
+
+size_t ParallelRangeExecutor::executeUnordered(float startKey, float endKey, const Predicate& predicate,
+                                               const RecordSink& sink) {
+    stats = ParallelRangeStats();
+    pool.resetSteals();
+    std::vector<RecordId> sortedIds = collectRecordIds(startKey, endKey);
+    std::sort(sortedIds.begin(), sortedIds.end());
+    sortedIds.erase(std::unique(sortedIds.begin(), sortedIds.end()), sortedIds.end());
+    size_t added = fetch(sortedIds, predicate, nullptr, nullptr, &sink);
+    stats.steals = pool.getSteals();
+    return added;
+}
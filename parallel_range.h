@@ -0,0 +1,76 @@
+// parallel_range.h
+#ifndef PARALLEL_RANGE_H
+#define PARALLEL_RANGE_H
+
+#include <functional>
+#include <vector>
+#include "bptree.h"
+#include "disk.h"
+#include "range_scan.h"
+#include "thread_pool.h"
+
+const unsigned DEFAULT_TASKS_PER_THREAD = 4;   // Extra tasks per worker for stealing to balance out
+
+// Work done by one ParallelRangeExecutor call
+struct ParallelRangeStats {
+    size_t keyPartitions;   // Sub-ranges of the key range walked in parallel
+    size_t fetchTasks;      // Disjoint block ranges read in parallel
+    size_t recordIds;
+    size_t blocksRead;
+    size_t recordsMatched;
+    uint64_t steals;        // Tasks a worker took from another worker's queue
+    double walkSeconds;     // Leaf walks
+    double fetchSeconds;    // Block reads and predicate
+
+    ParallelRangeStats()
+        : keyPartitions(0), fetchTasks(0), recordIds(0), blocksRead(0), recordsMatched(0), steals(0),
+          walkSeconds(0), fetchSeconds(0) {}
+    void print() const;
+};
+
+// Runs a range query over the FG_PCT_home index on a WorkStealingPool.
+//
+// The key range is cut at separator keys of the tree's inner nodes
+// (BPTree::splitKeys) and each sub-range's leaves are walked by one task.
+// The index is not clustered, so records of neighbouring keys sit in the
+// same blocks all over the file: fetching per key partition would read most
+// blocks once per partition. The RecordIds of all partitions are therefore
+// sorted once and the data file is split into disjoint block ranges, one
+// RangeScanExecutor task each, so every block is still read exactly once.
+class ParallelRangeExecutor {
+public:
+    typedef RangeScanExecutor::Predicate Predicate;
+    // Receives matching records in batches; calls are serialized
+    typedef std::function<void(const std::vector<Record>&)> RecordSink;
+
+    ParallelRangeExecutor(BPTree& index, Disk& disk, WorkStealingPool& pool,
+                          unsigned tasksPerThread = DEFAULT_TASKS_PER_THREAD);
+
+    // Append the matching records to results in key order (FG_PCT_home, then
+    // RecordId, as rangeQuery returns them) and return how many were added
+    size_t execute(float startKey, float endKey, const Predicate& predicate, std::vector<Record>& results);
+
+    // Hand the matching records to sink as each block range is read, in no
+    // particular order; returns how many there were
+    size_t executeUnordered(float startKey, float endKey, const Predicate& predicate, const RecordSink& sink);
+
+    const ParallelRangeStats& getStats() const { return stats; }
+
+private:
+    BPTree& index;
+    Disk& disk;
+    WorkStealingPool& pool;
+    unsigned tasksPerThread;
+    ParallelRangeStats stats;
+
+    // RecordIds of [startKey, endKey] in key order, one leaf walk per partition
+    std::vector<RecordId> collectRecordIds(float startKey, float endKey);
+
+    // Read the blocks of the sorted, distinct ids. With slots, the record for
+    // sortedIds[i] is stored at slots[i] and matched[i] is set; with a sink,
+    // each task's records go to it instead.
+    size_t fetch(const std::vector<RecordId>& sortedIds, const Predicate& predicate, std::vector<Record>* slots,
+                 std::vector<uint8_t>* matched, const RecordSink* sink);
+};
+
+#endif // PARALLEL_RANGE_H
@@ -0,0 +1,174 @@
+// query_planner.cc
+#include "query_planner.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <iterator>
+#include <iomanip>
+
+void QueryPlan::print() const {
+    std::cout << "Query plan: " << std::setprecision(12);
+    if (fullScan) {
+        std::cout << "full scan";
+    } else {
+        std::cout << "intersect";
+        for (const ColumnRange& range : indexRanges) {
+            std::cout << " " << columnName(range.column) << "[" << range.low << ", " << range.high << "]";
+        }
+    }
+    if (!residual.empty()) {
+        std::cout << ", then filter";
+        for (const ColumnRange& range : residual) {
+            std::cout << " " << columnName(range.column) << "[" << range.low << ", " << range.high << "]";
+        }
+    }
+    std::cout << std::setprecision(6) << "\nEstimated rows: " << static_cast<size_t>(estimatedRows + 0.5)
+              << ", estimated cost: " << estimatedCost << " block reads (full scan: " << fullScanCost << ")\n";
+}
+
+void QueryStats::print() const {
+    std::cout << "Query statistics:\n";
+    std::cout << "Record ids from indexes: " << ridsFetched << "\n";
+    std::cout << "Record ids after intersection: " << ridsAfterIntersection << "\n";
+    std::cout << "Data blocks read: " << blocksRead << "\n";
+    std::cout << "Records matched: " << recordsMatched << "\n";
+}
+
+// Constructor
+QueryPlanner::QueryPlanner(SecondaryIndexes& indexes) : indexes(indexes) {}
+
+double QueryPlanner::fetchCost(double rows) const {
+    // Rows spread uniformly over B blocks touch B * (1 - (1 - 1/B)^rows) of them
+    double blocks = indexes.getNumBlocks();
+    if (blocks <= 0.0 || rows <= 0.0) {
+        return 0.0;
+    }
+    double touched = blocks * (1.0 - std::pow(1.0 - 1.0 / blocks, rows));
+    return PLANNER_RANDOM_BLOCK_COST * std::min(touched, rows);
+}
+
+QueryPlan QueryPlanner::plan(const std::vector<ColumnRange>& predicates) const {
+    QueryPlan plan;
+    double totalRows = static_cast<double>(indexes.getNumRecords());
+    plan.fullScanCost = indexes.getNumBlocks();
+
+    // Exact match count of every predicate that has an index
+    std::vector<std::pair<size_t, size_t>> candidates;   // (count, predicate position)
+    for (size_t i = 0; i < predicates.size(); ++i) {
+        if (indexes.hasIndex(predicates[i].column)) {
+            candidates.push_back(std::make_pair(indexes.countRange(predicates[i]), i));
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+
+    // Cheapest prefix of the candidates, most selective first
+    size_t bestPrefix = 0;
+    double bestCost = plan.fullScanCost;
+    double lookupCost = 0.0;
+    double rows = totalRows;
+    std::vector<double> prefixRows(1, totalRows);
+    for (size_t k = 0; k < candidates.size(); ++k) {
+        double count = static_cast<double>(candidates[k].first);
+        lookupCost += count / PLANNER_INDEX_ENTRIES_PER_BLOCK;
+        rows = totalRows > 0.0 ? rows * (count / totalRows) : 0.0;
+        prefixRows.push_back(rows);
+        double cost = lookupCost + fetchCost(rows);
+        if (cost < bestCost) {
+            bestCost = cost;
+            bestPrefix = k + 1;
+        }
+    }
+
+    std::vector<bool> usesIndex(predicates.size(), false);
+    for (size_t k = 0; k < bestPrefix; ++k) {
+        usesIndex[candidates[k].second] = true;
+        plan.indexRanges.push_back(predicates[candidates[k].second]);
+    }
+    for (size_t i = 0; i < predicates.size(); ++i) {
+        if (!usesIndex[i]) {
+            plan.residual.push_back(predicates[i]);
+        }
+    }
+    plan.fullScan = bestPrefix == 0;
+    plan.estimatedCost = bestCost;
+
+    // Rows left after the residual predicates too, where they have an index to estimate with
+    rows = prefixRows[bestPrefix];
+    for (size_t k = bestPrefix; k < candidates.size(); ++k) {
+        rows = totalRows > 0.0 ? rows * (candidates[k].first / totalRows) : 0.0;
+    }
+    plan.estimatedRows = rows;
+    return plan;
+}
+
+size_t QueryPlanner::execute(const QueryPlan& plan, std::vector<Record>& results) {
+    stats = QueryStats();
+    const std::vector<ColumnRange>& residual = plan.residual;
+    RangeScanExecutor::Predicate predicate;
+    if (!residual.empty()) {
+        predicate = [&residual](const RecordView& record) {
+            for (const ColumnRange& range : residual) {
+                if (!matchesRange(record, range)) {
+                    return false;
+                }
+            }
+            return true;
+        };
+    }
+
+    Disk& disk = indexes.getDisk();
+    if (plan.fullScan) {
+        uint32_t firstBlock = indexes.getFirstBlock();
+        uint32_t numBlocks = indexes.getNumBlocks();
+        std::vector<uint8_t> runBuffer(static_cast<size_t>(DEFAULT_SCAN_RUN_BLOCKS) * BLOCK_SIZE);
+        disk.AdviseAccess(Disk::ACCESS_SEQUENTIAL);
+        size_t added = 0;
+        for (uint32_t block = 0; block < numBlocks; block += DEFAULT_SCAN_RUN_BLOCKS) {
+            uint32_t runLength = std::min<uint32_t>(DEFAULT_SCAN_RUN_BLOCKS, numBlocks - block);
+            if (!disk.ReadBlocks(firstBlock + block, runLength, runBuffer.data())) {
+                std::cerr << "Error: Failed to read data blocks during a full scan." << std::endl;
+                break;
+            }
+            stats.blocksRead += runLength;
+            for (uint32_t b = 0; b < runLength; ++b) {
+                BlockView view(&runBuffer[static_cast<size_t>(b) * BLOCK_SIZE]);
+                for (uint32_t slot = 0; slot < view.numRecords(); ++slot) {
+                    if (view.isDeleted(slot)) {
+                        continue;
+                    }
+                    RecordView record = view.record(slot);
+                    if (!predicate || predicate(record)) {
+                        results.push_back(record.toRecord());
+                        added++;
+                    }
+                }
+            }
+        }
+        stats.recordsMatched = added;
+        return added;
+    }
+
+    // Intersect the sorted RecordId lists, smallest first, before touching the data file
+    std::vector<RecordId> rids;
+    for (size_t k = 0; k < plan.indexRanges.size(); ++k) {
+        std::vector<RecordId> next = indexes.lookupRange(plan.indexRanges[k]);
+        stats.ridsFetched += next.size();
+        if (k == 0) {
+            rids.swap(next);
+        } else {
+            std::vector<RecordId> both;
+            std::set_intersection(rids.begin(), rids.end(), next.begin(), next.end(), std::back_inserter(both));
+            rids.swap(both);
+        }
+        if (rids.empty()) {
+            break;
+        }
+    }
+    stats.ridsAfterIntersection = rids.size();
+
+    RangeScanExecutor scan(disk);
+    size_t added = scan.execute(rids, predicate, results);
+    stats.blocksRead = scan.getStats().distinctBlocks;
+    stats.recordsMatched = added;
+    return added;
+}
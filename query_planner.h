@@ -0,0 +1,62 @@
+// query_planner.h
+#ifndef QUERY_PLANNER_H
+#define QUERY_PLANNER_H
+
+#include <vector>
+#include "secondary_index.h"
+#include "range_scan.h"
+
+// Cost model, in units of one block read by a sequential full scan
+const double PLANNER_INDEX_ENTRIES_PER_BLOCK = 1024.0;  // RecordIds pulled from an in-memory index per block-read of cost
+const double PLANNER_RANDOM_BLOCK_COST = 2.0;           // A data block fetched by RecordId instead of by the scan
+
+// How a conjunctive query will be answered
+struct QueryPlan {
+    std::vector<ColumnRange> indexRanges;  // Looked up and intersected, most selective first
+    std::vector<ColumnRange> residual;     // Checked on each fetched record
+    bool fullScan;                         // No index pays off: read every data block
+    double estimatedRows;
+    double estimatedCost;                  // Block reads
+    double fullScanCost;
+
+    QueryPlan() : fullScan(true), estimatedRows(0), estimatedCost(0), fullScanCost(0) {}
+    void print() const;
+};
+
+// Work done by one QueryPlanner::execute call
+struct QueryStats {
+    size_t ridsFetched;              // RecordIds read from the indexes
+    size_t ridsAfterIntersection;
+    size_t blocksRead;               // Data blocks read
+    size_t recordsMatched;
+
+    QueryStats() : ridsFetched(0), ridsAfterIntersection(0), blocksRead(0), recordsMatched(0) {}
+    void print() const;
+};
+
+// Answers conjunctions of column ranges over the records covered by a
+// SecondaryIndexes. Each indexed predicate's exact match count comes from
+// its index; assuming independent columns, the planner adds indexes in order
+// of selectivity for as long as the RecordIds they cost are repaid by fewer
+// data block reads, and falls back to a full scan when that is cheaper.
+// Predicates without a chosen index are checked on the fetched records.
+class QueryPlanner {
+private:
+    SecondaryIndexes& indexes;
+    QueryStats stats;
+
+    // Expected data block reads to fetch rows records spread over the data file
+    double fetchCost(double rows) const;
+
+public:
+    QueryPlanner(SecondaryIndexes& indexes);
+
+    QueryPlan plan(const std::vector<ColumnRange>& predicates) const;
+
+    // Append every matching record to results and return how many were added
+    size_t execute(const QueryPlan& plan, std::vector<Record>& results);
+
+    const QueryStats& getStats() const { return stats; }
+};
+
+#endif // QUERY_PLANNER_H
@@ -1,50 +1,71 @@
-#include "bptree.h"
+#include "disk_bptree.h"
 #include "disk.h"
+#include "mapped_disk.h"
+#include "buffer_pool.h"
+#include "range_scan.h"
 #include "record_block.h"
 #include <iostream>
 #include <vector>
 #include <string>
 #include <cstring>
+#include <memory>
 
-int main() {
-    // Initialize the Disk
-    Disk disk("test_disk.db");
+int main(int argc, char* argv[]) {
+    // Initialize the Disk; pass --mmap to read the data file through the memory-mapped backend
+    bool useMmap = argc > 1 && std::string(argv[1]) == "--mmap";
+    std::unique_ptr<Disk> dataDisk(useMmap ? static_cast<Disk*>(new MappedDisk("test_disk.db"))
+                                           : new Disk("test_disk.db"));
+    Disk& disk = *dataDisk;
 
-    // Create and deserialize the B+ Tree
-    BPTree newBPTree;
-    newBPTree.deserialize("bptree_structure.dat");
+    // Open the page-resident B+ Tree: only the pages a query visits are read
+    Disk indexDisk("bptree_index.db");
+    BufferPool indexPool(indexDisk);
+    DiskBPTree diskIndex(indexPool);
+    if (!diskIndex.open()) {
+        return 1;
+    }
+    // Read the next leaf while the range scan walks the current one
+    indexPool.EnableReadAhead();
 
     // Perform a range query from 0.5 to 0.8 inclusively
     float startKey = 0.6f;
     float endKey = 0.8f;
 
-    std::vector<uint32_t> recordPointers = newBPTree.rangeQuery(startKey, endKey, disk);
+    // Measure only the query itself, not the header page open() read
+    diskIndex.resetStats();
+    indexPool.ResetCounters();
+    indexDisk.ResetStats();
+    disk.ResetStats();
+
+    // The index holds the id of every matching record, so no re-filtering is needed
+    std::vector<RecordId> rids = diskIndex.rangeQuery(startKey, endKey);
 
     std::cout << "Records with FG_PCT_home in range [" << startKey << ", " << endKey << "]:" << std::endl;
 
-    // Read and print the records from disk
-    for (uint32_t recordPointer : recordPointers) {
-        uint32_t blockNum = recordPointer; // Assuming recordPointer is the block number
-
-        uint8_t readBuffer[BLOCK_SIZE];
-        std::memset(readBuffer, 0, BLOCK_SIZE);
-
-        if (disk.ReadBlock(blockNum, readBuffer)) {
-            Block block;
-            block.deserialize(readBuffer);
-
-            // Iterate through records in the block
-            for (uint32_t i = 0; i < block.numRecords; ++i) {
-                float fgPct = std::stof(block.records[i].fg_pct_home);
-                if (fgPct >= startKey && fgPct <= endKey) {
-                    block.records[i].print();
-                }
-            }
-        } else {
-            std::cerr << "Error reading block " << blockNum << " from disk." << std::endl;
-        }
+    // Read each distinct data block once, in disk order, touching only the listed slots
+    RangeScanExecutor scan(disk);
+    std::vector<Record> records;
+    scan.execute(rids, RangeScanExecutor::Predicate(), records);
+    for (const Record& record : records) {
+        record.print();
+    }
+    std::cout << "Number of records found: " << records.size() << std::endl;
+
+    scan.getStats().print();
+    std::cout << "Index pages read: " << indexPool.GetMisses() + indexPool.GetReadAheads() << " ("
+              << indexPool.GetReadAheads() << " read ahead)" << std::endl;
+
+    // Full counters as one JSON line when built with -DENABLE_STATS
+    if (STATS_ENABLED) {
+        std::cout << "{\"index\":";
+        diskIndex.getStats().writeJson(std::cout);
+        std::cout << ",\"index_io\":";
+        indexDisk.GetStats().writeJson(std::cout);
+        std::cout << ",\"data_io\":";
+        disk.GetStats().writeJson(std::cout);
+        std::cout << "}" << std::endl;
     }
 
     return 0;
 }
-// Compile with g++ -std=c++11 range_query_test.cc disk.cc bptree.cc record_block.cc -o range_query_test
+// Compile with g++ -std=c++11 -pthread range_query_test.cc disk.cc mapped_disk.cc async_io.cc buffer_pool.cc range_scan.cc disk_bptree.cc record_block.cc -o range_query_test
@@ -0,0 +1,176 @@
+// range_scan.cc
+#include "range_scan.h"
+#include <algorithm>
+#include <iostream>
+
+void RangeScanStats::print() const {
+    std::cout << "Range scan statistics:\n";
+    std::cout << "Record ids: " << recordIds << "\n";
+    std::cout << "Distinct data blocks read: " << distinctBlocks << "\n";
+    std::cout << "Sequential read runs: " << readRuns << "\n";
+    std::cout << "Records matched: " << recordsMatched << "\n";
+}
+
+// Constructor
+RangeScanExecutor::RangeScanExecutor(Disk& disk, uint32_t maxRunBlocks, uint32_t queueDepth)
+    : disk(disk),
+      maxRunBlocks(maxRunBlocks == 0 ? 1 : maxRunBlocks),
+      queueDepth(queueDepth == 0 ? 1 : queueDepth),
+      runBuffer(static_cast<size_t>(maxRunBlocks == 0 ? 1 : maxRunBlocks) * BLOCK_SIZE) {}
+
+// Visit each block of the run once, touching only the listed slots;
+// a record is only materialized after it passed the predicate
+size_t RangeScanExecutor::scanRun(const uint8_t* runData, const Run& run, const std::vector<RecordId>& sorted,
+                                  const Predicate& predicate, std::vector<Record>& results,
+                                  std::vector<RecordId>* matchedIds) {
+    size_t added = 0;
+    for (size_t i = run.begin; i < run.end; ++i) {
+        BlockView block(runData + (recordIdBlock(sorted[i]) - run.firstBlock) * BLOCK_SIZE);
+        uint32_t slot = recordIdSlot(sorted[i]);
+        if (slot >= block.numRecords()) {
+            std::cerr << "Error: Slot " << slot << " is out of range (block holds "
+                      << block.numRecords() << " records).\n";
+            continue;
+        }
+        if (block.isDeleted(slot)) {
+            // The index still pointed at a record that has been deleted
+            continue;
+        }
+        RecordView record = block.record(slot);
+        if (!predicate || predicate(record)) {
+            results.push_back(record.toRecord());
+            if (matchedIds) {
+                matchedIds->push_back(sorted[i]);
+            }
+            added++;
+        }
+    }
+    return added;
+}
+
+// The reader stopped reporting completions, so reads it still has in flight
+// may land in the run buffers at any time. Drop it, keep those buffers out of
+// use for the life of the executor and read synchronously from now on.
+void RangeScanExecutor::abandonReadAhead() {
+    std::cerr << "Error: Read-ahead failed; reading the remaining blocks synchronously." << std::endl;
+    reader.reset();
+    queueDepth = 1;
+    retiredBuffer.swap(runBuffer);
+    runBuffer.assign(static_cast<size_t>(maxRunBlocks) * BLOCK_SIZE, 0);
+}
+
+size_t RangeScanExecutor::execute(const std::vector<RecordId>& rids, const Predicate& predicate,
+                                  std::vector<Record>& results, std::vector<RecordId>* matchedIds) {
+    stats = RangeScanStats();
+    stats.recordIds = rids.size();
+
+    // Sorting RecordIds orders them by block, then by slot
+    std::vector<RecordId> sorted(rids);
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+    // Tell the backend whether the blocks we are about to touch are dense or sparse
+    if (!sorted.empty()) {
+        size_t distinct = 1;
+        for (size_t j = 1; j < sorted.size(); ++j) {
+            if (recordIdBlock(sorted[j]) != recordIdBlock(sorted[j - 1])) distinct++;
+        }
+        size_t span = recordIdBlock(sorted.back()) - recordIdBlock(sorted.front()) + 1;
+        disk.AdviseAccess(distinct * 2 >= span ? Disk::ACCESS_SEQUENTIAL : Disk::ACCESS_RANDOM);
+    }
+
+    // Group the ids into runs of adjacent blocks that all hold at least one id
+    std::vector<Run> runs;
+    size_t i = 0;
+    while (i < sorted.size()) {
+        Run run;
+        run.firstBlock = recordIdBlock(sorted[i]);
+        run.length = 1;
+        run.begin = i;
+        while (i < sorted.size()) {
+            uint32_t block = recordIdBlock(sorted[i]);
+            if (block == run.firstBlock + run.length - 1) {
+                i++;
+            } else if (block == run.firstBlock + run.length && run.length < maxRunBlocks) {
+                run.length++;
+                i++;
+            } else {
+                break;
+            }
+        }
+        run.end = i;
+        runs.push_back(run);
+        stats.distinctBlocks += run.length;
+    }
+    stats.readRuns = runs.size();
+
+    // Read ahead only when the backend has to copy blocks out and there is more than one run
+    size_t added = 0;
+    bool readAhead = queueDepth > 1 && runs.size() > 1 && !disk.GetBlockView(runs.front().firstBlock);
+    if (readAhead && !reader) {
+        reader = AsyncBlockReader::Create(disk, queueDepth);
+        if (!reader) {
+            queueDepth = 1;
+            readAhead = false;
+        }
+    }
+
+    size_t next = 0;   // First run not scanned yet
+    if (readAhead) {
+        size_t runBytes = static_cast<size_t>(maxRunBlocks) * BLOCK_SIZE;
+        runBuffer.resize(runBytes * queueDepth);
+        std::vector<char> ready(runs.size(), 0);   // 0 pending, 1 read, 2 failed
+        size_t submitted = 0;
+        for (; next < runs.size(); ++next) {
+            size_t r = next;
+            // Keep the queue full; run s reuses the buffer of run s - queueDepth, which is done
+            while (submitted < runs.size() && submitted < r + queueDepth) {
+                uint8_t* buffer = &runBuffer[(submitted % queueDepth) * runBytes];
+                if (!reader->Submit(runs[submitted].firstBlock, runs[submitted].length, buffer, submitted)) {
+                    ready[submitted] = 2;
+                }
+                submitted++;
+            }
+            bool waitFailed = false;
+            while (ready[r] == 0) {
+                uint64_t tag;
+                bool ok;
+                if (!reader->WaitCompletion(tag, ok)) {
+                    waitFailed = true;
+                    break;
+                }
+                ready[tag] = ok ? 1 : 2;
+            }
+            if (waitFailed) {
+                // Run r and the ones after it are read below
+                abandonReadAhead();
+                break;
+            }
+            if (ready[r] != 1) {
+                std::cerr << "Error reading blocks " << runs[r].firstBlock << " to "
+                          << runs[r].firstBlock + runs[r].length - 1 << " from disk." << std::endl;
+                continue;
+            }
+            added += scanRun(&runBuffer[(r % queueDepth) * runBytes], runs[r], sorted, predicate, results, matchedIds);
+        }
+    }
+
+    // Every run when not reading ahead, or those left when read-ahead was given up
+    for (; next < runs.size(); ++next) {
+        const Run& run = runs[next];
+        // Use the backend's memory directly when it has a view, otherwise read the run
+        const uint8_t* runData = disk.GetBlockView(run.firstBlock);
+        if (!runData) {
+            if (!disk.ReadBlocks(run.firstBlock, run.length, runBuffer.data())) {
+                std::cerr << "Error reading blocks " << run.firstBlock << " to " << run.firstBlock + run.length - 1
+                          << " from disk." << std::endl;
+                continue;
+            }
+            runData = runBuffer.data();
+        }
+        added += scanRun(runData, run, sorted, predicate, results, matchedIds);
+    }
+
+    stats.recordsMatched = added;
+    return added;
+}
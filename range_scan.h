@@ -0,0 +1,77 @@
+// range_scan.h
+#ifndef RANGE_SCAN_H
+#define RANGE_SCAN_H
+
+#include <vector>
+#include <functional>
+#include <memory>
+#include "disk.h"
+#include "async_io.h"
+#include "record_block.h"
+
+const uint32_t DEFAULT_SCAN_RUN_BLOCKS = 32;   // Longest run fetched with one read (128KB)
+
+// I/O done by one RangeScanExecutor::execute call
+struct RangeScanStats {
+    size_t recordIds;       // Ids handed in, duplicates included
+    size_t distinctBlocks;  // Data blocks that hold at least one of them
+    size_t readRuns;        // Sequential reads issued
+    size_t recordsMatched;  // Records that passed the predicate
+
+    RangeScanStats() : recordIds(0), distinctBlocks(0), readRuns(0), recordsMatched(0) {}
+    void print() const;
+};
+
+// Turns the RecordIds returned by an index range query into records at about
+// one read per distinct block: ids are sorted and deduplicated, blocks that
+// are adjacent on disk are fetched together with Disk::ReadBlocks, and each
+// block is visited once, evaluating the predicate only on the listed slots.
+//
+// The whole list of runs is known before the first read, so with a queue
+// depth above one the reads are issued through an AsyncBlockReader up to
+// queueDepth runs ahead of the run being filtered; each run has its own
+// buffer until it has been consumed. If the reader stops reporting
+// completions the executor gives up reading ahead, without reusing a buffer a
+// read may still land in, and reads the remaining runs synchronously.
+class RangeScanExecutor {
+private:
+    // Adjacent blocks fetched with one read, and the sorted ids [begin, end) that fall in them
+    struct Run {
+        uint32_t firstBlock;
+        uint32_t length;
+        size_t begin;
+        size_t end;
+    };
+
+    Disk& disk;
+    uint32_t maxRunBlocks;
+    uint32_t queueDepth;
+    std::vector<uint8_t> runBuffer;               // queueDepth run buffers when reading ahead
+    std::vector<uint8_t> retiredBuffer;           // Run buffers of a reader given up on, never reused
+    std::unique_ptr<AsyncBlockReader> reader;     // Created by the first execute that reads ahead
+    RangeScanStats stats;
+
+public:
+    // Records for which the predicate returns false are dropped; an empty
+    // predicate keeps every record the ids point to. The predicate sees the
+    // serialized record, so it only reads the columns it filters on.
+    typedef std::function<bool(const RecordView&)> Predicate;
+
+    // queueDepth 1 reads every run synchronously when it is needed
+    RangeScanExecutor(Disk& disk, uint32_t maxRunBlocks = DEFAULT_SCAN_RUN_BLOCKS,
+                      uint32_t queueDepth = DEFAULT_IO_QUEUE_DEPTH);
+
+    // Append the matching records to results in block order and return how
+    // many were added; matchedIds, when given, gets the RecordId of each one
+    size_t execute(const std::vector<RecordId>& rids, const Predicate& predicate, std::vector<Record>& results,
+                   std::vector<RecordId>* matchedIds = nullptr);
+
+    const RangeScanStats& getStats() const { return stats; }
+
+private:
+    void abandonReadAhead();
+    size_t scanRun(const uint8_t* runData, const Run& run, const std::vector<RecordId>& sorted,
+                   const Predicate& predicate, std::vector<Record>& results, std::vector<RecordId>* matchedIds);
+};
+
+#endif // RANGE_SCAN_H
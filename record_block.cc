@@ -1,12 +1,14 @@
 // record_block.cc
 
 #include "record_block.h"
+#include <algorithm>
+#include <cstdio>
 #include <iostream>
 
 // Function to print block statistics
-void printBlockStatistics(size_t totalRecords) {
-    size_t recordSize = sizeof(Record);
-    size_t recordsPerBlock = RECORDS_PER_BLOCK;
+void printBlockStatistics(size_t totalRecords, BlockFormat format) {
+    size_t recordSize = isCompactFormat(format) ? COMPACT_RECORD_SIZE : RECORD_SIZE_WITH_PADDING;
+    size_t recordsPerBlock = ::recordsPerBlock(format);
     size_t totalBlocks = (totalRecords + recordsPerBlock - 1) / recordsPerBlock; // Calculate the number of blocks required
 
     std::cout << "Statistics:\n";
@@ -16,145 +18,224 @@ void printBlockStatistics(size_t totalRecords) {
     std::cout << "Number of blocks for storing the data: " << totalBlocks << "\n";
 }
 
-// Serialize the Record into a byte buffer
-void Record::serialize(uint8_t* buffer) const {
-    size_t offset = 0;
-
-    // Serialize game_date_est
-    std::memcpy(buffer + offset, game_date_est, GAME_DATE_EST_SIZE);
-    offset += GAME_DATE_EST_SIZE;
-
-    // Serialize team_id_home
-    std::memcpy(buffer + offset, &team_id_home, sizeof(team_id_home));
-    offset += sizeof(team_id_home);
-
-    // Serialize pts_home
-    std::memcpy(buffer + offset, &pts_home, sizeof(pts_home));
-    offset += sizeof(pts_home);
-
-    // Serialize fg_pct_home
-    std::memcpy(buffer + offset, fg_pct_home, FG_PCT_HOME_SIZE);
-    offset += FG_PCT_HOME_SIZE;
-
-    // Serialize ft_pct_home
-    std::memcpy(buffer + offset, ft_pct_home, FT_PCT_HOME_SIZE);
-    offset += FT_PCT_HOME_SIZE;
-
-    // Serialize fg3_pct_home
-    std::memcpy(buffer + offset, fg3_pct_home, FG3_PCT_HOME_SIZE);
-    offset += FG3_PCT_HOME_SIZE;
-
-    // Serialize ast_home
-    std::memcpy(buffer + offset, &ast_home, sizeof(ast_home));
-    offset += sizeof(ast_home);
-
-    // Serialize reb_home
-    std::memcpy(buffer + offset, &reb_home, sizeof(reb_home));
-    offset += sizeof(reb_home);
+size_t formatPercent(uint16_t thousandths, char* text, size_t size) {
+    char digits[8];
+    size_t length = 0;
+    if (thousandths != PCT_MISSING) {
+        uint32_t whole = thousandths / 1000, fraction = thousandths % 1000;
+        if (whole >= 10) {
+            digits[length++] = static_cast<char>('0' + whole / 10);
+        }
+        digits[length++] = static_cast<char>('0' + whole % 10);
+        if (fraction != 0) {
+            // Up to three decimals, without trailing zeros
+            digits[length++] = '.';
+            for (uint32_t scale = 100; fraction != 0; scale /= 10) {
+                digits[length++] = static_cast<char>('0' + fraction / scale);
+                fraction %= scale;
+            }
+        }
+    }
+    if (size == 0) {
+        return 0;
+    }
+    length = std::min(length, size - 1);
+    std::memcpy(text, digits, length);
+    text[length] = '\0';
+    return length;
+}
 
-    // Serialize home_team_wins
-    std::memcpy(buffer + offset, &home_team_wins, sizeof(home_team_wins));
-    offset += sizeof(home_team_wins);
+size_t formatGameDate(uint32_t day, char* text, size_t size) {
+    if (size == 0) {
+        return 0;
+    }
+    if (day == 0) {
+        text[0] = '\0';
+        return 0;
+    }
+    // Inverse of the day count in parseGameDate
+    uint32_t z = day + 719468;
+    uint32_t era = z / 146097;
+    uint32_t dayOfEra = z - era * 146097;
+    uint32_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    uint32_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    uint32_t shiftedMonth = (5 * dayOfYear + 2) / 153;
+    uint32_t dayOfMonth = dayOfYear - (153 * shiftedMonth + 2) / 5 + 1;
+    uint32_t month = shiftedMonth < 10 ? shiftedMonth + 3 : shiftedMonth - 9;
+    uint32_t year = yearOfEra + era * 400 + (month <= 2);
+    int length = std::snprintf(text, size, "%u/%u/%u", dayOfMonth, month, year);
+    return length < 0 ? 0 : std::min(static_cast<size_t>(length), size - 1);
 }
 
-// Deserialize the Record from a byte buffer
-void Record::deserialize(const uint8_t* buffer) {
-    size_t offset = 0;
+static void writeUint16(uint8_t* buffer, uint16_t value) { std::memcpy(buffer, &value, sizeof(value)); }
+static uint16_t readUint16(const uint8_t* buffer) {
+    uint16_t value;
+    std::memcpy(&value, buffer, sizeof(value));
+    return value;
+}
 
-    // Deserialize game_date_est
-    std::memcpy(game_date_est, buffer + offset, GAME_DATE_EST_SIZE);
-    game_date_est[GAME_DATE_EST_SIZE - 1] = '\0'; // Ensure null-termination
-    offset += GAME_DATE_EST_SIZE;
+// Deserialize the Record from a row record of an older data file
+void Record::deserializeRow(const uint8_t* buffer) {
+    // Deserialize game_date_day from the date text
+    game_date_day = parseGameDate(reinterpret_cast<const char*>(buffer + GAME_DATE_EST_OFFSET), GAME_DATE_EST_SIZE - 1);
 
     // Deserialize team_id_home
-    std::memcpy(&team_id_home, buffer + offset, sizeof(team_id_home));
-    offset += sizeof(team_id_home);
+    std::memcpy(&team_id_home, buffer + TEAM_ID_HOME_OFFSET, sizeof(team_id_home));
 
     // Deserialize pts_home
-    std::memcpy(&pts_home, buffer + offset, sizeof(pts_home));
-    offset += sizeof(pts_home);
-
-    // Deserialize fg_pct_home
-    std::memcpy(fg_pct_home, buffer + offset, FG_PCT_HOME_SIZE);
-    fg_pct_home[FG_PCT_HOME_SIZE - 1] = '\0'; // Ensure null-termination
-    offset += FG_PCT_HOME_SIZE;
+    std::memcpy(&pts_home, buffer + PTS_HOME_OFFSET, sizeof(pts_home));
 
-    // Deserialize ft_pct_home
-    std::memcpy(ft_pct_home, buffer + offset, FT_PCT_HOME_SIZE);
-    ft_pct_home[FT_PCT_HOME_SIZE - 1] = '\0'; // Ensure null-termination
-    offset += FT_PCT_HOME_SIZE;
-
-    // Deserialize fg3_pct_home
-    std::memcpy(fg3_pct_home, buffer + offset, FG3_PCT_HOME_SIZE);
-    fg3_pct_home[FG3_PCT_HOME_SIZE - 1] = '\0'; // Ensure null-termination
-    offset += FG3_PCT_HOME_SIZE;
+    // Deserialize the percentages from their text
+    fg_pct_home = parsePercentThousandths(reinterpret_cast<const char*>(buffer + FG_PCT_HOME_OFFSET), FG_PCT_HOME_SIZE - 1);
+    ft_pct_home = parsePercentThousandths(reinterpret_cast<const char*>(buffer + FT_PCT_HOME_OFFSET), FT_PCT_HOME_SIZE - 1);
+    fg3_pct_home =
+        parsePercentThousandths(reinterpret_cast<const char*>(buffer + FG3_PCT_HOME_OFFSET), FG3_PCT_HOME_SIZE - 1);
 
     // Deserialize ast_home
-    std::memcpy(&ast_home, buffer + offset, sizeof(ast_home));
-    offset += sizeof(ast_home);
+    std::memcpy(&ast_home, buffer + AST_HOME_OFFSET, sizeof(ast_home));
 
     // Deserialize reb_home
-    std::memcpy(&reb_home, buffer + offset, sizeof(reb_home));
-    offset += sizeof(reb_home);
+    std::memcpy(&reb_home, buffer + REB_HOME_OFFSET, sizeof(reb_home));
 
     // Deserialize home_team_wins
-    std::memcpy(&home_team_wins, buffer + offset, sizeof(home_team_wins));
-    offset += sizeof(home_team_wins);
+    home_team_wins = buffer[HOME_TEAM_WINS_OFFSET] != 0;
+}
+
+// Serialize the Record into the compact layout
+bool Record::serialize(uint8_t* buffer, uint8_t teamCode) const {
+    if (game_date_day > UINT16_MAX || pts_home > UINT16_MAX) {
+        return false;
+    }
+    writeUint16(buffer + COMPACT_DATE_OFFSET, static_cast<uint16_t>(game_date_day));
+    writeUint16(buffer + COMPACT_PTS_OFFSET, static_cast<uint16_t>(pts_home));
+    writeUint16(buffer + COMPACT_FG_PCT_OFFSET, fg_pct_home);
+    writeUint16(buffer + COMPACT_FT_PCT_OFFSET, ft_pct_home);
+    writeUint16(buffer + COMPACT_FG3_PCT_OFFSET, fg3_pct_home);
+    writeUint16(buffer + COMPACT_AST_OFFSET, ast_home);
+    writeUint16(buffer + COMPACT_REB_OFFSET, reb_home);
+    buffer[COMPACT_TEAM_OFFSET] = teamCode;
+    buffer[COMPACT_WINS_OFFSET] = home_team_wins ? 1 : 0;
+    return true;
+}
+
+// Deserialize the Record from the compact layout
+void Record::deserialize(const uint8_t* buffer, uint32_t teamId) {
+    game_date_day = readUint16(buffer + COMPACT_DATE_OFFSET);
+    team_id_home = teamId;
+    pts_home = readUint16(buffer + COMPACT_PTS_OFFSET);
+    fg_pct_home = readUint16(buffer + COMPACT_FG_PCT_OFFSET);
+    ft_pct_home = readUint16(buffer + COMPACT_FT_PCT_OFFSET);
+    fg3_pct_home = readUint16(buffer + COMPACT_FG3_PCT_OFFSET);
+    ast_home = readUint16(buffer + COMPACT_AST_OFFSET);
+    reb_home = readUint16(buffer + COMPACT_REB_OFFSET);
+    home_team_wins = buffer[COMPACT_WINS_OFFSET] != 0;
 }
 
 // Function to print a Record (useful for debugging)
 void Record::print() const {
-    std::cout << "GAME_DATE_EST: " << game_date_est << ", "
+    char date[GAME_DATE_EST_SIZE], fgPct[8], ftPct[8], fg3Pct[8];
+    formatGameDate(game_date_day, date, sizeof(date));
+    formatPercent(fg_pct_home, fgPct, sizeof(fgPct));
+    formatPercent(ft_pct_home, ftPct, sizeof(ftPct));
+    formatPercent(fg3_pct_home, fg3Pct, sizeof(fg3Pct));
+    std::cout << "GAME_DATE_EST: " << date << ", "
               << "TEAM_ID_home: " << team_id_home << ", "
               << "PTS_home: " << pts_home << ", "
-              << "FG_PCT_home: " << fg_pct_home << ", "
-              << "FT_PCT_home: " << ft_pct_home << ", "
-              << "FG3_PCT_home: " << fg3_pct_home << ", "
+              << "FG_PCT_home: " << fgPct << ", "
+              << "FT_PCT_home: " << ftPct << ", "
+              << "FG3_PCT_home: " << fg3Pct << ", "
               << "AST_home: " << ast_home << ", "
               << "REB_home: " << reb_home << ", "
               << "HOME_TEAM_WINS: " << (home_team_wins ? "True" : "False") << std::endl;
 }
 
 // Serialize the Block into a byte buffer
-void Block::serialize(uint8_t* buffer) const {
-    size_t offset = 0;
-
-    // Serialize numRecords
-    std::memcpy(buffer + offset, &numRecords, sizeof(numRecords));
-    offset += sizeof(numRecords);
-
-    // Serialize each Record
-    for (uint32_t i = 0; i < numRecords; ++i) {
-        records[i].serialize(buffer + offset);
-        offset += RECORD_SIZE_WITH_PADDING; // Move offset by padded record size
+bool Block::serialize(uint8_t* buffer, BlockFormat format) const {
+    std::memset(buffer, 0, BLOCK_SIZE);
+    if (numRecords > recordsPerBlock(format)) {
+        return false;
     }
+    writeBlockHeader(buffer, numRecords, format);
 
-    // Fill the remaining buffer with zeros if necessary
-    if (offset < BLOCK_SIZE) {
-        std::memset(buffer + offset, 0, BLOCK_SIZE - offset);
+    // Serialize each Record into its slot
+    for (uint32_t i = 0; i < numRecords; ++i) {
+        if (!storeRecord(buffer, format, i, records[i])) {
+            return false;
+        }
     }
+    return true;
 }
 
 // Deserialize the Block from a byte buffer
 void Block::deserialize(const uint8_t* buffer) {
-    size_t offset = 0;
-
-    // Deserialize numRecords
-    std::memcpy(&numRecords, buffer + offset, sizeof(numRecords));
-    offset += sizeof(numRecords);
+    BlockView view(buffer);
+    numRecords = blockRecordCount(buffer);
 
     // Safety check to prevent reading more records than possible
-    if (numRecords > RECORDS_PER_BLOCK) {
-        std::cerr << "Error: numRecords (" << numRecords << ") exceeds RECORDS_PER_BLOCK (" 
-                  << RECORDS_PER_BLOCK << "). Truncating to RECORDS_PER_BLOCK.\n";
-        numRecords = RECORDS_PER_BLOCK;
+    size_t capacity = recordsPerBlock(view.format());
+    if (numRecords > capacity) {
+        std::cerr << "Error: numRecords (" << numRecords << ") exceeds the " << capacity
+                  << " records a block of its format holds. Truncating.\n";
+        numRecords = static_cast<uint32_t>(capacity);
     }
 
     // Deserialize each Record
     for (uint32_t i = 0; i < numRecords; ++i) {
-        records[i].deserialize(buffer + offset);
-        offset += RECORD_SIZE_WITH_PADDING; // Move offset by padded record size
+        records[i] = view.record(i).toRecord();
+    }
+}
+
+// Deserialize a single record without touching the rest of the block
+bool Block::deserializeRecord(const uint8_t* buffer, uint32_t slot, Record& record) {
+    uint32_t count = blockRecordCount(buffer);
+    if (slot >= count || slot >= recordsPerBlock(blockFormat(buffer))) {
+        std::cerr << "Error: Slot " << slot << " is out of range (block holds " << count << " records).\n";
+        return false;
+    }
+    if (isSlotDeleted(buffer, slot)) {
+        std::cerr << "Error: Slot " << slot << " holds a deleted record.\n";
+        return false;
+    }
+    record = BlockView(buffer).record(slot).toRecord();
+    return true;
+}
+
+// Code the record's team through the block's dictionary, then copy the
+// compact record into its slot (compact) or scatter its fields over the
+// minipages (PAX). Row and text PAX blocks are only read.
+bool storeRecord(uint8_t* blockData, BlockFormat format, uint32_t slot, const Record& record) {
+    if (!isCompactFormat(format)) {
+        return false;
+    }
+    uint32_t numTeams;
+    std::memcpy(&numTeams, blockData + COMPACT_TEAM_COUNT_OFFSET, sizeof(numTeams));
+    uint8_t* teams = blockData + COMPACT_TEAMS_OFFSET;
+    uint32_t code = 0;
+    for (; code < numTeams; ++code) {
+        uint32_t teamId;
+        std::memcpy(&teamId, teams + code * sizeof(uint32_t), sizeof(teamId));
+        if (teamId == record.team_id_home) {
+            break;
+        }
+    }
+    uint8_t packed[COMPACT_RECORD_SIZE];
+    if (code == COMPACT_MAX_TEAMS || !record.serialize(packed, static_cast<uint8_t>(code))) {
+        return false;
+    }
+    if (code == numTeams) {
+        std::memcpy(teams + code * sizeof(uint32_t), &record.team_id_home, sizeof(uint32_t));
+        numTeams++;
+        std::memcpy(blockData + COMPACT_TEAM_COUNT_OFFSET, &numTeams, sizeof(numTeams));
+    }
+    if (format == BLOCK_FORMAT_COMPACT) {
+        std::memcpy(blockData + COMPACT_RECORDS_OFFSET + slot * COMPACT_RECORD_SIZE, packed, COMPACT_RECORD_SIZE);
+        return true;
+    }
+    for (int column = 0; column < NUM_COLUMNS; ++column) {
+        std::memcpy(blockData + PAX_FIELD_OFFSETS[column] + slot * COMPACT_FIELD_SIZES[column],
+                    packed + COMPACT_FIELD_OFFSETS[column], COMPACT_FIELD_SIZES[column]);
     }
+    return true;
 }
 
 // Function to print all Records in the Block (useful for debugging)
@@ -6,6 +6,7 @@
 #include <cstring>
 #include <iostream>
 #include <iomanip>
+#include <string>
 
 // Constants based on script output
 const size_t GAME_DATE_EST_SIZE = 11;    // 10 bytes + 1 for null-termination
@@ -23,23 +24,221 @@ const size_t RECORD_SIZE_WITH_PADDING = 51;
 const size_t BLOCK_SIZE = 4096;          // Standard block size (can be adjusted as needed)
 const size_t RECORDS_PER_BLOCK = BLOCK_SIZE / RECORD_SIZE_WITH_PADDING; // Adjusted based on padded record size
 
-// Record Structure
+// Byte offsets of each field inside a row record (see Record::deserializeRow)
+const size_t GAME_DATE_EST_OFFSET = 0;
+const size_t TEAM_ID_HOME_OFFSET = GAME_DATE_EST_OFFSET + GAME_DATE_EST_SIZE;
+const size_t PTS_HOME_OFFSET = TEAM_ID_HOME_OFFSET + sizeof(uint32_t);
+const size_t FG_PCT_HOME_OFFSET = PTS_HOME_OFFSET + PTS_HOME_SIZE;
+const size_t FT_PCT_HOME_OFFSET = FG_PCT_HOME_OFFSET + FG_PCT_HOME_SIZE;
+const size_t FG3_PCT_HOME_OFFSET = FT_PCT_HOME_OFFSET + FT_PCT_HOME_SIZE;
+const size_t AST_HOME_OFFSET = FG3_PCT_HOME_OFFSET + FG3_PCT_HOME_SIZE;
+const size_t REB_HOME_OFFSET = AST_HOME_OFFSET + AST_HOME_SIZE;
+const size_t HOME_TEAM_WINS_OFFSET = REB_HOME_OFFSET + REB_HOME_SIZE;
+
+// Record columns that can be indexed, filtered on and scanned
+enum Column {
+    COLUMN_GAME_DATE_EST,     // As a day number (parseGameDate)
+    COLUMN_TEAM_ID_HOME,
+    COLUMN_PTS_HOME,
+    COLUMN_FG_PCT_HOME,
+    COLUMN_FT_PCT_HOME,
+    COLUMN_FG3_PCT_HOME,
+    COLUMN_AST_HOME,
+    COLUMN_REB_HOME,
+    COLUMN_HOME_TEAM_WINS,
+    NUM_COLUMNS
+};
+
+// Percentages are stored as text and read as floats, every other column as an unsigned integer
+inline bool isFloatColumn(Column column) {
+    return column == COLUMN_FG_PCT_HOME || column == COLUMN_FT_PCT_HOME || column == COLUMN_FG3_PCT_HOME;
+}
+
+// Serialized size and row-record offset of each column, indexed by Column
+const size_t FIELD_SIZES[NUM_COLUMNS] = {
+    GAME_DATE_EST_SIZE, sizeof(uint32_t), PTS_HOME_SIZE, FG_PCT_HOME_SIZE, FT_PCT_HOME_SIZE,
+    FG3_PCT_HOME_SIZE, AST_HOME_SIZE, REB_HOME_SIZE, HOME_TEAM_WINS_SIZE};
+const size_t ROW_FIELD_OFFSETS[NUM_COLUMNS] = {
+    GAME_DATE_EST_OFFSET, TEAM_ID_HOME_OFFSET, PTS_HOME_OFFSET, FG_PCT_HOME_OFFSET, FT_PCT_HOME_OFFSET,
+    FG3_PCT_HOME_OFFSET, AST_HOME_OFFSET, REB_HOME_OFFSET, HOME_TEAM_WINS_OFFSET};
+
+// Percentages are held as fixed-point thousandths (0.456 -> 456); a
+// percentage left empty in games.txt is PCT_MISSING
+const uint16_t PCT_MISSING = 0xFFFF;
+
+// Compact layout of a record (Record::serialize): binary fields only,
+// the date as a day number (parseGameDate), percentages in thousandths and the
+// team id as a one-byte code into the team dictionary of the record's block
+const size_t COMPACT_DATE_OFFSET = 0;       // uint16_t day number, 0 if missing
+const size_t COMPACT_PTS_OFFSET = 2;        // uint16_t
+const size_t COMPACT_FG_PCT_OFFSET = 4;     // uint16_t thousandths
+const size_t COMPACT_FT_PCT_OFFSET = 6;     // uint16_t thousandths
+const size_t COMPACT_FG3_PCT_OFFSET = 8;    // uint16_t thousandths
+const size_t COMPACT_AST_OFFSET = 10;       // uint16_t
+const size_t COMPACT_REB_OFFSET = 12;       // uint16_t
+const size_t COMPACT_TEAM_OFFSET = 14;      // uint8_t dictionary code
+const size_t COMPACT_WINS_OFFSET = 15;      // uint8_t
+const size_t COMPACT_RECORD_SIZE = 16;
+const size_t COMPACT_FIELD_OFFSETS[NUM_COLUMNS] = {
+    COMPACT_DATE_OFFSET, COMPACT_TEAM_OFFSET, COMPACT_PTS_OFFSET, COMPACT_FG_PCT_OFFSET, COMPACT_FT_PCT_OFFSET,
+    COMPACT_FG3_PCT_OFFSET, COMPACT_AST_OFFSET, COMPACT_REB_OFFSET, COMPACT_WINS_OFFSET};
+const size_t COMPACT_FIELD_SIZES[NUM_COLUMNS] = {2, 1, 2, 2, 2, 2, 2, 2, 1};
+
+// A serialized block starts with a header word: the record count in the low
+// 16 bits and the block format in the high 16 bits. Blocks written before
+// there was a choice of format have 0 there, i.e. row-wise.
+const size_t BLOCK_HEADER_SIZE = sizeof(uint32_t);
+const uint32_t BLOCK_COUNT_MASK = 0xFFFF;
+const uint32_t BLOCK_FORMAT_SHIFT = 16;
+
+// BLOCK_FORMAT_ROW stores the padded records one after the other.
+// BLOCK_FORMAT_TEXT_PAX stores the same text fields column by column. Both
+// have the same slots, RecordIds and tombstone bitmap. They are the text
+// layouts of data files written before the compact format and are only read
+// now: storeRecord writes neither.
+// BLOCK_FORMAT_COMPACT stores compact records (COMPACT_RECORD_SIZE bytes, no
+// text), about three times as many per block, behind a team dictionary.
+// BLOCK_FORMAT_PAX stores the fields of compact records column by column:
+// one minipage per column holding that binary field of every slot, so a scan
+// of one column reads one contiguous array of day numbers, thousandths or
+// team codes instead of a few bytes out of every record. It has the slots,
+// team dictionary and tombstone bitmap of a compact block.
+enum BlockFormat { BLOCK_FORMAT_ROW = 0, BLOCK_FORMAT_TEXT_PAX = 1, BLOCK_FORMAT_COMPACT = 2, BLOCK_FORMAT_PAX = 3 };
+
+// Formats whose records are compact: binary fields behind a team dictionary.
+// These are the formats new blocks can be written in.
+inline bool isCompactFormat(BlockFormat format) {
+    return format == BLOCK_FORMAT_COMPACT || format == BLOCK_FORMAT_PAX;
+}
+
+// Format new data files are written in
+const BlockFormat DEFAULT_BLOCK_FORMAT = BLOCK_FORMAT_COMPACT;
+
+// A compact block holds a team dictionary after the header (a count, then up
+// to COMPACT_MAX_TEAMS team ids), then the records, then their tombstone
+// bitmap. A record whose team is not in a full dictionary starts a new block.
+const size_t COMPACT_TEAM_COUNT_OFFSET = BLOCK_HEADER_SIZE;
+const size_t COMPACT_TEAMS_OFFSET = COMPACT_TEAM_COUNT_OFFSET + sizeof(uint32_t);
+const uint32_t COMPACT_MAX_TEAMS = 32;
+const size_t COMPACT_RECORDS_OFFSET = COMPACT_TEAMS_OFFSET + COMPACT_MAX_TEAMS * sizeof(uint32_t);
+const size_t COMPACT_RECORDS_PER_BLOCK = (BLOCK_SIZE - COMPACT_RECORDS_OFFSET) * 8 / (COMPACT_RECORD_SIZE * 8 + 1);
+const size_t COMPACT_TOMBSTONE_OFFSET = COMPACT_RECORDS_OFFSET + COMPACT_RECORDS_PER_BLOCK * COMPACT_RECORD_SIZE;
+
+// Start of each column's minipage in a PAX block, indexed by Column. The
+// minipages take the space of the compact records in the order of their
+// fields, so each one starts at COMPACT_RECORDS_PER_BLOCK times the field's
+// offset inside a compact record.
+const size_t PAX_FIELD_OFFSETS[NUM_COLUMNS] = {
+    COMPACT_RECORDS_OFFSET + COMPACT_RECORDS_PER_BLOCK * COMPACT_DATE_OFFSET,
+    COMPACT_RECORDS_OFFSET + COMPACT_RECORDS_PER_BLOCK * COMPACT_TEAM_OFFSET,
+    COMPACT_RECORDS_OFFSET + COMPACT_RECORDS_PER_BLOCK * COMPACT_PTS_OFFSET,
+    COMPACT_RECORDS_OFFSET + COMPACT_RECORDS_PER_BLOCK * COMPACT_FG_PCT_OFFSET,
+    COMPACT_RECORDS_OFFSET + COMPACT_RECORDS_PER_BLOCK * COMPACT_FT_PCT_OFFSET,
+    COMPACT_RECORDS_OFFSET + COMPACT_RECORDS_PER_BLOCK * COMPACT_FG3_PCT_OFFSET,
+    COMPACT_RECORDS_OFFSET + COMPACT_RECORDS_PER_BLOCK * COMPACT_AST_OFFSET,
+    COMPACT_RECORDS_OFFSET + COMPACT_RECORDS_PER_BLOCK * COMPACT_REB_OFFSET,
+    COMPACT_RECORDS_OFFSET + COMPACT_RECORDS_PER_BLOCK * COMPACT_WINS_OFFSET};
+
+// Slots in the roomiest format, for arrays indexed by slot
+const size_t MAX_RECORDS_PER_BLOCK = COMPACT_RECORDS_PER_BLOCK;
+static_assert(RECORDS_PER_BLOCK <= MAX_RECORDS_PER_BLOCK, "MAX_RECORDS_PER_BLOCK must cover every format");
+
+inline size_t recordsPerBlock(BlockFormat format) {
+    return isCompactFormat(format) ? COMPACT_RECORDS_PER_BLOCK : RECORDS_PER_BLOCK;
+}
+
+inline uint32_t blockRecordCount(const uint8_t* blockData) {
+    uint32_t header;
+    std::memcpy(&header, blockData, sizeof(header));
+    return header & BLOCK_COUNT_MASK;
+}
+inline BlockFormat blockFormat(const uint8_t* blockData) {
+    uint32_t header;
+    std::memcpy(&header, blockData, sizeof(header));
+    uint32_t format = header >> BLOCK_FORMAT_SHIFT;
+    return format <= BLOCK_FORMAT_PAX ? static_cast<BlockFormat>(format) : BLOCK_FORMAT_ROW;
+}
+inline void writeBlockHeader(uint8_t* blockData, uint32_t numRecords, BlockFormat format) {
+    uint32_t header = (static_cast<uint32_t>(format) << BLOCK_FORMAT_SHIFT) | (numRecords & BLOCK_COUNT_MASK);
+    std::memcpy(blockData, &header, sizeof(header));
+}
+
+// Start of each column's minipage in a text PAX block, indexed by Column. The
+// minipages keep the row order of the fields, so each one starts at
+// RECORDS_PER_BLOCK times the field's offset inside a row record.
+const size_t TEXT_PAX_FIELD_OFFSETS[NUM_COLUMNS] = {
+    BLOCK_HEADER_SIZE + RECORDS_PER_BLOCK * GAME_DATE_EST_OFFSET,
+    BLOCK_HEADER_SIZE + RECORDS_PER_BLOCK * TEAM_ID_HOME_OFFSET,
+    BLOCK_HEADER_SIZE + RECORDS_PER_BLOCK * PTS_HOME_OFFSET,
+    BLOCK_HEADER_SIZE + RECORDS_PER_BLOCK * FG_PCT_HOME_OFFSET,
+    BLOCK_HEADER_SIZE + RECORDS_PER_BLOCK * FT_PCT_HOME_OFFSET,
+    BLOCK_HEADER_SIZE + RECORDS_PER_BLOCK * FG3_PCT_HOME_OFFSET,
+    BLOCK_HEADER_SIZE + RECORDS_PER_BLOCK * AST_HOME_OFFSET,
+    BLOCK_HEADER_SIZE + RECORDS_PER_BLOCK * REB_HOME_OFFSET,
+    BLOCK_HEADER_SIZE + RECORDS_PER_BLOCK * HOME_TEAM_WINS_OFFSET};
+const size_t TEXT_PAX_DATA_END = BLOCK_HEADER_SIZE + RECORDS_PER_BLOCK * (HOME_TEAM_WINS_OFFSET + HOME_TEAM_WINS_SIZE);
+
+// Record identifier: block number in the upper 24 bits, slot in the block in the lower 8 bits
+typedef uint32_t RecordId;
+const uint32_t RECORD_ID_SLOT_BITS = 8;
+const uint32_t RECORD_ID_SLOT_MASK = (1u << RECORD_ID_SLOT_BITS) - 1;
+static_assert(MAX_RECORDS_PER_BLOCK <= (1u << RECORD_ID_SLOT_BITS), "Slot numbers must fit in a RecordId");
+
+inline RecordId makeRecordId(uint32_t blockNumber, uint32_t slot) {
+    return (blockNumber << RECORD_ID_SLOT_BITS) | (slot & RECORD_ID_SLOT_MASK);
+}
+inline uint32_t recordIdBlock(RecordId rid) { return rid >> RECORD_ID_SLOT_BITS; }
+inline uint32_t recordIdSlot(RecordId rid) { return rid & RECORD_ID_SLOT_MASK; }
+
+// Deleted records are tombstoned in a bitmap (one bit per slot) kept in the
+// spare bytes after the last record slot, so a delete never moves a record and
+// every other RecordId stays valid. Freshly written blocks are zero-filled
+// there, i.e. nothing is deleted; Block::deserialize does not carry the bits.
+// Row and text PAX blocks keep it at BLOCK_TOMBSTONE_OFFSET, compact and PAX
+// blocks at COMPACT_TOMBSTONE_OFFSET.
+const size_t BLOCK_TOMBSTONE_OFFSET = BLOCK_HEADER_SIZE + RECORDS_PER_BLOCK * RECORD_SIZE_WITH_PADDING;
+const size_t BLOCK_TOMBSTONE_SIZE = (RECORDS_PER_BLOCK + 7) / 8;
+static_assert(BLOCK_TOMBSTONE_OFFSET + BLOCK_TOMBSTONE_SIZE <= BLOCK_SIZE, "The tombstone bitmap must fit in a block");
+static_assert(TEXT_PAX_DATA_END <= BLOCK_TOMBSTONE_OFFSET, "Text PAX minipages must end before the tombstone bitmap");
+static_assert(COMPACT_RECORDS_OFFSET + COMPACT_RECORDS_PER_BLOCK * (COMPACT_WINS_OFFSET + 1) <= COMPACT_TOMBSTONE_OFFSET,
+              "PAX minipages must end before the tombstone bitmap");
+static_assert(COMPACT_TOMBSTONE_OFFSET + (COMPACT_RECORDS_PER_BLOCK + 7) / 8 <= BLOCK_SIZE,
+              "The compact tombstone bitmap must fit in a block");
+
+inline size_t blockTombstoneOffset(BlockFormat format) {
+    return isCompactFormat(format) ? COMPACT_TOMBSTONE_OFFSET : BLOCK_TOMBSTONE_OFFSET;
+}
+inline bool isSlotDeleted(const uint8_t* blockData, uint32_t slot) {
+    return (blockData[blockTombstoneOffset(blockFormat(blockData)) + slot / 8] >> (slot % 8)) & 1;
+}
+inline void markSlotDeleted(uint8_t* blockData, uint32_t slot) {
+    blockData[blockTombstoneOffset(blockFormat(blockData)) + slot / 8] |= static_cast<uint8_t>(1u << (slot % 8));
+}
+
+// Record Structure. Fields are held as numbers, and the compact layout keeps
+// them binary; the row layout of older data files holds the date and the
+// percentages as text.
 struct Record {
-    char game_date_est[GAME_DATE_EST_SIZE];    // "GAME_DATE_EST" - Max 10 characters
+    uint32_t game_date_day;                    // "GAME_DATE_EST" - Days since 1970-01-01 (parseGameDate), 0 if missing
     uint32_t team_id_home;                     // "TEAM_ID_home" - Numeric ID
     uint32_t pts_home;                         // "PTS_home" - Max 3 digits, stored as uint32_t
-    char fg_pct_home[FG_PCT_HOME_SIZE];        // "FG_PCT_home" - Max 5 characters (e.g., "0.456")
-    char ft_pct_home[FT_PCT_HOME_SIZE];        // "FT_PCT_home" - Max 5 characters
-    char fg3_pct_home[FG3_PCT_HOME_SIZE];      // "FG3_PCT_home" - Max 5 characters
+    uint16_t fg_pct_home;                      // "FG_PCT_home" - Thousandths (0.456 -> 456), PCT_MISSING if empty
+    uint16_t ft_pct_home;                      // "FT_PCT_home" - Thousandths
+    uint16_t fg3_pct_home;                     // "FG3_PCT_home" - Thousandths
     uint16_t ast_home;                         // "AST_home" - Max 2 digits
     uint16_t reb_home;                         // "REB_home" - Max 2 digits
     bool home_team_wins;                       // "HOME_TEAM_WINS" - 1 byte (true/false)
 
-    // Serialize the Record into a byte buffer
-    void serialize(uint8_t* buffer) const;
+    // Serialize the Record into COMPACT_RECORD_SIZE bytes, with teamCode in
+    // place of the team id. Returns false if a field does not fit its width.
+    bool serialize(uint8_t* buffer, uint8_t teamCode) const;
 
-    // Deserialize the Record from a byte buffer
-    void deserialize(const uint8_t* buffer);
+    // Deserialize a compact record whose team code stands for teamId
+    void deserialize(const uint8_t* buffer, uint32_t teamId);
+
+    // Deserialize a record in the row layout of older data files
+    // (RECORD_SIZE_WITH_PADDING bytes of text and integers)
+    void deserializeRow(const uint8_t* buffer);
 
     // Function to print a Record (useful for debugging)
     void print() const;
@@ -47,23 +246,286 @@ struct Record {
 
 // Block Structure
 struct Block {
-    Record records[RECORDS_PER_BLOCK];
+    Record records[MAX_RECORDS_PER_BLOCK];
     uint32_t numRecords;
 
     // Constructor to initialize numRecords
     Block() : numRecords(0) {}
 
-    // Serialize the Block into a byte buffer
-    void serialize(uint8_t* buffer) const;
+    // Serialize the Block into a byte buffer in a compact or PAX format;
+    // returns false if the records do not all fit a block of that format
+    bool serialize(uint8_t* buffer, BlockFormat format = DEFAULT_BLOCK_FORMAT) const;
 
-    // Deserialize the Block from a byte buffer
+    // Deserialize the Block from a byte buffer of any format
     void deserialize(const uint8_t* buffer);
 
+    // Deserialize only the record in one slot of a serialized block
+    static bool deserializeRecord(const uint8_t* buffer, uint32_t slot, Record& record);
+
     // Function to print all Records in the Block (useful for debugging)
     void print() const;
 };
-// Function to print block statistics
-void printBlockStatistics(size_t totalRecords);
+
+// Put a record into a slot of a compact or PAX block image; the block header
+// is left to the caller. The record's team joins the block's dictionary;
+// returns false if the dictionary is full without it or the record does not
+// fit the compact layout, so the caller can move on to a new block. Returns
+// false for the read-only row and text PAX formats as well.
+bool storeRecord(uint8_t* blockData, BlockFormat format, uint32_t slot, const Record& record);
+
+// Parse a percentage stored as text ("0.456") without std::stof; stops at the
+// first byte that is not a digit or '.', so unterminated fields are safe
+inline float parsePercent(const char* text, size_t maxLength) {
+    uint32_t whole = 0, fraction = 0, scale = 1;
+    bool afterPoint = false;
+    for (size_t i = 0; i < maxLength; ++i) {
+        char c = text[i];
+        if (c == '.' && !afterPoint) {
+            afterPoint = true;
+        } else if (c >= '0' && c <= '9') {
+            if (afterPoint) {
+                fraction = fraction * 10 + (c - '0');
+                scale *= 10;
+            } else {
+                whole = whole * 10 + (c - '0');
+            }
+        } else {
+            break;
+        }
+    }
+    return whole + static_cast<float>(fraction) / scale;
+}
+
+// Thousandths of a percentage stored as text ("0.456" -> 456), PCT_MISSING
+// for an empty field; digits past the third decimal are dropped
+inline uint16_t parsePercentThousandths(const char* text, size_t maxLength) {
+    if (maxLength == 0 || text[0] == '\0') {
+        return PCT_MISSING;
+    }
+    uint32_t whole = 0, fraction = 0, digits = 0;
+    bool afterPoint = false;
+    for (size_t i = 0; i < maxLength; ++i) {
+        char c = text[i];
+        if (c == '.' && !afterPoint) {
+            afterPoint = true;
+        } else if (c >= '0' && c <= '9') {
+            if (!afterPoint) {
+                whole = whole * 10 + (c - '0');
+            } else if (digits < 3) {
+                fraction = fraction * 10 + (c - '0');
+                digits++;
+            }
+        } else {
+            break;
+        }
+    }
+    for (; digits < 3; ++digits) {
+        fraction *= 10;
+    }
+    uint32_t thousandths = whole * 1000 + fraction;
+    return thousandths < PCT_MISSING ? static_cast<uint16_t>(thousandths) : PCT_MISSING - 1;
+}
+
+// Shortest text of a percentage in thousandths ("0.456", "0.5", "1"), empty
+// for PCT_MISSING; writes at most size - 1 characters and a terminator
+size_t formatPercent(uint16_t thousandths, char* text, size_t size);
+
+// Days since 1970-01-01 of a "dd/mm/yyyy" date, so dates can be used as
+// integer index keys that sort chronologically; 0 (1970-01-01) if the text is not a date
+inline uint32_t parseGameDate(const char* text, size_t maxLength) {
+    uint32_t parts[3] = {0, 0, 0};
+    int part = 0;
+    for (size_t i = 0; i < maxLength && text[i] != '\0'; ++i) {
+        if (text[i] == '/' && part < 2) {
+            part++;
+        } else if (text[i] >= '0' && text[i] <= '9') {
+            parts[part] = parts[part] * 10 + (text[i] - '0');
+        } else {
+            return 0;
+        }
+    }
+    int day = static_cast<int>(parts[0]), month = static_cast<int>(parts[1]), year = static_cast<int>(parts[2]);
+    if (part != 2 || day < 1 || day > 31 || month < 1 || month > 12 || year < 1970) {
+        return 0;
+    }
+    // Proleptic Gregorian day count with March as the first month of the year
+    year -= month <= 2;
+    int era = year / 400;
+    int yearOfEra = year - era * 400;
+    int dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return static_cast<uint32_t>(era * 146097 + dayOfEra - 719468);
+}
+
+// Date text of a day number, as games.txt writes it ("d/m/yyyy" without
+// leading zeros), empty for 0; writes at most size - 1 characters and a terminator
+size_t formatGameDate(uint32_t day, char* text, size_t size);
+
+// Read-only accessors over one serialized record: a row record, or a slot of
+// a PAX, text PAX or compact block. Each getter reads only its own field, so a
+// predicate on one column touches only the bytes of that column instead of
+// deserializing the whole record; on compact and PAX blocks no getter parses text.
+class RecordView {
+private:
+    const uint8_t* data;   // The row record, or the block
+    uint32_t slot;
+    BlockFormat format;
+
+    const uint8_t* field(Column column) const {
+        switch (format) {
+            case BLOCK_FORMAT_PAX:
+                return data + PAX_FIELD_OFFSETS[column] + slot * COMPACT_FIELD_SIZES[column];
+            case BLOCK_FORMAT_TEXT_PAX:
+                return data + TEXT_PAX_FIELD_OFFSETS[column] + slot * FIELD_SIZES[column];
+            case BLOCK_FORMAT_COMPACT:
+                return data + COMPACT_RECORDS_OFFSET + slot * COMPACT_RECORD_SIZE + COMPACT_FIELD_OFFSETS[column];
+            default:
+                return data + ROW_FIELD_OFFSETS[column];
+        }
+    }
+    const char* text(Column column) const { return reinterpret_cast<const char*>(field(column)); }
+    bool compact() const { return isCompactFormat(format); }
+
+    template <typename T>
+    static T read(const uint8_t* bytes) {
+        T value;
+        std::memcpy(&value, bytes, sizeof(T));
+        return value;
+    }
+    template <typename T>
+    T read(Column column) const { return read<T>(field(column)); }
+
+    uint16_t percent(Column column) const {
+        return compact() ? read<uint16_t>(column) : parsePercentThousandths(text(column), FIELD_SIZES[column] - 1);
+    }
+    bool percentMissing(Column column) const {
+        return compact() ? read<uint16_t>(column) == PCT_MISSING : *field(column) == '\0';
+    }
+    // Missing percentages read as 0, as they did when parsed from empty text
+    float percentValue(Column column) const {
+        uint16_t thousandths = percent(column);
+        return thousandths == PCT_MISSING ? 0.0f : thousandths / 1000.0f;
+    }
+
+public:
+    explicit RecordView(const uint8_t* data) : data(data), slot(0), format(BLOCK_FORMAT_ROW) {}
+
+    // Record in one slot of a PAX, text PAX or compact block
+    RecordView(const uint8_t* block, uint32_t slot, BlockFormat format) : data(block), slot(slot), format(format) {}
+
+    std::string gameDateEst() const {
+        if (compact()) {
+            char date[GAME_DATE_EST_SIZE];
+            return std::string(date, formatGameDate(gameDateDay(), date, sizeof(date)));
+        }
+        return std::string(text(COLUMN_GAME_DATE_EST), strnlen(text(COLUMN_GAME_DATE_EST), GAME_DATE_EST_SIZE - 1));
+    }
+    uint32_t gameDateDay() const {
+        return compact() ? read<uint16_t>(COLUMN_GAME_DATE_EST)
+                         : parseGameDate(text(COLUMN_GAME_DATE_EST), GAME_DATE_EST_SIZE - 1);
+    }
+    uint32_t teamIdHome() const {
+        return compact() ? read<uint32_t>(data + COMPACT_TEAMS_OFFSET + *field(COLUMN_TEAM_ID_HOME) * sizeof(uint32_t))
+                         : read<uint32_t>(COLUMN_TEAM_ID_HOME);
+    }
+    uint32_t ptsHome() const { return compact() ? read<uint16_t>(COLUMN_PTS_HOME) : read<uint32_t>(COLUMN_PTS_HOME); }
+    float fgPctHome() const { return percentValue(COLUMN_FG_PCT_HOME); }
+    float ftPctHome() const { return percentValue(COLUMN_FT_PCT_HOME); }
+    float fg3PctHome() const { return percentValue(COLUMN_FG3_PCT_HOME); }
+    // Percentages left empty in games.txt are stored as empty strings, or PCT_MISSING
+    bool fgPctMissing() const { return percentMissing(COLUMN_FG_PCT_HOME); }
+    bool ftPctMissing() const { return percentMissing(COLUMN_FT_PCT_HOME); }
+    bool fg3PctMissing() const { return percentMissing(COLUMN_FG3_PCT_HOME); }
+    uint16_t astHome() const { return read<uint16_t>(COLUMN_AST_HOME); }
+    uint16_t rebHome() const { return read<uint16_t>(COLUMN_REB_HOME); }
+    bool homeTeamWins() const { return *field(COLUMN_HOME_TEAM_WINS) != 0; }
+
+    // Materialize the full record, e.g. once a predicate has matched
+    Record toRecord() const {
+        Record record;
+        if (format == BLOCK_FORMAT_ROW) {
+            record.deserializeRow(data);
+        } else if (format == BLOCK_FORMAT_COMPACT) {
+            record.deserialize(field(COLUMN_GAME_DATE_EST), teamIdHome());
+        } else if (format == BLOCK_FORMAT_PAX) {
+            uint8_t packed[COMPACT_RECORD_SIZE] = {0};
+            for (int column = 0; column < NUM_COLUMNS; ++column) {
+                std::memcpy(packed + COMPACT_FIELD_OFFSETS[column], field(static_cast<Column>(column)),
+                            COMPACT_FIELD_SIZES[column]);
+            }
+            record.deserialize(packed, teamIdHome());
+        } else {
+            uint8_t row[RECORD_SIZE_WITH_PADDING] = {0};
+            for (int column = 0; column < NUM_COLUMNS; ++column) {
+                std::memcpy(row + ROW_FIELD_OFFSETS[column], field(static_cast<Column>(column)), FIELD_SIZES[column]);
+            }
+            record.deserializeRow(row);
+        }
+        return record;
+    }
+};
+
+// Read-only view of one serialized block of any format, handing out
+// RecordViews by slot, or whole columns for column-at-a-time scans
+class BlockView {
+private:
+    const uint8_t* data;
+    BlockFormat layout;
+    const uint8_t* tombstones;
+
+public:
+    explicit BlockView(const uint8_t* data)
+        : data(data), layout(blockFormat(data)), tombstones(data + blockTombstoneOffset(layout)) {}
+
+    BlockFormat format() const { return layout; }
+
+    // Record count, clamped to what fits in a block of the format
+    uint32_t numRecords() const {
+        uint32_t count = blockRecordCount(data);
+        size_t capacity = recordsPerBlock(layout);
+        return count > capacity ? static_cast<uint32_t>(capacity) : count;
+    }
+
+    RecordView record(uint32_t slot) const {
+        return layout == BLOCK_FORMAT_ROW ? RecordView(data + BLOCK_HEADER_SIZE + slot * RECORD_SIZE_WITH_PADDING)
+                                          : RecordView(data, slot, layout);
+    }
+
+    // The column's field of slot s is at fieldData(column) + s * fieldStride(column):
+    // a contiguous minipage in a PAX block (binary, COMPACT_FIELD_SIZES) or a
+    // text PAX block, every RECORD_SIZE_WITH_PADDING bytes in a row block, and
+    // every COMPACT_RECORD_SIZE bytes (binary, see COMPACT_FIELD_OFFSETS) in a
+    // compact block
+    const uint8_t* fieldData(Column column) const {
+        switch (layout) {
+            case BLOCK_FORMAT_PAX: return data + PAX_FIELD_OFFSETS[column];
+            case BLOCK_FORMAT_TEXT_PAX: return data + TEXT_PAX_FIELD_OFFSETS[column];
+            case BLOCK_FORMAT_COMPACT: return data + COMPACT_RECORDS_OFFSET + COMPACT_FIELD_OFFSETS[column];
+            default: return data + BLOCK_HEADER_SIZE + ROW_FIELD_OFFSETS[column];
+        }
+    }
+    size_t fieldStride(Column column) const {
+        switch (layout) {
+            case BLOCK_FORMAT_PAX: return COMPACT_FIELD_SIZES[column];
+            case BLOCK_FORMAT_TEXT_PAX: return FIELD_SIZES[column];
+            case BLOCK_FORMAT_COMPACT: return COMPACT_RECORD_SIZE;
+            default: return RECORD_SIZE_WITH_PADDING;
+        }
+    }
+
+    // Team id of a dictionary code in a compact or PAX block
+    uint32_t team(uint8_t code) const {
+        uint32_t teamId;
+        std::memcpy(&teamId, data + COMPACT_TEAMS_OFFSET + code * sizeof(uint32_t), sizeof(teamId));
+        return teamId;
+    }
+
+    // Scans skip slots that have been tombstoned
+    bool isDeleted(uint32_t slot) const { return (tombstones[slot / 8] >> (slot % 8)) & 1; }
+};
+
+// Function to print block statistics for data written in the given format
+void printBlockStatistics(size_t totalRecords, BlockFormat format = DEFAULT_BLOCK_FORMAT);
 
 
 #endif // RECORD_BLOCK_H
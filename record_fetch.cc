@@ -0,0 +1,77 @@
+// record_fetch.cc
+#include "record_fetch.h"
+#include <algorithm>
+#include <iostream>
+
+bool fetchRecord(BufferPool& bufferPool, RecordId rid, Record& record) {
+    uint32_t blockNumber = recordIdBlock(rid);
+    const uint8_t* blockData = bufferPool.FetchBlock(blockNumber);
+    if (!blockData) {
+        std::cerr << "Error reading block " << blockNumber << " from disk." << std::endl;
+        return false;
+    }
+    bool ok = Block::deserializeRecord(blockData, recordIdSlot(rid), record);
+    bufferPool.UnpinBlock(blockNumber, false);
+    return ok;
+}
+
+size_t fetchRecords(BufferPool& bufferPool, const std::vector<RecordId>& rids, std::vector<Record>& records) {
+    size_t fetched = 0;
+    size_t i = 0;
+    while (i < rids.size()) {
+        uint32_t blockNumber = recordIdBlock(rids[i]);
+        const uint8_t* blockData = bufferPool.FetchBlock(blockNumber);
+        if (!blockData) {
+            std::cerr << "Error reading block " << blockNumber << " from disk." << std::endl;
+            // Skip every id in the unreadable block
+            while (i < rids.size() && recordIdBlock(rids[i]) == blockNumber) i++;
+            continue;
+        }
+
+        for (; i < rids.size() && recordIdBlock(rids[i]) == blockNumber; ++i) {
+            Record record;
+            if (Block::deserializeRecord(blockData, recordIdSlot(rids[i]), record)) {
+                records.push_back(record);
+                fetched++;
+            }
+        }
+        bufferPool.UnpinBlock(blockNumber, false);
+    }
+    return fetched;
+}
+
+size_t deleteRecords(BufferPool& bufferPool, const std::vector<RecordId>& rids) {
+    // Group the ids by block so each block is pinned and dirtied once
+    std::vector<RecordId> sorted(rids);
+    std::sort(sorted.begin(), sorted.end());
+
+    size_t deleted = 0;
+    size_t i = 0;
+    while (i < sorted.size()) {
+        uint32_t blockNumber = recordIdBlock(sorted[i]);
+        uint8_t* blockData = bufferPool.FetchBlock(blockNumber);
+        if (!blockData) {
+            std::cerr << "Error reading block " << blockNumber << " from disk." << std::endl;
+            while (i < sorted.size() && recordIdBlock(sorted[i]) == blockNumber) i++;
+            continue;
+        }
+
+        BlockView view(blockData);
+        bool changed = false;
+        for (; i < sorted.size() && recordIdBlock(sorted[i]) == blockNumber; ++i) {
+            uint32_t slot = recordIdSlot(sorted[i]);
+            if (slot >= view.numRecords()) {
+                std::cerr << "Error: Slot " << slot << " is out of range (block holds "
+                          << view.numRecords() << " records).\n";
+                continue;
+            }
+            if (!view.isDeleted(slot)) {
+                markSlotDeleted(blockData, slot);
+                changed = true;
+                deleted++;
+            }
+        }
+        bufferPool.UnpinBlock(blockNumber, changed);
+    }
+    return deleted;
+}
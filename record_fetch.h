@@ -0,0 +1,21 @@
+// record_fetch.h
+#ifndef RECORD_FETCH_H
+#define RECORD_FETCH_H
+
+#include <vector>
+#include "buffer_pool.h"
+#include "record_block.h"
+
+// Read the record a RecordId points to, deserializing only its slot
+bool fetchRecord(BufferPool& bufferPool, RecordId rid, Record& record);
+
+// Read the records for a list of RecordIds in the given order. Consecutive ids
+// in the same block share one pinned frame. Returns the number of records read.
+size_t fetchRecords(BufferPool& bufferPool, const std::vector<RecordId>& rids, std::vector<Record>& records);
+
+// Tombstone the records for a list of RecordIds (see markSlotDeleted), one pin
+// per block; the blocks are written back when the pool flushes them. Returns
+// the number of records that were not already deleted.
+size_t deleteRecords(BufferPool& bufferPool, const std::vector<RecordId>& rids);
+
+#endif // RECORD_FETCH_H
@@ -0,0 +1,376 @@
+// secondary_index.cc
+#include "secondary_index.h"
+#include "range_scan.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+const char* columnName(Column column) {
+    switch (column) {
+        case COLUMN_GAME_DATE_EST: return "GAME_DATE_EST";
+        case COLUMN_TEAM_ID_HOME: return "TEAM_ID_home";
+        case COLUMN_PTS_HOME: return "PTS_home";
+        case COLUMN_FG_PCT_HOME: return "FG_PCT_home";
+        case COLUMN_FT_PCT_HOME: return "FT_PCT_home";
+        case COLUMN_FG3_PCT_HOME: return "FG3_PCT_home";
+        case COLUMN_AST_HOME: return "AST_home";
+        case COLUMN_REB_HOME: return "REB_home";
+        case COLUMN_HOME_TEAM_WINS: return "HOME_TEAM_WINS";
+        default: return "?";
+    }
+}
+
+// Float column value; false if the field is empty in games.txt
+static bool floatValue(const RecordView& record, Column column, float& value) {
+    switch (column) {
+        case COLUMN_FG_PCT_HOME:
+            if (record.fgPctMissing()) return false;
+            value = record.fgPctHome();
+            return true;
+        case COLUMN_FT_PCT_HOME:
+            if (record.ftPctMissing()) return false;
+            value = record.ftPctHome();
+            return true;
+        case COLUMN_FG3_PCT_HOME:
+            if (record.fg3PctMissing()) return false;
+            value = record.fg3PctHome();
+            return true;
+        default:
+            return false;
+    }
+}
+
+static uint32_t uintValue(const RecordView& record, Column column) {
+    switch (column) {
+        case COLUMN_GAME_DATE_EST: return record.gameDateDay();
+        case COLUMN_TEAM_ID_HOME: return record.teamIdHome();
+        case COLUMN_PTS_HOME: return record.ptsHome();
+        case COLUMN_AST_HOME: return record.astHome();
+        case COLUMN_REB_HOME: return record.rebHome();
+        case COLUMN_HOME_TEAM_WINS: return record.homeTeamWins() ? 1 : 0;
+        default: return 0;
+    }
+}
+
+// Field of a Record as a CoveringEntry stores it
+static uint32_t recordField(const Record& record, Column column) {
+    switch (column) {
+        case COLUMN_GAME_DATE_EST: return record.game_date_day;
+        case COLUMN_TEAM_ID_HOME: return record.team_id_home;
+        case COLUMN_PTS_HOME: return record.pts_home;
+        case COLUMN_FG_PCT_HOME: return record.fg_pct_home;
+        case COLUMN_FT_PCT_HOME: return record.ft_pct_home;
+        case COLUMN_FG3_PCT_HOME: return record.fg3_pct_home;
+        case COLUMN_AST_HOME: return record.ast_home;
+        case COLUMN_REB_HOME: return record.reb_home;
+        case COLUMN_HOME_TEAM_WINS: return record.home_team_wins ? 1 : 0;
+        default: return 0;
+    }
+}
+
+static void setRecordField(Record& record, Column column, uint32_t value) {
+    switch (column) {
+        case COLUMN_GAME_DATE_EST: record.game_date_day = value; break;
+        case COLUMN_TEAM_ID_HOME: record.team_id_home = value; break;
+        case COLUMN_PTS_HOME: record.pts_home = value; break;
+        case COLUMN_FG_PCT_HOME: record.fg_pct_home = static_cast<uint16_t>(value); break;
+        case COLUMN_FT_PCT_HOME: record.ft_pct_home = static_cast<uint16_t>(value); break;
+        case COLUMN_FG3_PCT_HOME: record.fg3_pct_home = static_cast<uint16_t>(value); break;
+        case COLUMN_AST_HOME: record.ast_home = static_cast<uint16_t>(value); break;
+        case COLUMN_REB_HOME: record.reb_home = static_cast<uint16_t>(value); break;
+        case COLUMN_HOME_TEAM_WINS: record.home_team_wins = value != 0; break;
+        default: break;
+    }
+}
+
+// Key order, then RecordId order, as the plain indexes are loaded
+template <typename Key>
+static bool coveringEntryLess(const std::pair<Key, CoveringEntry>& a, const std::pair<Key, CoveringEntry>& b) {
+    return a.first < b.first || (a.first == b.first && a.second.rid < b.second.rid);
+}
+
+// Integer bounds of a range, rounded inwards; false if no integer is inside
+static bool uintBounds(const ColumnRange& range, uint32_t& low, uint32_t& high) {
+    const double maxKey = 4294967295.0;
+    if (range.low > range.high || range.high < 0.0 || range.low > maxKey) {
+        return false;
+    }
+    low = range.low <= 0.0 ? 0 : static_cast<uint32_t>(std::ceil(range.low));
+    high = range.high >= maxKey ? 0xFFFFFFFFu : static_cast<uint32_t>(std::floor(range.high));
+    return low <= high;
+}
+
+bool matchesRange(const RecordView& record, const ColumnRange& range) {
+    if (isFloatColumn(range.column)) {
+        float value;
+        return floatValue(record, range.column, value) &&
+               value >= static_cast<float>(range.low) && value <= static_cast<float>(range.high);
+    }
+    uint32_t low, high;
+    if (!uintBounds(range, low, high)) {
+        return false;
+    }
+    uint32_t value = uintValue(record, range.column);
+    return value >= low && value <= high;
+}
+
+// Constructor
+SecondaryIndexes::SecondaryIndexes(Disk& disk)
+    : disk(disk),
+      numRecords(0),
+      firstBlock(0),
+      numBlocks(0),
+      blocksFetched(0) {
+    for (int c = 0; c < NUM_COLUMNS; ++c) {
+        indexed[c] = false;
+    }
+}
+
+bool SecondaryIndexes::addIndex(Column column, const std::vector<Column>& includedColumns) {
+    if (indexed[column]) {
+        return false;
+    }
+    if (includedColumns.size() > static_cast<size_t>(MAX_INCLUDED_COLUMNS)) {
+        std::cerr << "Error: An index includes at most " << MAX_INCLUDED_COLUMNS << " columns, "
+                  << includedColumns.size() << " given for " << columnName(column) << std::endl;
+        return false;
+    }
+    indexed[column] = true;
+    included[column] = includedColumns;
+    bool covering = !includedColumns.empty();
+    if (isFloatColumn(column)) {
+        if (covering) {
+            floatCoveringIndexes[column].reset(new CoveringBPTree());
+        } else {
+            floatIndexes[column].reset(new BPTree());
+        }
+    } else if (covering) {
+        uintCoveringIndexes[column].reset(new UIntCoveringBPTree());
+    } else {
+        uintIndexes[column].reset(new UIntBPTree());
+    }
+    return true;
+}
+
+bool SecondaryIndexes::covers(Column column, const std::vector<Column>& columns) const {
+    if (!indexed[column]) {
+        return false;
+    }
+    for (Column wanted : columns) {
+        if (std::find(included[column].begin(), included[column].end(), wanted) == included[column].end()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+CoveringEntry SecondaryIndexes::coveringEntry(Column column, const Record& record, RecordId rid) const {
+    CoveringEntry entry = CoveringEntry();
+    entry.rid = rid;
+    for (size_t i = 0; i < included[column].size(); ++i) {
+        entry.values[i] = recordField(record, included[column][i]);
+    }
+    return entry;
+}
+
+bool SecondaryIndexes::build(uint32_t first, uint32_t count) {
+    firstBlock = first;
+    numBlocks = count;
+    numRecords = 0;
+
+    std::vector<std::pair<float, RecordId>> floatEntries[NUM_COLUMNS];
+    std::vector<std::pair<uint32_t, RecordId>> uintEntries[NUM_COLUMNS];
+    std::vector<std::pair<float, CoveringEntry>> floatCoveringEntries[NUM_COLUMNS];
+    std::vector<std::pair<uint32_t, CoveringEntry>> uintCoveringEntries[NUM_COLUMNS];
+    bool anyIncluded = false;
+    for (int c = 0; c < NUM_COLUMNS; ++c) {
+        anyIncluded = anyIncluded || !included[c].empty();
+    }
+
+    // One sequential pass over the data file feeds every index
+    std::vector<uint8_t> runBuffer(static_cast<size_t>(DEFAULT_SCAN_RUN_BLOCKS) * BLOCK_SIZE);
+    disk.AdviseAccess(Disk::ACCESS_SEQUENTIAL);
+    for (uint32_t block = 0; block < count; block += DEFAULT_SCAN_RUN_BLOCKS) {
+        uint32_t runLength = std::min<uint32_t>(DEFAULT_SCAN_RUN_BLOCKS, count - block);
+        if (!disk.ReadBlocks(first + block, runLength, runBuffer.data())) {
+            std::cerr << "Error: Failed to read data blocks while building the indexes." << std::endl;
+            return false;
+        }
+        for (uint32_t b = 0; b < runLength; ++b) {
+            BlockView view(&runBuffer[static_cast<size_t>(b) * BLOCK_SIZE]);
+            for (uint32_t slot = 0; slot < view.numRecords(); ++slot) {
+                if (view.isDeleted(slot)) {
+                    continue;
+                }
+                RecordView record = view.record(slot);
+                RecordId rid = makeRecordId(first + block + b, slot);
+                // Every field, decoded once for the covering indexes
+                Record fields = anyIncluded ? record.toRecord() : Record();
+                for (int c = 0; c < NUM_COLUMNS; ++c) {
+                    if (!indexed[c]) {
+                        continue;
+                    }
+                    Column column = static_cast<Column>(c);
+                    bool covering = !included[c].empty();
+                    float value;
+                    if (!isFloatColumn(column)) {
+                        if (covering) {
+                            uintCoveringEntries[c].push_back(
+                                std::make_pair(uintValue(record, column), coveringEntry(column, fields, rid)));
+                        } else {
+                            uintEntries[c].push_back(std::make_pair(uintValue(record, column), rid));
+                        }
+                    } else if (floatValue(record, column, value)) {
+                        if (covering) {
+                            floatCoveringEntries[c].push_back(std::make_pair(value, coveringEntry(column, fields, rid)));
+                        } else {
+                            floatEntries[c].push_back(std::make_pair(value, rid));
+                        }
+                    }
+                }
+                numRecords++;
+            }
+        }
+    }
+
+    for (int c = 0; c < NUM_COLUMNS; ++c) {
+        if (!indexed[c]) {
+            continue;
+        }
+        bool loaded;
+        if (floatCoveringIndexes[c]) {
+            std::sort(floatCoveringEntries[c].begin(), floatCoveringEntries[c].end(), coveringEntryLess<float>);
+            loaded = floatCoveringIndexes[c]->bulkLoad(floatCoveringEntries[c]);
+        } else if (uintCoveringIndexes[c]) {
+            std::sort(uintCoveringEntries[c].begin(), uintCoveringEntries[c].end(), coveringEntryLess<uint32_t>);
+            loaded = uintCoveringIndexes[c]->bulkLoad(uintCoveringEntries[c]);
+        } else if (isFloatColumn(static_cast<Column>(c))) {
+            std::sort(floatEntries[c].begin(), floatEntries[c].end());
+            loaded = floatIndexes[c]->bulkLoad(floatEntries[c]);
+        } else {
+            std::sort(uintEntries[c].begin(), uintEntries[c].end());
+            loaded = uintIndexes[c]->bulkLoad(uintEntries[c]);
+        }
+        if (!loaded) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void SecondaryIndexes::insertRecord(const RecordView& record, RecordId rid) {
+    Record fields = record.toRecord();
+    for (int c = 0; c < NUM_COLUMNS; ++c) {
+        if (!indexed[c]) {
+            continue;
+        }
+        Column column = static_cast<Column>(c);
+        float value;
+        if (!isFloatColumn(column)) {
+            if (uintCoveringIndexes[c]) {
+                uintCoveringIndexes[c]->insert(uintValue(record, column), coveringEntry(column, fields, rid), disk);
+            } else {
+                uintIndexes[c]->insert(uintValue(record, column), rid, disk);
+            }
+        } else if (floatValue(record, column, value)) {
+            if (floatCoveringIndexes[c]) {
+                floatCoveringIndexes[c]->insert(value, coveringEntry(column, fields, rid), disk);
+            } else {
+                floatIndexes[c]->insert(value, rid, disk);
+            }
+        }
+    }
+    numRecords++;
+    if (recordIdBlock(rid) >= firstBlock + numBlocks) {
+        numBlocks = recordIdBlock(rid) - firstBlock + 1;
+    }
+}
+
+size_t SecondaryIndexes::countRange(const ColumnRange& range) const {
+    if (!indexed[range.column]) {
+        return 0;
+    }
+    if (isFloatColumn(range.column)) {
+        float low = static_cast<float>(range.low), high = static_cast<float>(range.high);
+        return floatCoveringIndexes[range.column] ? floatCoveringIndexes[range.column]->countRange(low, high)
+                                                  : floatIndexes[range.column]->countRange(low, high);
+    }
+    uint32_t low, high;
+    if (!uintBounds(range, low, high)) {
+        return 0;
+    }
+    return uintCoveringIndexes[range.column] ? uintCoveringIndexes[range.column]->countRange(low, high)
+                                             : uintIndexes[range.column]->countRange(low, high);
+}
+
+// Leaf entries of a covering index within the range, in key order
+static std::vector<CoveringEntry> coveringRange(CoveringBPTree* floatIndex, UIntCoveringBPTree* uintIndex,
+                                                const ColumnRange& range, Disk& disk) {
+    if (floatIndex) {
+        return floatIndex->rangeQuery(static_cast<float>(range.low), static_cast<float>(range.high), disk);
+    }
+    uint32_t low, high;
+    if (!uintBounds(range, low, high)) {
+        return std::vector<CoveringEntry>();
+    }
+    return uintIndex->rangeQuery(low, high, disk);
+}
+
+std::vector<RecordId> SecondaryIndexes::lookupRange(const ColumnRange& range) {
+    std::vector<RecordId> rids;
+    if (!indexed[range.column]) {
+        return rids;
+    }
+    if (!included[range.column].empty()) {
+        for (const CoveringEntry& entry : coveringRange(floatCoveringIndexes[range.column].get(),
+                                                        uintCoveringIndexes[range.column].get(), range, disk)) {
+            rids.push_back(entry.rid);
+        }
+    } else if (isFloatColumn(range.column)) {
+        rids = floatIndexes[range.column]->rangeQuery(static_cast<float>(range.low), static_cast<float>(range.high), disk);
+    } else {
+        uint32_t low, high;
+        if (uintBounds(range, low, high)) {
+            rids = uintIndexes[range.column]->rangeQuery(low, high, disk);
+        }
+    }
+    // The index returns them in key order; intersections need RecordId order
+    std::sort(rids.begin(), rids.end());
+    return rids;
+}
+
+size_t SecondaryIndexes::rangeQuery(const ColumnRange& range, const std::vector<Column>& columns,
+                                    std::vector<Record>& results, std::vector<RecordId>* matchedIds) {
+    blocksFetched = 0;
+    if (!indexed[range.column]) {
+        return 0;
+    }
+    if (!covers(range.column, columns)) {
+        RangeScanExecutor scan(disk);
+        size_t added = scan.execute(lookupRange(range), RangeScanExecutor::Predicate(), results, matchedIds);
+        blocksFetched = scan.getStats().distinctBlocks;
+        return added;
+    }
+
+    // Every requested column is in the leaf entries
+    const std::vector<Column>& columnsInEntry = included[range.column];
+    std::vector<int> positions;
+    for (Column column : columns) {
+        positions.push_back(static_cast<int>(std::find(columnsInEntry.begin(), columnsInEntry.end(), column) -
+                                             columnsInEntry.begin()));
+    }
+    std::vector<CoveringEntry> entries = coveringRange(floatCoveringIndexes[range.column].get(),
+                                                       uintCoveringIndexes[range.column].get(), range, disk);
+    results.reserve(results.size() + entries.size());
+    for (const CoveringEntry& entry : entries) {
+        Record record = Record();
+        for (size_t i = 0; i < columns.size(); ++i) {
+            setRecordField(record, columns[i], entry.values[positions[i]]);
+        }
+        results.push_back(record);
+        if (matchedIds) {
+            matchedIds->push_back(entry.rid);
+        }
+    }
+    return entries.size();
+}
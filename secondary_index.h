@@ -0,0 +1,90 @@
+// secondary_index.h
+#ifndef SECONDARY_INDEX_H
+#define SECONDARY_INDEX_H
+
+#include <vector>
+#include <memory>
+#include "disk.h"
+#include "bptree.h"
+#include "record_block.h"
+
+const char* columnName(Column column);
+
+// One conjunct of a query: low <= column <= high. Integer columns round the
+// bounds inwards, float columns compare in float like the index keys do.
+struct ColumnRange {
+    Column column;
+    double low;
+    double high;
+
+    ColumnRange(Column column, double low, double high) : column(column), low(low), high(high) {}
+};
+
+// Whether the record satisfies the range; a missing percentage never does
+bool matchesRange(const RecordView& record, const ColumnRange& range);
+
+// A set of B+ tree indexes over different columns of the same data file,
+// all mapping a column value to RecordIds. Choose the columns with addIndex,
+// fill them with build, then keep them current with insertRecord.
+//
+// An index may include other columns: their values are stored in the leaf
+// entries next to the RecordId (a CoveringEntry), so rangeQuery can return
+// them without reading a data block.
+class SecondaryIndexes {
+private:
+    Disk& disk;
+    std::unique_ptr<BPTree> floatIndexes[NUM_COLUMNS];
+    std::unique_ptr<UIntBPTree> uintIndexes[NUM_COLUMNS];
+    std::unique_ptr<CoveringBPTree> floatCoveringIndexes[NUM_COLUMNS];
+    std::unique_ptr<UIntCoveringBPTree> uintCoveringIndexes[NUM_COLUMNS];
+    std::vector<Column> included[NUM_COLUMNS];
+    bool indexed[NUM_COLUMNS];
+    size_t numRecords;
+    uint32_t firstBlock;
+    uint32_t numBlocks;
+    size_t blocksFetched;
+
+    CoveringEntry coveringEntry(Column column, const Record& record, RecordId rid) const;
+
+public:
+    SecondaryIndexes(Disk& disk);
+
+    // Index column, storing the values of includedColumns in its leaves.
+    // Returns false (and adds nothing) if the column is indexed already or
+    // more than MAX_INCLUDED_COLUMNS are included.
+    bool addIndex(Column column, const std::vector<Column>& includedColumns = std::vector<Column>());
+    bool hasIndex(Column column) const { return indexed[column]; }
+
+    // Whether the column's index includes every one of columns
+    bool covers(Column column, const std::vector<Column>& columns) const;
+
+    // Read blocks [firstBlock, firstBlock + numBlocks) once and bulk load every index
+    bool build(uint32_t firstBlock, uint32_t numBlocks);
+
+    // Add a record written at rid to every index
+    void insertRecord(const RecordView& record, RecordId rid);
+
+    // Entries of the column's index within the range (exact, no RIDs collected)
+    size_t countRange(const ColumnRange& range) const;
+
+    // RecordIds of the column's index within the range, sorted ascending
+    std::vector<RecordId> lookupRange(const ColumnRange& range);
+
+    // Append the records of the column's index within the range to results,
+    // with at least the given columns filled in, and return how many were
+    // added; matchedIds, when given, gets the RecordId of each one. If the
+    // index covers the columns they come from its leaves, in key order, and
+    // the other fields are zero; otherwise the records are read from the
+    // data file in block order.
+    size_t rangeQuery(const ColumnRange& range, const std::vector<Column>& columns, std::vector<Record>& results,
+                      std::vector<RecordId>* matchedIds = nullptr);
+    // Data blocks the last rangeQuery read, 0 when it was covered
+    size_t getBlocksFetched() const { return blocksFetched; }
+
+    size_t getNumRecords() const { return numRecords; }
+    uint32_t getFirstBlock() const { return firstBlock; }
+    uint32_t getNumBlocks() const { return numBlocks; }
+    Disk& getDisk() { return disk; }
+};
+
+#endif // SECONDARY_INDEX_H
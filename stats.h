@@ -0,0 +1,181 @@
+// stats.h
+#ifndef STATS_H
+#define STATS_H
+
+#include <cstdint>
+#include <chrono>
+#include <iostream>
+
+// Counters are only maintained when built with -DENABLE_STATS, and trace
+// lines are only printed when built with -DENABLE_TRACE. Without the flags
+// STATS_ADD, STATS_TIMER and TRACE expand to nothing, so the hot paths carry
+// no bookkeeping or logging; the stats objects still exist and read as zero.
+#ifdef ENABLE_STATS
+const bool STATS_ENABLED = true;
+#define STATS_ADD(counter, amount) ((counter) += (amount))
+#define STATS_TIMER(name, histogram) ScopedLatency name(histogram)
+#else
+const bool STATS_ENABLED = false;
+#define STATS_ADD(counter, amount) ((void)0)
+#define STATS_TIMER(name, histogram) ((void)0)
+#endif
+
+#ifdef ENABLE_TRACE
+#define TRACE(message) (std::cerr << "[TRACE] " << message << std::endl)
+#else
+#define TRACE(message) ((void)0)
+#endif
+
+const int LATENCY_BUCKETS = 40;   // Bucket i holds latencies in [2^i, 2^(i+1)) ns
+
+// Log2 histogram of operation latencies in nanoseconds
+struct LatencyHistogram {
+    uint64_t count;
+    uint64_t totalNanos;
+    uint64_t maxNanos;
+    uint64_t buckets[LATENCY_BUCKETS];
+
+    LatencyHistogram() { reset(); }
+
+    void reset() {
+        count = 0;
+        totalNanos = 0;
+        maxNanos = 0;
+        for (int i = 0; i < LATENCY_BUCKETS; ++i) {
+            buckets[i] = 0;
+        }
+    }
+
+    void record(uint64_t nanos) {
+        int bucket = 0;
+        while (bucket < LATENCY_BUCKETS - 1 && (nanos >> (bucket + 1)) != 0) {
+            bucket++;
+        }
+        buckets[bucket]++;
+        count++;
+        totalNanos += nanos;
+        if (nanos > maxNanos) {
+            maxNanos = nanos;
+        }
+    }
+
+    // {"count":..,"total_ns":..,"max_ns":..,"buckets":[[upper bound ns, count], ...]}
+    // Only non-empty buckets are listed
+    void writeJson(std::ostream& out) const {
+        out << "{\"count\":" << count << ",\"total_ns\":" << totalNanos << ",\"max_ns\":" << maxNanos
+            << ",\"buckets\":[";
+        bool first = true;
+        for (int i = 0; i < LATENCY_BUCKETS; ++i) {
+            if (buckets[i] == 0) {
+                continue;
+            }
+            out << (first ? "" : ",") << "[" << (uint64_t(1) << (i + 1)) << "," << buckets[i] << "]";
+            first = false;
+        }
+        out << "]}";
+    }
+};
+
+// Records the time from construction to destruction into a histogram
+class ScopedLatency {
+private:
+    LatencyHistogram& histogram;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    ScopedLatency(LatencyHistogram& histogram)
+        : histogram(histogram), start(std::chrono::steady_clock::now()) {}
+    ~ScopedLatency() {
+        histogram.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count()));
+    }
+};
+
+// Block I/O seen by one Disk
+struct IoStats {
+    uint64_t blocksRead;
+    uint64_t blocksWritten;
+    uint64_t bytesRead;
+    uint64_t bytesWritten;
+    uint64_t readCalls;        // System calls / copies issued for reads
+    uint64_t writeCalls;
+    uint64_t cacheHits;        // Blocks served by a buffer pool without touching the disk
+    LatencyHistogram readLatency;
+    LatencyHistogram writeLatency;
+
+    IoStats() { reset(); }
+
+    void reset() {
+        blocksRead = 0;
+        blocksWritten = 0;
+        bytesRead = 0;
+        bytesWritten = 0;
+        readCalls = 0;
+        writeCalls = 0;
+        cacheHits = 0;
+        readLatency.reset();
+        writeLatency.reset();
+    }
+
+    void writeJson(std::ostream& out) const {
+        out << "{\"blocks_read\":" << blocksRead << ",\"blocks_written\":" << blocksWritten
+            << ",\"bytes_read\":" << bytesRead << ",\"bytes_written\":" << bytesWritten
+            << ",\"read_calls\":" << readCalls << ",\"write_calls\":" << writeCalls
+            << ",\"cache_hits\":" << cacheHits << ",\"read_latency\":";
+        readLatency.writeJson(out);
+        out << ",\"write_latency\":";
+        writeLatency.writeJson(out);
+        out << "}";
+    }
+};
+
+// Node accesses and operation latencies of one index
+struct IndexStats {
+    uint64_t nodesVisited;     // Every node read, internal and leaf
+    uint64_t leavesVisited;
+    uint64_t searches;
+    uint64_t rangeQueries;
+    uint64_t inserts;
+    uint64_t removes;          // remove and removeRange calls
+    uint64_t entriesReturned;
+    uint64_t entriesRemoved;
+    LatencyHistogram searchLatency;
+    LatencyHistogram rangeQueryLatency;
+    LatencyHistogram insertLatency;
+    LatencyHistogram removeLatency;
+
+    IndexStats() { reset(); }
+
+    void reset() {
+        nodesVisited = 0;
+        leavesVisited = 0;
+        searches = 0;
+        rangeQueries = 0;
+        inserts = 0;
+        removes = 0;
+        entriesReturned = 0;
+        entriesRemoved = 0;
+        searchLatency.reset();
+        rangeQueryLatency.reset();
+        insertLatency.reset();
+        removeLatency.reset();
+    }
+
+    void writeJson(std::ostream& out) const {
+        out << "{\"nodes_visited\":" << nodesVisited << ",\"leaves_visited\":" << leavesVisited
+            << ",\"searches\":" << searches << ",\"range_queries\":" << rangeQueries
+            << ",\"inserts\":" << inserts << ",\"entries_returned\":" << entriesReturned
+            << ",\"removes\":" << removes << ",\"entries_removed\":" << entriesRemoved
+            << ",\"search_latency\":";
+        searchLatency.writeJson(out);
+        out << ",\"range_query_latency\":";
+        rangeQueryLatency.writeJson(out);
+        out << ",\"insert_latency\":";
+        insertLatency.writeJson(out);
+        out << ",\"remove_latency\":";
+        removeLatency.writeJson(out);
+        out << "}";
+    }
+};
+
+#endif // STATS_H
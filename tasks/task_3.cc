@@ -1,5 +1,6 @@
 #include "../bptree.h"
 #include "../disk.h"
+#include "../range_scan.h"
 #include "../record_block.h"
 #include <iostream>
 #include <vector>
@@ -18,33 +19,22 @@ int main() {
     float startKey = 0.5f;
     float endKey = 0.8f;
 
-    std::vector<uint32_t> recordPointers = newBPTree.rangeQuery(startKey, endKey, disk);
+    // The index holds the id of every matching record, so no re-filtering is needed
+    std::vector<RecordId> rids = newBPTree.rangeQuery(startKey, endKey, disk);
 
     std::cout << "Records with FG_PCT_home in range [" << startKey << ", " << endKey << "]:" << std::endl;
 
-    // Read and print the records from disk
-    for (uint32_t recordPointer : recordPointers) {
-        uint32_t blockNum = recordPointer; // Assuming recordPointer is the block number
-
-        uint8_t readBuffer[BLOCK_SIZE];
-        std::memset(readBuffer, 0, BLOCK_SIZE);
-
-        if (disk.ReadBlock(blockNum, readBuffer)) {
-            Block block;
-            block.deserialize(readBuffer);
-
-            // Iterate through records in the block
-            for (uint32_t i = 0; i < block.numRecords; ++i) {
-                float fgPct = std::stof(block.records[i].fg_pct_home);
-                if (fgPct >= startKey && fgPct <= endKey) {
-                    block.records[i].print();
-                }
-            }
-        } else {
-            std::cerr << "Error reading block " << blockNum << " from disk." << std::endl;
-        }
+    // Read each distinct data block once, in disk order, touching only the listed slots
+    RangeScanExecutor scan(disk);
+    std::vector<Record> records;
+    scan.execute(rids, RangeScanExecutor::Predicate(), records);
+    for (const Record& record : records) {
+        record.print();
     }
+    std::cout << "Number of records found: " << records.size() << std::endl;
+
+    scan.getStats().print();
 
     return 0;
 }
-// Compile with g++ -std=c++11 task_3.cc ../disk.cc ../bptree.cc ../record_block.cc -o task_3
+// Compile with g++ -std=c++11 -pthread task_3.cc ../disk.cc ../async_io.cc ../range_scan.cc ../bptree.cc ../record_block.cc -o task_3
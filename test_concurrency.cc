@@ -0,0 +1,134 @@
+#include "disk.h"
+#include "bptree.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+const uint32_t NUM_KEYS = 1000000;             // Even keys 0, 2, ..., loaded before the threads start
+const uint32_t INSERTED_VALUE_BIT = 0x80000000u;  // Marks values added by a writer
+const uint32_t WRITER_ID_SHIFT = 30;              // Which writer, below the marker bit
+const unsigned NUM_WRITERS = 2;
+const uint32_t RANGE_WIDTH = 200;
+
+// Point lookups and short range queries on the bulk-loaded keys. Their values
+// never change, so every answer can be checked while the writer splits nodes.
+static void readerLoop(UIntBPTree& tree, Disk& disk, unsigned seed, const std::atomic<bool>& stop,
+                       std::atomic<uint64_t>& operations, std::atomic<uint64_t>& errors) {
+    std::mt19937 rng(seed);
+    uint64_t done = 0, wrong = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+        uint32_t key = (rng() % NUM_KEYS) * 2;
+        if (done % 16 == 0) {
+            std::vector<RecordId> values = tree.rangeQuery(key, key + RANGE_WIDTH, disk);
+            uint32_t expected = key / 2;
+            for (RecordId value : values) {
+                if (value & INSERTED_VALUE_BIT) {
+                    continue;
+                }
+                wrong += value != expected;
+                expected++;
+            }
+            wrong += expected != std::min(key / 2 + RANGE_WIDTH / 2 + 1, NUM_KEYS);
+        } else {
+            std::vector<RecordId> values = tree.search(key);
+            wrong += values.size() != 1 || values[0] != key / 2;
+        }
+        done++;
+    }
+    operations += done;
+    errors += wrong;
+}
+
+static RecordId insertedValue(unsigned writer, size_t i) {
+    return INSERTED_VALUE_BIT | (writer << WRITER_ID_SHIFT) | static_cast<uint32_t>(i);
+}
+
+// Inserts odd keys, splitting leaves and inner nodes along the way
+static void writerLoop(UIntBPTree& tree, Disk& disk, unsigned writer, const std::atomic<bool>& stop,
+                       std::vector<uint32_t>& insertedKeys) {
+    std::mt19937 rng(7 + writer * 1000 + insertedKeys.size());
+    while (!stop.load(std::memory_order_relaxed)) {
+        uint32_t key = (rng() % NUM_KEYS) * 2 + 1;
+        tree.insert(key, insertedValue(writer, insertedKeys.size()), disk);
+        insertedKeys.push_back(key);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    unsigned maxReaders = argc > 1 ? std::atoi(argv[1]) : 8;
+    double phaseSeconds = argc > 2 ? std::atof(argv[2]) : 1.0;
+
+    Disk disk("test_disk.db");
+    UIntBPTree tree;
+    std::vector<std::pair<uint32_t, RecordId>> entries;
+    for (uint32_t i = 0; i < NUM_KEYS; ++i) {
+        entries.push_back(std::make_pair(i * 2, i));
+    }
+    // Full nodes, so the writer's first inserts split straight away
+    if (!tree.bulkLoad(entries)) {
+        return 1;
+    }
+    std::cout << "Hardware threads: " << std::thread::hardware_concurrency() << ", tree of " << NUM_KEYS
+              << " keys, height " << tree.getHeight() << std::endl;
+
+    std::vector<uint32_t> insertedKeys[NUM_WRITERS];
+    uint64_t totalErrors = 0;
+    double singleReaderRate = 0.0;
+    for (unsigned readers = 1; readers <= maxReaders; readers *= 2) {
+        std::atomic<bool> stop(false);
+        std::atomic<uint64_t> operations(0), errors(0);
+        size_t insertedBefore = insertedKeys[0].size() + insertedKeys[1].size();
+
+        Clock::time_point start = Clock::now();
+        std::vector<std::thread> threads;
+        for (unsigned w = 0; w < NUM_WRITERS; ++w) {
+            threads.push_back(std::thread(writerLoop, std::ref(tree), std::ref(disk), w, std::cref(stop),
+                                          std::ref(insertedKeys[w])));
+        }
+        for (unsigned r = 0; r < readers; ++r) {
+            threads.push_back(std::thread(readerLoop, std::ref(tree), std::ref(disk), 100 + r,
+                                          std::cref(stop), std::ref(operations), std::ref(errors)));
+        }
+        std::this_thread::sleep_for(std::chrono::duration<double>(phaseSeconds));
+        stop = true;
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        double rate = operations / seconds;
+        if (readers == 1) {
+            singleReaderRate = rate;
+        }
+        std::cout << readers << " reader(s): " << static_cast<uint64_t>(rate) << " reads/s ("
+                  << (singleReaderRate > 0 ? rate / singleReaderRate : 0.0) << "x one reader), "
+                  << static_cast<uint64_t>((insertedKeys[0].size() + insertedKeys[1].size() - insertedBefore) / seconds)
+                  << " inserts/s, " << errors << " wrong answers" << std::endl;
+        totalErrors += errors;
+    }
+
+    // Every key the writers inserted must be there, and the tree must still be well formed
+    size_t missing = 0;
+    for (unsigned w = 0; w < NUM_WRITERS; ++w) {
+        for (size_t i = 0; i < insertedKeys[w].size(); ++i) {
+            std::vector<RecordId> values = tree.search(insertedKeys[w][i]);
+            missing += std::find(values.begin(), values.end(), insertedValue(w, i)) == values.end();
+        }
+    }
+    std::cout << insertedKeys[0].size() + insertedKeys[1].size() << " keys inserted, " << missing << " missing, height "
+              << tree.getHeight() << std::endl;
+    if (totalErrors != 0 || missing != 0 || !tree.checkStructure()) {
+        std::cerr << "Error: Concurrent readers saw wrong results or the tree is inconsistent" << std::endl;
+        return 1;
+    }
+    std::cout << "Concurrency test passed" << std::endl;
+    return 0;
+}
+// Compile with g++ -std=c++11 -O2 -pthread test_concurrency.cc disk.cc bptree.cc -o test_concurrency
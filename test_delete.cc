@@ -0,0 +1,185 @@
+#include "disk.h"
+#include "buffer_pool.h"
+#include "bptree_impl.h"
+#include "ingest.h"
+#include "record_fetch.h"
+#include "record_block.h"
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <random>
+#include <vector>
+#include <algorithm>
+
+typedef std::map<uint32_t, std::vector<RecordId>> ExpectedIndex;
+
+// Trees of a few keys per node, so a few thousand keys give many levels and
+// every delete exercises borrowing and merging
+typedef BasicBPTree<uint32_t, RecordId, std::less<uint32_t>, 4> Order4BPTree;
+typedef BasicBPTree<uint32_t, RecordId, std::less<uint32_t>, 5> Order5BPTree;
+
+// Values the tree should return for [startKey, endKey], taken out of expected
+static std::vector<RecordId> takeExpected(ExpectedIndex& expected, uint32_t startKey, uint32_t endKey) {
+    std::vector<RecordId> values;
+    ExpectedIndex::iterator first = expected.lower_bound(startKey);
+    ExpectedIndex::iterator last = expected.upper_bound(endKey);
+    for (ExpectedIndex::iterator it = first; it != last; ++it) {
+        values.insert(values.end(), it->second.begin(), it->second.end());
+    }
+    expected.erase(first, last);
+    return values;
+}
+
+// Single-key and range deletes mixed with inserts on a tree of numKeys keys,
+// checked against a std::map and with checkStructure after every round
+template <typename Tree>
+static bool testRandomDeletes(Disk& disk, uint32_t numKeys) {
+    Tree tree;
+    ExpectedIndex expected;
+    std::vector<std::pair<uint32_t, RecordId>> entries;
+    for (uint32_t i = 0; i < numKeys; ++i) {
+        entries.push_back(std::make_pair(i * 2, i));
+        expected[i * 2].push_back(i);
+    }
+    if (!tree.bulkLoad(entries, 0.7)) {
+        return false;
+    }
+    std::cout << "Tree of " << entries.size() << " keys, height " << tree.getHeight()
+              << ", " << tree.getNumberOfNodes() << " nodes" << std::endl;
+
+    std::mt19937 rng(42);
+    RecordId nextValue = numKeys;
+    for (int round = 0; round < 300; ++round) {
+        for (int k = 0; k < 20; ++k) {
+            uint32_t key = (rng() % numKeys) * 2;
+            if (tree.remove(key) != takeExpected(expected, key, key)) {
+                std::cerr << "Error: remove(" << key << ") returned the wrong values" << std::endl;
+                return false;
+            }
+        }
+
+        // Mostly short ranges, every tenth round one spanning many leaves
+        uint32_t startKey = rng() % (numKeys * 2);
+        uint32_t endKey = startKey + (round % 10 == 0 ? rng() % (numKeys / 5) : rng() % (numKeys / 100));
+        if (tree.removeRange(startKey, endKey) != takeExpected(expected, startKey, endKey)) {
+            std::cerr << "Error: removeRange(" << startKey << ", " << endKey << ") returned the wrong values" << std::endl;
+            return false;
+        }
+
+        for (uint32_t k = 0; k < numKeys / 1000; ++k) {
+            uint32_t key = rng() % (numKeys * 2);
+            tree.insert(key, nextValue, disk);
+            expected[key].push_back(nextValue++);
+        }
+        if (!tree.checkStructure()) {
+            std::cerr << "Error: Tree is inconsistent after round " << round << std::endl;
+            return false;
+        }
+    }
+
+    std::vector<RecordId> remaining = takeExpected(expected, 0, 0xFFFFFFFFu);
+    if (tree.rangeQuery(0, 0xFFFFFFFFu, disk) != remaining) {
+        std::cerr << "Error: Tree contents differ from the expected index" << std::endl;
+        return false;
+    }
+    std::cout << "After deletes: " << remaining.size() << " values, height " << tree.getHeight()
+              << ", " << tree.getNumberOfNodes() << " nodes" << std::endl;
+
+    // Deleting everything leaves an empty leaf as the root
+    if (tree.removeRange(0, 0xFFFFFFFFu).size() != remaining.size() || !tree.checkStructure() ||
+        tree.getNumberOfNodes() != 1) {
+        std::cerr << "Error: Tree is not empty after deleting every key" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Trees bulk-loaded at any fill factor are valid and survive a removeRange
+static bool testLowFillBulkLoad() {
+    const double fillFactors[] = {0.01, 0.3, 0.5, 0.51, 0.7, 1.0};
+    const uint32_t sizes[] = {1, 300, 600, 5000, 200000};
+    for (double fillFactor : fillFactors) {
+        for (uint32_t size : sizes) {
+            UIntBPTree tree;
+            std::vector<std::pair<uint32_t, RecordId>> entries;
+            std::vector<RecordId> values;
+            for (uint32_t i = 0; i < size; ++i) {
+                entries.push_back(std::make_pair(i, i));
+                values.push_back(i);
+            }
+            std::vector<RecordId> all;
+            if (!tree.bulkLoad(entries, fillFactor) || !tree.checkStructure() ||
+                (tree.collectRange(0, size, true, all), all != values) ||
+                tree.removeRange(size / 4, size / 2).size() != size / 2 - size / 4 + 1 || !tree.checkStructure()) {
+                std::cerr << "Error: Bulk load of " << size << " keys at fill factor " << fillFactor
+                          << " gave an invalid tree" << std::endl;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main() {
+    std::remove("test_delete.db");
+    Disk scratchDisk("test_delete.db");
+    if (!testRandomDeletes<UIntBPTree>(scratchDisk, 200000) || !testRandomDeletes<Order4BPTree>(scratchDisk, 20000) ||
+        !testRandomDeletes<Order5BPTree>(scratchDisk, 20000)) {
+        return 1;
+    }
+    std::cout << "Random delete test passed" << std::endl;
+    if (!testLowFillBulkLoad()) {
+        return 1;
+    }
+    std::cout << "Low fill bulk load test passed" << std::endl;
+
+    // Load games.txt into a scratch data file and index FG_PCT_home
+    std::vector<std::pair<float, RecordId>> entries;
+    IngestStats ingestStats;
+    if (!ingestGames("games.txt", scratchDisk, IngestOptions(), &entries, ingestStats)) {
+        std::cerr << "Error: Failed to load games.txt." << std::endl;
+        return 1;
+    }
+    std::sort(entries.begin(), entries.end());
+    BPTree bptree;
+    if (!bptree.bulkLoad(entries)) {
+        return 1;
+    }
+
+    // Purge the games with FG_PCT_home >= 0.55 from the index and the data blocks
+    std::vector<RecordId> removed = bptree.removeRange(0.55f, 1.0f);
+    BufferPool bufferPool(scratchDisk);
+    size_t deleted = deleteRecords(bufferPool, removed);
+    if (!bufferPool.FlushAll()) {
+        return 1;
+    }
+    std::cout << "Deleted " << deleted << " records with FG_PCT_home >= 0.55, "
+              << bptree.countRange(0.0f, 1.0f) << " left in the index" << std::endl;
+
+    // A full scan must no longer see them
+    size_t live = 0, liveAbove = 0;
+    std::vector<uint8_t> blockData(BLOCK_SIZE);
+    for (uint32_t block = ingestStats.firstBlock; block < ingestStats.firstBlock + ingestStats.blocksWritten; ++block) {
+        if (!scratchDisk.ReadBlock(block, blockData.data())) {
+            return 1;
+        }
+        BlockView view(blockData.data());
+        for (uint32_t slot = 0; slot < view.numRecords(); ++slot) {
+            if (!view.isDeleted(slot)) {
+                live++;
+                liveAbove += !view.record(slot).fgPctMissing() && view.record(slot).fgPctHome() >= 0.55f;
+            }
+        }
+    }
+    std::cout << "Live records in the data file: " << live << ", with FG_PCT_home >= 0.55: " << liveAbove << std::endl;
+    std::remove("test_delete.db");
+
+    if (deleted != removed.size() || liveAbove != 0 || live + deleted != ingestStats.records ||
+        !bptree.checkStructure()) {
+        std::cerr << "Error: Data file and index disagree after the delete" << std::endl;
+        return 1;
+    }
+    std::cout << "Delete test passed" << std::endl;
+    return 0;
+}
+// Compile with g++ -std=c++11 -pthread test_delete.cc disk.cc async_io.cc buffer_pool.cc record_block.cc record_fetch.cc bptree.cc ingest.cc -o test_delete
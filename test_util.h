@@ -0,0 +1,41 @@
+// test_util.h
+#ifndef TEST_UTIL_H
+#define TEST_UTIL_H
+
+// Helpers shared by the test drivers that load a games file into a scratch
+// data file and time what they run on it
+
+#include "disk.h"
+#include "ingest.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+const int REPEATS = 10;   // Runs of each timed measurement; the median is reported
+
+inline double millisSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+inline double medianMillis(std::vector<double>& millis) {
+    std::sort(millis.begin(), millis.end());
+    return millis[millis.size() / 2];
+}
+
+// Load gamesFile (games.txt unless a test is given another) into disk, a
+// fresh scratch data file, and sync it. entries receives (FG_PCT_home,
+// RecordId) of the loaded records in file order when given.
+inline bool loadGames(const char* gamesFile, Disk& disk, std::vector<std::pair<float, RecordId>>* entries,
+                      IngestStats& stats) {
+    if (!ingestGames(gamesFile, disk, IngestOptions(), entries, stats) || !disk.Sync()) {
+        std::cerr << "Error: Failed to load " << gamesFile << std::endl;
+        return false;
+    }
+    return true;
+}
+
+#endif // TEST_UTIL_H
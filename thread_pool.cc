@@ -0,0 +1,104 @@
+// thread_pool.cc
+#include "thread_pool.h"
+
+// Constructor
+WorkStealingPool::WorkStealingPool(unsigned numThreads)
+    : generation(0),
+      pending(0),
+      stopping(false),
+      steals(0) {
+    if (numThreads == 0) {
+        numThreads = std::thread::hardware_concurrency();
+    }
+    if (numThreads == 0) {
+        numThreads = 1;
+    }
+    for (unsigned i = 0; i < numThreads; ++i) {
+        queues.push_back(std::unique_ptr<Queue>(new Queue()));
+    }
+    for (unsigned i = 0; i < numThreads; ++i) {
+        threads.push_back(std::thread(&WorkStealingPool::workerLoop, this, i));
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    workReady.notify_all();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+void WorkStealingPool::runAll(std::vector<Task>& tasks) {
+    if (tasks.empty()) {
+        return;
+    }
+    // Counted before they are queued: a worker still draining the previous
+    // batch may pick them up straight away
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending = tasks.size();
+    }
+    for (size_t i = 0; i < tasks.size(); ++i) {
+        Queue& queue = *queues[i % queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(tasks[i]));
+    }
+    tasks.clear();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    generation++;
+    workReady.notify_all();
+    allDone.wait(lock, [this]() { return pending == 0; });
+}
+
+// Own queue first (newest task), then the oldest task of another worker
+bool WorkStealingPool::takeTask(unsigned id, Task& task) {
+    {
+        Queue& own = *queues[id];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for (size_t k = 1; k < queues.size(); ++k) {
+        Queue& victim = *queues[(id + k) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            steals++;
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::workerLoop(unsigned id) {
+    uint64_t seenGeneration = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            workReady.wait(lock, [&]() { return stopping || generation != seenGeneration; });
+            if (stopping) {
+                return;
+            }
+            seenGeneration = generation;
+        }
+
+        Task task;
+        while (takeTask(id, task)) {
+            task();
+            task = Task();
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--pending == 0) {
+                allDone.notify_all();
+            }
+        }
+    }
+}
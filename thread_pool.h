@@ -0,0 +1,58 @@
+// thread_pool.h
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads that run batches of tasks. runAll deals the
+// tasks out round-robin to per-worker queues; a worker takes its own tasks
+// from the back and, once its queue is empty, steals from the front of the
+// others, so uneven tasks still keep every thread busy.
+class WorkStealingPool {
+public:
+    typedef std::function<void()> Task;
+
+    // numThreads 0 means one per hardware thread
+    explicit WorkStealingPool(unsigned numThreads = 0);
+    ~WorkStealingPool();
+
+    // Run every task and return once all of them have finished; one caller at a time
+    void runAll(std::vector<Task>& tasks);
+
+    unsigned size() const { return static_cast<unsigned>(threads.size()); }
+
+    // Tasks taken from another worker's queue since the last reset
+    uint64_t getSteals() const { return steals.load(); }
+    void resetSteals() { steals = 0; }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::thread> threads;
+    std::vector<std::unique_ptr<Queue>> queues;
+
+    std::mutex mutex;                    // Guards the fields below
+    std::condition_variable workReady;
+    std::condition_variable allDone;
+    uint64_t generation;                 // Bumped once per runAll batch
+    size_t pending;                      // Tasks of the batch not finished yet
+    bool stopping;
+
+    std::atomic<uint64_t> steals;
+
+    void workerLoop(unsigned id);
+    bool takeTask(unsigned id, Task& task);
+};
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,562 @@
+// tree_checkpoint.cc
+#include "tree_checkpoint.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// Deepest tree open accepts; far beyond any real height, it only stops a
+// damaged file whose child ids form a cycle
+const int MAX_IMAGE_DEPTH = 64;
+
+void CheckpointStats::print() const {
+    std::cout << "Checkpoint statistics:\n";
+    std::cout << "Node images written: " << nodesWritten << (rewritten ? " (file rewritten)" : "") << "\n";
+    std::cout << "Leaf appends written: " << leafAppends << "\n";
+    std::cout << "Bytes written: " << bytesWritten << "\n";
+    std::cout << "Redo log records covered: " << logRecordsCovered << "\n";
+}
+
+template <typename T>
+static void appendRaw(std::vector<uint8_t>& out, const T& value) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+// Read a T at pos and move past it; false if the data ends first
+template <typename T>
+static bool readRaw(const std::vector<uint8_t>& in, size_t& pos, T& value) {
+    if (in.size() - pos < sizeof(T)) {
+        return false;
+    }
+    std::memcpy(&value, &in[pos], sizeof(T));
+    pos += sizeof(T);
+    return true;
+}
+
+static bool readWholeFile(int fd, std::vector<uint8_t>& contents) {
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        return false;
+    }
+    contents.resize(static_cast<size_t>(st.st_size));
+    size_t done = 0;
+    while (done < contents.size()) {
+        ssize_t n = pread(fd, &contents[done], contents.size() - done, static_cast<off_t>(done));
+        if (n <= 0) {
+            return false;
+        }
+        done += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+static bool writeAll(int fd, const uint8_t* data, size_t size, uint64_t offset) {
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = pwrite(fd, data + done, size - done, static_cast<off_t>(offset + done));
+        if (n <= 0) {
+            return false;
+        }
+        done += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Sync the directory holding path, so a file renamed into it stays there
+static bool syncDirectory(const std::string& path) {
+    size_t slash = path.rfind('/');
+    std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0) {
+        return false;
+    }
+    bool synced = fsync(fd) == 0;
+    ::close(fd);
+    return synced;
+}
+
+// Bytes recorded for id in sizes, 0 if it has none
+static uint32_t recordedSize(const std::unordered_map<uint32_t, uint32_t>& sizes, uint32_t id) {
+    auto it = sizes.find(id);
+    return it == sizes.end() ? 0 : it->second;
+}
+
+// Parse the node image body at pos (after the kind byte and id) into node,
+// or just step over it when node is null; child ids go to childIds
+template <typename Key, typename Value>
+static bool parseNodeImage(const std::vector<uint8_t>& in, size_t& pos,
+                           typename TreeCheckpoint<Key, Value>::Node* node, std::vector<uint32_t>* childIds) {
+    uint8_t isLeaf;
+    uint32_t numKeys;
+    if (!readRaw(in, pos, isLeaf) || !readRaw(in, pos, numKeys) ||
+        numKeys >= static_cast<uint32_t>(TreeCheckpoint<Key, Value>::Tree::ORDER) || (!isLeaf && numKeys == 0)) {
+        return false;
+    }
+    for (uint32_t i = 0; i < numKeys; ++i) {
+        Key key;
+        if (!readRaw(in, pos, key)) {
+            return false;
+        }
+        if (node) {
+            node->keys.push_back(key);
+        }
+    }
+    if (isLeaf) {
+        for (uint32_t i = 0; i < numKeys; ++i) {
+            uint32_t count;
+            if (!readRaw(in, pos, count) || (in.size() - pos) / sizeof(Value) < count) {
+                return false;
+            }
+            if (node) {
+                std::vector<Value> values(count);
+                std::memcpy(values.data(), &in[pos], count * sizeof(Value));
+                node->records.push_back(values.data(), count);
+            }
+            pos += count * sizeof(Value);
+        }
+        return true;
+    }
+    for (uint32_t i = 0; i <= numKeys; ++i) {
+        uint32_t childId;
+        if (!readRaw(in, pos, childId) || childId == 0) {
+            return false;
+        }
+        if (childIds) {
+            childIds->push_back(childId);
+        }
+    }
+    return true;
+}
+
+// Parse the (key, value) pairs of a leaf append body at pos into appended, or
+// just step over them when appended is null
+template <typename Key, typename Value>
+static bool parseLeafAppend(const std::vector<uint8_t>& in, size_t& pos,
+                            std::vector<std::pair<Key, Value>>* appended) {
+    uint32_t count;
+    if (!readRaw(in, pos, count) || (in.size() - pos) / (sizeof(Key) + sizeof(Value)) < count) {
+        return false;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        Key key = Key();
+        Value value = Value();
+        readRaw(in, pos, key);
+        readRaw(in, pos, value);
+        if (appended) {
+            appended->push_back(std::make_pair(key, value));
+        }
+    }
+    return true;
+}
+
+// Constructor
+template <typename Key, typename Value>
+TreeCheckpoint<Key, Value>::TreeCheckpoint(Tree& tree, Disk& disk, const std::string& imagePath,
+                                           const std::string& logPath)
+    : tree(tree),
+      disk(disk),
+      imagePath(imagePath),
+      logPath(logPath),
+      imageFd(-1),
+      logFd(-1),
+      imageFileSize(0),
+      nextImageId(1),
+      nextSequence(0),
+      coveredSequence(0),
+      logFailed(false) {}
+
+// Destructor: buffered redo log records are written, but not synced
+template <typename Key, typename Value>
+TreeCheckpoint<Key, Value>::~TreeCheckpoint() {
+    if (logFd >= 0) {
+        std::lock_guard<std::mutex> lock(logMutex);
+        writeLogBuffer();
+        ::close(logFd);
+    }
+    if (imageFd >= 0) {
+        ::close(imageFd);
+    }
+}
+
+template <typename Key, typename Value>
+bool TreeCheckpoint<Key, Value>::open() {
+    imageFd = ::open(imagePath.c_str(), O_RDWR | O_CREAT, 0644);
+    logFd = ::open(logPath.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (imageFd < 0 || logFd < 0) {
+        std::cerr << "Error: Could not open " << (imageFd < 0 ? imagePath : logPath) << ": " << std::strerror(errno)
+                  << std::endl;
+        return false;
+    }
+    return loadImages() && replayLog();
+}
+
+template <typename Key, typename Value>
+bool TreeCheckpoint<Key, Value>::loadImages() {
+    std::vector<uint8_t> file;
+    if (!readWholeFile(imageFd, file)) {
+        std::cerr << "Error: Could not read " << imagePath << std::endl;
+        return false;
+    }
+
+    // Records of each id as of the last complete marker; those after the
+    // previous marker wait in pending until their own marker is read
+    struct PendingRecord {
+        uint8_t kind;
+        uint32_t id;
+        size_t offset;
+        size_t size;
+    };
+    ImageMap images;
+    std::vector<PendingRecord> pending;
+    uint32_t rootId = 0;
+    size_t pos = 0, validEnd = 0;
+    while (pos < file.size()) {
+        size_t start = pos;
+        uint8_t kind;
+        uint32_t id;
+        readRaw(file, pos, kind);
+        if (kind == CHECKPOINT_NODE_IMAGE || kind == CHECKPOINT_LEAF_APPEND) {
+            if (!readRaw(file, pos, id) || id == 0 ||
+                !(kind == CHECKPOINT_NODE_IMAGE ? parseNodeImage<Key, Value>(file, pos, nullptr, nullptr)
+                                                : parseLeafAppend<Key, Value>(file, pos, nullptr))) {
+                break;
+            }
+            PendingRecord record = {kind, id, start, pos - start};
+            pending.push_back(record);
+        } else if (kind == CHECKPOINT_MARKER) {
+            uint64_t sequence;
+            if (!readRaw(file, pos, id) || !readRaw(file, pos, sequence)) {
+                break;
+            }
+            for (const PendingRecord& record : pending) {
+                if (record.kind == CHECKPOINT_NODE_IMAGE) {
+                    images[record.id].image = record.offset;
+                    images[record.id].appends.clear();
+                    imageSizes[record.id] = static_cast<uint32_t>(record.size);
+                } else {
+                    images[record.id].appends.push_back(record.offset);
+                    imageSizes[record.id] += static_cast<uint32_t>(record.size);
+                }
+                nextImageId = std::max(nextImageId, record.id + 1);
+            }
+            pending.clear();
+            rootId = id;
+            coveredSequence = sequence;
+            validEnd = pos;
+        } else {
+            break;
+        }
+    }
+
+    // Drop what an interrupted checkpoint left after the last marker
+    if (validEnd < file.size() && ftruncate(imageFd, static_cast<off_t>(validEnd)) != 0) {
+        std::cerr << "Error: Could not truncate " << imagePath << std::endl;
+        return false;
+    }
+    imageFileSize = validEnd;
+    nextSequence = coveredSequence;
+
+    tree.clear();
+    if (rootId == 0) {
+        return true;
+    }
+    std::vector<Node*> leaves;
+    Node* root = loadNode(file, images, rootId, 0, leaves);
+    if (!root) {
+        std::cerr << "Error: Invalid node image in " << imagePath << std::endl;
+        tree.clear();
+        return false;
+    }
+    for (size_t i = 0; i + 1 < leaves.size(); ++i) {
+        leaves[i]->nextLeaf = leaves[i + 1]->id;
+    }
+    root->rebuildAggregates();
+    tree.root->releaseSubtree();
+    tree.root = root;
+    return true;
+}
+
+template <typename Key, typename Value>
+typename TreeCheckpoint<Key, Value>::Node*
+TreeCheckpoint<Key, Value>::loadNode(const std::vector<uint8_t>& file, const ImageMap& images, uint32_t imageId,
+                                     int depth, std::vector<Node*>& leaves) {
+    const size_t headerSize = sizeof(uint8_t) + sizeof(uint32_t);   // Kind and id
+    auto it = images.find(imageId);
+    if (it == images.end() || it->second.image == SIZE_MAX || depth > MAX_IMAGE_DEPTH) {
+        return nullptr;
+    }
+    size_t pos = it->second.image + headerSize;
+    Node* node = tree.newNode(file[pos] != 0);
+    std::vector<uint32_t> childIds;
+    if (!parseNodeImage<Key, Value>(file, pos, node, &childIds) ||
+        (!node->isLeaf && !it->second.appends.empty())) {
+        return nullptr;
+    }
+
+    // Values inserted after the image, in the order they were inserted then
+    std::vector<std::pair<Key, Value>> appended;
+    for (size_t offset : it->second.appends) {
+        pos = offset + headerSize;
+        parseLeafAppend<Key, Value>(file, pos, &appended);
+    }
+    for (const auto& entry : appended) {
+        if (node->isFull()) {
+            return nullptr;
+        }
+        node->insertNonFull(entry.first, entry.second, disk);
+    }
+    node->imageId = imageId;
+    node->dirty = false;
+    node->appendedSinceImage.clear();
+    if (node->isLeaf) {
+        leaves.push_back(node);
+    }
+    for (uint32_t childId : childIds) {
+        Node* child = loadNode(file, images, childId, depth + 1, leaves);
+        if (!child) {
+            return nullptr;
+        }
+        node->children.push_back(child->id);
+    }
+    return node;
+}
+
+template <typename Key, typename Value>
+bool TreeCheckpoint<Key, Value>::replayLog() {
+    std::vector<uint8_t> log;
+    if (!readWholeFile(logFd, log)) {
+        std::cerr << "Error: Could not read " << logPath << std::endl;
+        return false;
+    }
+
+    // Records up to a torn one at the end; those the checkpoint covers are skipped
+    size_t pos = 0, validEnd = 0;
+    while (pos < log.size()) {
+        uint8_t kind;
+        uint64_t sequence;
+        Key key, endKey;
+        Value value;
+        readRaw(log, pos, kind);
+        if (!readRaw(log, pos, sequence) || !readRaw(log, pos, key)) {
+            break;
+        }
+        if (kind == REDO_INSERT && readRaw(log, pos, value)) {
+            if (sequence >= coveredSequence) {
+                tree.insert(key, value, disk);
+            }
+        } else if (kind == REDO_REMOVE_RANGE && readRaw(log, pos, endKey)) {
+            if (sequence >= coveredSequence) {
+                tree.removeRange(key, endKey);
+            }
+        } else {
+            break;
+        }
+        nextSequence = std::max(nextSequence, sequence + 1);
+        validEnd = pos;
+    }
+    if (validEnd < log.size() && ftruncate(logFd, static_cast<off_t>(validEnd)) != 0) {
+        std::cerr << "Error: Could not truncate " << logPath << std::endl;
+        return false;
+    }
+    return true;
+}
+
+template <typename Key, typename Value>
+void TreeCheckpoint<Key, Value>::insert(const Key& key, const Value& value) {
+    appendLogRecord(REDO_INSERT, &key, sizeof(key), &value, sizeof(value));
+    tree.insert(key, value, disk);
+}
+
+template <typename Key, typename Value>
+std::vector<Value> TreeCheckpoint<Key, Value>::removeRange(const Key& startKey, const Key& endKey) {
+    appendLogRecord(REDO_REMOVE_RANGE, &startKey, sizeof(startKey), &endKey, sizeof(endKey));
+    return tree.removeRange(startKey, endKey);
+}
+
+template <typename Key, typename Value>
+void TreeCheckpoint<Key, Value>::appendLogRecord(uint8_t kind, const void* first, size_t firstSize,
+                                                 const void* second, size_t secondSize) {
+    std::lock_guard<std::mutex> lock(logMutex);
+    logBuffer.push_back(kind);
+    appendRaw(logBuffer, nextSequence++);
+    logBuffer.insert(logBuffer.end(), static_cast<const uint8_t*>(first), static_cast<const uint8_t*>(first) + firstSize);
+    logBuffer.insert(logBuffer.end(), static_cast<const uint8_t*>(second),
+                     static_cast<const uint8_t*>(second) + secondSize);
+    if (logBuffer.size() >= REDO_LOG_BUFFER_SIZE) {
+        writeLogBuffer();
+    }
+}
+
+// Called with logMutex held
+template <typename Key, typename Value>
+bool TreeCheckpoint<Key, Value>::writeLogBuffer() {
+    size_t done = 0;
+    while (done < logBuffer.size() && logFd >= 0) {
+        ssize_t n = ::write(logFd, logBuffer.data() + done, logBuffer.size() - done);
+        if (n <= 0) {
+            std::cerr << "Error: Failed to write the redo log " << logPath << std::endl;
+            logFailed = true;
+            break;
+        }
+        done += static_cast<size_t>(n);
+    }
+    logBuffer.clear();
+    return !logFailed;
+}
+
+template <typename Key, typename Value>
+bool TreeCheckpoint<Key, Value>::syncLog() {
+    std::lock_guard<std::mutex> lock(logMutex);
+    if (logFd < 0 || !writeLogBuffer()) {
+        return false;
+    }
+    if (fdatasync(logFd) != 0) {
+        std::cerr << "Error: Failed to sync the redo log " << logPath << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Append the images of node's subtree, children first so their ids are known,
+// and add the size of every reachable node's newest image to liveBytes. The
+// sizes of the ids written go to newSizes, not imageSizes, until they are on disk.
+template <typename Key, typename Value>
+void TreeCheckpoint<Key, Value>::appendImages(Node* node, bool all, std::vector<uint8_t>& out,
+                                              std::vector<Node*>& written,
+                                              std::unordered_map<uint32_t, uint32_t>& newSizes, uint64_t& liveBytes) {
+    for (uint32_t c = 0; c < node->children.size(); ++c) {
+        appendImages(node->child(c), all, out, written, newSizes, liveBytes);
+    }
+    if (node->imageId == 0) {
+        node->imageId = nextImageId++;
+    }
+    if (!all && !node->dirty && !node->appendedSinceImage.empty()) {
+        size_t start = out.size();
+        out.push_back(CHECKPOINT_LEAF_APPEND);
+        appendRaw(out, node->imageId);
+        appendRaw(out, static_cast<uint32_t>(node->appendedSinceImage.size()));
+        for (const auto& entry : node->appendedSinceImage) {
+            appendRaw(out, entry.first);
+            appendRaw(out, entry.second);
+        }
+        newSizes[node->imageId] = recordedSize(imageSizes, node->imageId) + static_cast<uint32_t>(out.size() - start);
+        written.push_back(node);
+        stats.leafAppends++;
+    } else if (all || node->dirty) {
+        size_t start = out.size();
+        out.push_back(CHECKPOINT_NODE_IMAGE);
+        appendRaw(out, node->imageId);
+        out.push_back(node->isLeaf ? 1 : 0);
+        appendRaw(out, static_cast<uint32_t>(node->keys.size()));
+        for (const Key& key : node->keys) {
+            appendRaw(out, key);
+        }
+        if (node->isLeaf) {
+            for (uint32_t k = 0; k < node->records.size(); ++k) {
+                PostingSpan<Value> recordList = node->records[k];
+                appendRaw(out, static_cast<uint32_t>(recordList.size()));
+                const uint8_t* bytes = reinterpret_cast<const uint8_t*>(recordList.begin());
+                out.insert(out.end(), bytes, bytes + recordList.size() * sizeof(Value));
+            }
+        } else {
+            for (uint32_t c = 0; c < node->children.size(); ++c) {
+                appendRaw(out, node->child(c)->imageId);
+            }
+        }
+        newSizes[node->imageId] = static_cast<uint32_t>(out.size() - start);
+        written.push_back(node);
+    }
+    auto size = newSizes.find(node->imageId);
+    liveBytes += size != newSizes.end() ? size->second : recordedSize(imageSizes, node->imageId);
+}
+
+template <typename Key, typename Value>
+bool TreeCheckpoint<Key, Value>::checkpoint() {
+    stats = CheckpointStats();
+    if (imageFd < 0 || logFd < 0) {
+        std::cerr << "Error: Checkpoint of a tree that was not opened" << std::endl;
+        return false;
+    }
+
+    std::vector<uint8_t> out;
+    std::vector<Node*> written;
+    std::unordered_map<uint32_t, uint32_t> newSizes;   // Committed to imageSizes once written
+    uint64_t liveBytes = 0;
+    appendImages(tree.root, false, out, written, newSizes, liveBytes);
+
+    // Once more than half the file would be stale images, start a fresh one
+    bool rewrite = imageFileSize + out.size() > 2 * liveBytes;
+    if (rewrite) {
+        out.clear();
+        written.clear();
+        newSizes.clear();
+        liveBytes = 0;
+        stats.leafAppends = 0;
+        appendImages(tree.root, true, out, written, newSizes, liveBytes);
+    }
+    out.push_back(CHECKPOINT_MARKER);
+    appendRaw(out, tree.root->imageId);
+    appendRaw(out, nextSequence);
+
+    if (rewrite) {
+        std::string tempPath = imagePath + ".tmp";
+        int fd = ::open(tempPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0 || !writeAll(fd, out.data(), out.size(), 0) || fsync(fd) != 0 ||
+            std::rename(tempPath.c_str(), imagePath.c_str()) != 0) {
+            std::cerr << "Error: Failed to write " << tempPath << std::endl;
+            if (fd >= 0) {
+                ::close(fd);
+            }
+            return false;
+        }
+        ::close(imageFd);
+        imageFd = fd;
+        imageFileSize = out.size();
+        imageSizes.swap(newSizes);
+    } else {
+        if (!writeAll(imageFd, out.data(), out.size(), imageFileSize) || fsync(imageFd) != 0) {
+            std::cerr << "Error: Failed to write a checkpoint to " << imagePath << std::endl;
+            return false;
+        }
+        imageFileSize += out.size();
+        for (const auto& size : newSizes) {
+            imageSizes[size.first] = size.second;
+        }
+    }
+    for (Node* node : written) {
+        node->dirty = false;
+        node->appendedSinceImage.clear();
+    }
+
+    // The renamed file only survives a crash once its directory entry does;
+    // until then the redo log has to keep covering the old image
+    if (rewrite && !syncDirectory(imagePath)) {
+        std::cerr << "Error: Could not sync the directory of " << imagePath << std::endl;
+        return false;
+    }
+
+    // Everything logged so far is in the images now
+    {
+        std::lock_guard<std::mutex> lock(logMutex);
+        logBuffer.clear();
+        if (ftruncate(logFd, 0) != 0 || fsync(logFd) != 0) {
+            std::cerr << "Error: Could not empty the redo log " << logPath << std::endl;
+            return false;
+        }
+        stats.logRecordsCovered = nextSequence - coveredSequence;
+        coveredSequence = nextSequence;
+    }
+    stats.nodesWritten = written.size() - stats.leafAppends;
+    stats.bytesWritten = out.size();
+    stats.rewritten = rewrite;
+    return true;
+}
+
+// Instantiations declared extern in tree_checkpoint.h
+template class TreeCheckpoint<float>;
+template class TreeCheckpoint<uint32_t>;
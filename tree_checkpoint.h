@@ -0,0 +1,129 @@
+// tree_checkpoint.h
+#ifndef TREE_CHECKPOINT_H
+#define TREE_CHECKPOINT_H
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "disk.h"
+#include "bptree.h"
+
+// Image file records: a node image is the kind byte, its uint32 image id, the
+// isLeaf byte, uint32 numKeys and the keys, then per key a uint32 count and
+// the values (leaf) or numKeys + 1 child image ids (internal). A leaf append
+// is the kind byte, the leaf's image id, a uint32 count and that many (key,
+// value) pairs inserted into the leaf since its image. A checkpoint marker is
+// the kind byte, the root's image id and the uint64 sequence number of the
+// first redo log record it does not cover.
+const uint8_t CHECKPOINT_NODE_IMAGE = 1;
+const uint8_t CHECKPOINT_MARKER = 2;
+const uint8_t CHECKPOINT_LEAF_APPEND = 3;
+
+// Redo log records: the kind byte, a uint64 sequence number, then the key and
+// the value of an insert or the two keys of a removeRange
+const uint8_t REDO_INSERT = 1;
+const uint8_t REDO_REMOVE_RANGE = 2;
+const size_t REDO_LOG_BUFFER_SIZE = 64 * 1024;   // Buffered records are written once they reach this
+
+// What the last TreeCheckpoint::checkpoint call did
+struct CheckpointStats {
+    size_t nodesWritten;       // Node images written
+    size_t leafAppends;        // Leaf append records written instead of an image
+    size_t bytesWritten;       // Bytes written to the image file
+    size_t logRecordsCovered;  // Redo log records it made unnecessary
+    bool rewritten;            // Whether the image file was written afresh
+
+    CheckpointStats() : nodesWritten(0), leafAppends(0), bytesWritten(0), logRecordsCovered(0), rewritten(false) {}
+    void print() const;
+};
+
+// Incremental persistence of a BasicBPTree, so that adding a batch of records
+// costs I/O in proportion to the batch rather than to the whole tree, as
+// BasicBPTree::serialize does.
+//
+// The image file is a sequence of node images, leaf appends and checkpoint
+// markers. A checkpoint appends an image of every node changed since the
+// previous one (nodes carry a dirty flag and the id of their image), or for a
+// leaf that only had values inserted, just those values; then a marker naming
+// the root, and syncs. Loading keeps the newest image of each id and the
+// appends after it, up to the last complete marker, so a checkpoint cut short
+// is ignored. Once stale records outweigh the live ones, a checkpoint writes a
+// fresh file instead and renames it over the old one, then syncs the
+// directory. The redo log is only emptied once the images are durable.
+//
+// Changes made through insert and removeRange are appended to the redo log,
+// which syncLog makes durable and checkpoint empties; open replays the
+// records the last checkpoint does not cover. insert may be called from
+// several threads at once like BasicBPTree::insert, while removeRange, open
+// and checkpoint need the tree to themselves.
+template <typename Key, typename Value = RecordId>
+class TreeCheckpoint {
+public:
+    typedef BasicBPTree<Key, Value> Tree;
+    typedef typename Tree::Node Node;
+
+    TreeCheckpoint(Tree& tree, Disk& disk, const std::string& imagePath, const std::string& logPath);
+    ~TreeCheckpoint();
+
+    // Replace the tree with the one of the last checkpoint in the image file
+    // (an empty tree if there is none) and replay the redo log on top of it.
+    // Returns false if a file cannot be opened or holds an invalid node.
+    bool open();
+
+    // Change the tree and log the change
+    void insert(const Key& key, const Value& value);
+    std::vector<Value> removeRange(const Key& startKey, const Key& endKey);
+
+    // Write the buffered redo log records and sync the log
+    bool syncLog();
+
+    // Write the nodes changed since the last checkpoint and empty the redo log
+    bool checkpoint();
+
+    const CheckpointStats& getStats() const { return stats; }
+
+private:
+    Tree& tree;
+    Disk& disk;
+    std::string imagePath;
+    std::string logPath;
+    int imageFd;
+    int logFd;
+    uint64_t imageFileSize;
+    uint32_t nextImageId;
+    uint64_t nextSequence;     // Of the next redo log record
+    uint64_t coveredSequence;  // First redo log record the last checkpoint does not cover
+    bool logFailed;
+    std::unordered_map<uint32_t, uint32_t> imageSizes;   // Bytes of the newest image of each id and its appends
+    std::vector<uint8_t> logBuffer;
+    std::mutex logMutex;
+    CheckpointStats stats;
+
+    // Offsets of the newest image of a node and of the leaf appends after it
+    struct ImageOffsets {
+        size_t image;   // SIZE_MAX for appends to an id that has no image
+        std::vector<size_t> appends;
+
+        ImageOffsets() : image(SIZE_MAX) {}
+    };
+    typedef std::unordered_map<uint32_t, ImageOffsets> ImageMap;
+
+    bool loadImages();
+    Node* loadNode(const std::vector<uint8_t>& file, const ImageMap& images, uint32_t imageId, int depth,
+                   std::vector<Node*>& leaves);
+    bool replayLog();
+    void appendImages(Node* node, bool all, std::vector<uint8_t>& out, std::vector<Node*>& written,
+                      std::unordered_map<uint32_t, uint32_t>& newSizes, uint64_t& liveBytes);
+    void appendLogRecord(uint8_t kind, const void* first, size_t firstSize, const void* second, size_t secondSize);
+    bool writeLogBuffer();
+};
+
+typedef TreeCheckpoint<float> BPTreeCheckpoint;
+typedef TreeCheckpoint<uint32_t> UIntBPTreeCheckpoint;
+
+extern template class TreeCheckpoint<float>;
+extern template class TreeCheckpoint<uint32_t>;
+
+#endif // TREE_CHECKPOINT_H